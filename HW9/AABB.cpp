@@ -0,0 +1,29 @@
+#include "AABB.h"
+#include <algorithm>
+
+namespace ChaosCampAM {
+
+  bool AABB::isEmpty() const {
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+  }
+
+  Vector3 AABB::centroid() const {
+    return 0.5f * (min + max);
+  }
+
+  Vector3 AABB::extent() const {
+    return max - min;
+  }
+
+  float AABB::surfaceArea() const {
+    if (isEmpty()) return 0.0f;
+    Vector3 ext = extent();
+    return 2.0f * (ext.x * ext.y + ext.y * ext.z + ext.z * ext.x);
+  }
+
+  int AABB::longestAxis() const {
+    Vector3 ext = extent();
+    if (ext.x >= ext.y && ext.x >= ext.z) return 0;
+    return ext.y >= ext.z ? 1 : 2;
+  }
+}
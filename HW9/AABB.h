@@ -0,0 +1,85 @@
+#pragma once
+#include "Math/Vector3.h"
+#include <cfloat>
+
+namespace ChaosCampAM {
+
+  /*
+  * Axis-aligned bounding box.
+  * An empty box has its min corner at +inf and its max corner at -inf, so expanding it by any point or box
+  * yields exactly that point or box.
+  */
+  struct AABB {
+    Vector3 min;
+    Vector3 max;
+
+    //Empty box by default
+    AABB() : min(FLT_MAX, FLT_MAX, FLT_MAX), max(-FLT_MAX, -FLT_MAX, -FLT_MAX) {}
+    AABB(const Vector3& min, const Vector3& max) : min(min), max(max) {}
+
+    //Grow the box so that it contains the given point. Inline - BVH builds call this for every primitive of every node.
+    void expand(const Vector3& p) {
+      min.x = p.x < min.x ? p.x : min.x;
+      min.y = p.y < min.y ? p.y : min.y;
+      min.z = p.z < min.z ? p.z : min.z;
+      max.x = p.x > max.x ? p.x : max.x;
+      max.y = p.y > max.y ? p.y : max.y;
+      max.z = p.z > max.z ? p.z : max.z;
+    }
+
+    //Grow the box so that it contains the given box.
+    void expand(const AABB& box) {
+      min.x = box.min.x < min.x ? box.min.x : min.x;
+      min.y = box.min.y < min.y ? box.min.y : min.y;
+      min.z = box.min.z < min.z ? box.min.z : min.z;
+      max.x = box.max.x > max.x ? box.max.x : max.x;
+      max.y = box.max.y > max.y ? box.max.y : max.y;
+      max.z = box.max.z > max.z ? box.max.z : max.z;
+    }
+
+    //True if the box does not contain any point.
+    bool isEmpty() const;
+
+    Vector3 centroid() const;
+    Vector3 extent() const;
+
+    //Total area of the six faces of the box. Zero for an empty box.
+    float surfaceArea() const;
+
+    //Index of the axis along which the box is largest (0 = x, 1 = y, 2 = z).
+    int longestAxis() const;
+
+    //Ray-box slab test. 'invDir' is the component-wise reciprocal of the (normalised) ray direction.
+    //Returns true if the ray overlaps the box somewhere within [0;tMax]. The distance at which the ray enters the box
+    //(clamped to 0) is stored in 'tEntry'.
+    bool intersect(const Vector3& origin, const Vector3& invDir, float tMax, float& tEntry) const {
+      float tNear = 0.0f;
+      float tFar = tMax;
+
+      //NaN values (ray origin on a slab plane, parallel ray) fail both comparisons and leave the interval untouched
+      float t0 = (min.x - origin.x) * invDir.x;
+      float t1 = (max.x - origin.x) * invDir.x;
+      if (t0 > t1) { float tmp = t0; t0 = t1; t1 = tmp; }
+      tNear = t0 > tNear ? t0 : tNear;
+      tFar = t1 < tFar ? t1 : tFar;
+
+      t0 = (min.y - origin.y) * invDir.y;
+      t1 = (max.y - origin.y) * invDir.y;
+      if (t0 > t1) { float tmp = t0; t0 = t1; t1 = tmp; }
+      tNear = t0 > tNear ? t0 : tNear;
+      tFar = t1 < tFar ? t1 : tFar;
+
+      t0 = (min.z - origin.z) * invDir.z;
+      t1 = (max.z - origin.z) * invDir.z;
+      if (t0 > t1) { float tmp = t0; t0 = t1; t1 = tmp; }
+      tNear = t0 > tNear ? t0 : tNear;
+      tFar = t1 < tFar ? t1 : tFar;
+
+      //Widen the exit distance by a few ulps (1 + 2*gamma(3), after Pharr et al., PBRT 3rd ed.) so that rounding can never
+      //cull a grazing hit that the triangle test itself would accept
+      tEntry = tNear;
+      return tNear <= tFar * 1.00000036f;
+    }
+  };
+
+}
@@ -0,0 +1,618 @@
+#include "BVH.h"
+#include "BinaryIO.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <numeric>
+
+namespace ChaosCampAM {
+
+  //Node of the tree under construction. Children are allocated in pairs from a shared counter, so that subtrees can be
+  //built concurrently. The final depth-first layout is written out by flatten() once the tree is complete.
+  struct BVH::BuildNode {
+    AABB bounds;
+    int left; //index of the left child, the right one follows it. -1 for leaves
+    int begin; //primitive range, in primIndices
+    int count;
+  };
+
+  //Primitive as seen by the builder. The bounds travel with the index when ranges are partitioned, so every node
+  //reads its primitives sequentially instead of gathering them from all over the input.
+  struct BuildPrim {
+    AABB bounds;
+    int index;
+
+    //Same as AABB::centroid(), inline for the binning loops
+    Vector3 centroid() const {
+      return Vector3(0.5f * (bounds.min.x + bounds.max.x), 0.5f * (bounds.min.y + bounds.max.y),
+        0.5f * (bounds.min.z + bounds.max.z));
+    }
+  };
+
+  //State shared by all tasks of one build
+  struct BVH::BuildContext {
+    std::vector<BuildPrim> prims; //tasks only touch the range of their own node
+    std::vector<BuildNode> buildNodes; //allocated upfront, never reallocated during the build
+    std::atomic<int> nodeCount;
+    ThreadPool* threadPool;
+    TaskGroup tasks;
+
+    BuildContext(ThreadPool* threadPool) : nodeCount(0), threadPool(threadPool) {}
+  };
+
+  //Primitives falling into one bin of the SAH split search
+  struct SAHBin {
+    AABB bounds;
+    int count = 0;
+  };
+
+  //Bins of all three axes
+  struct SAHBins {
+    SAHBin bins[3][SAH_BIN_COUNT];
+
+    void merge(const SAHBins& other) {
+      for (int axis = 0; axis < 3; axis++) {
+        for (int b = 0; b < SAH_BIN_COUNT; b++) {
+          bins[axis][b].bounds.expand(other.bins[axis][b].bounds);
+          bins[axis][b].count += other.bins[axis][b].count;
+        }
+      }
+    }
+  };
+
+  //Bin of a centroid coordinate. 'scale' maps the centroid extent of the node to [0;SAH_BIN_COUNT].
+  static int binIndex(float coord, float minCoord, float scale) {
+    int bin = (int)((coord - minCoord) * scale);
+    return bin < 0 ? 0 : (bin >= SAH_BIN_COUNT ? SAH_BIN_COUNT - 1 : bin);
+  }
+
+  //Run 'func(first, last, result)' over [begin;end) split into chunks, in parallel if a pool is given and the range
+  //is large, and merge the per-chunk results in chunk order (so the outcome does not depend on the thread count).
+  template<typename Result, typename Func>
+  static Result reduceRange(ThreadPool* threadPool, int begin, int end, Func func) {
+    int count = end - begin;
+    if (!threadPool || count < BVH_PARALLEL_BINNING_SIZE) {
+      Result result;
+      func(begin, end, result);
+      return result;
+    }
+
+    int chunkSize = BVH_PARALLEL_BINNING_SIZE / 4;
+    int chunkCount = (count + chunkSize - 1) / chunkSize;
+    std::vector<Result> partial(chunkCount);
+    threadPool->parallelFor(0, chunkCount, 1, [&](int chunk) {
+      int first = begin + chunk * chunkSize;
+      func(first, std::min(first + chunkSize, end), partial[chunk]);
+    });
+
+    Result result = partial[0];
+    for (int chunk = 1; chunk < chunkCount; chunk++) {
+      result.merge(partial[chunk]);
+    }
+    return result;
+  }
+
+  //Run 'func(first, last)' over [begin;end) split into chunks, in parallel if a pool is given and the range is large.
+  //Chunks are the same as in reduceRange().
+  template<typename Func>
+  static void forEachChunk(ThreadPool* threadPool, int begin, int end, Func func) {
+    int count = end - begin;
+    if (!threadPool || count < BVH_PARALLEL_BINNING_SIZE) {
+      func(begin, end);
+      return;
+    }
+
+    int chunkSize = BVH_PARALLEL_BINNING_SIZE / 4;
+    int chunkCount = (count + chunkSize - 1) / chunkSize;
+    threadPool->parallelFor(0, chunkCount, 1, [&](int chunk) {
+      int first = begin + chunk * chunkSize;
+      func(first, std::min(first + chunkSize, end));
+    });
+  }
+
+  //Interleave the bits of three grid coordinates into a Morton code: 10 bits per axis for 32-bit codes,
+  //21 bits per axis for 64-bit codes (the last argument only picks the code type). x takes the highest bit of every triple.
+  static uint32_t mortonCode(uint32_t x, uint32_t y, uint32_t z, uint32_t) {
+    auto spread = [](uint32_t v) {
+      v = (v | (v << 16)) & 0x030000FFu;
+      v = (v | (v << 8)) & 0x0300F00Fu;
+      v = (v | (v << 4)) & 0x030C30C3u;
+      v = (v | (v << 2)) & 0x09249249u;
+      return v;
+    };
+    return (spread(x) << 2) | (spread(y) << 1) | spread(z);
+  }
+
+  static uint64_t mortonCode(uint32_t x, uint32_t y, uint32_t z, uint64_t) {
+    auto spread = [](uint64_t v) {
+      v = (v | (v << 32)) & 0x001F00000000FFFFull;
+      v = (v | (v << 16)) & 0x001F0000FF0000FFull;
+      v = (v | (v << 8)) & 0x100F00F00F00F00Full;
+      v = (v | (v << 4)) & 0x10C30C30C30C30C3ull;
+      v = (v | (v << 2)) & 0x1249249249249249ull;
+      return v;
+    };
+    return (spread(x) << 2) | (spread(y) << 1) | spread(z);
+  }
+
+  //Only the highest set bit of 'value'
+  template<typename T>
+  static T highestBit(T value) {
+    for (int shift = 1; shift < (int)sizeof(T) * 8; shift *= 2) {
+      value |= value >> shift;
+    }
+    return value ^ (value >> 1);
+  }
+
+  //Stable LSD radix sort of 'keys' on 8-bit digits, permuting 'values' along. Every pass counts the digits per chunk,
+  //turns the counts into output offsets in (digit, chunk) order and scatters each chunk to its offsets - the chunks
+  //in parallel if a pool is given. Passes over a digit that is the same for all keys are skipped.
+  template<typename Key>
+  static void radixSort(ThreadPool* threadPool, std::vector<Key>& keys, std::vector<int>& values) {
+    const int RADIX = 256;
+    int count = (int)keys.size();
+    int chunkSize = threadPool && count >= BVH_PARALLEL_BINNING_SIZE ? BVH_PARALLEL_BINNING_SIZE / 4 : count;
+    int chunkCount = (count + chunkSize - 1) / chunkSize;
+    auto forEachSortChunk = [&](auto func) {
+      if (chunkCount > 1) threadPool->parallelFor(0, chunkCount, 1, func);
+      else func(0);
+    };
+
+    std::vector<Key> keysOut(count);
+    std::vector<int> valuesOut(count);
+    std::vector<int> offsets((size_t)chunkCount * RADIX);
+    for (int shift = 0; shift < (int)sizeof(Key) * 8; shift += 8) {
+      std::fill(offsets.begin(), offsets.end(), 0);
+      forEachSortChunk([&](int chunk) {
+        int* chunkCounts = &offsets[(size_t)chunk * RADIX];
+        int last = std::min((chunk + 1) * chunkSize, count);
+        for (int i = chunk * chunkSize; i < last; i++) {
+          chunkCounts[(keys[i] >> shift) & (RADIX - 1)]++;
+        }
+      });
+
+      //Keys with digit 'd' from chunk 'c' go right after those with smaller digits and those with digit 'd' from
+      //earlier chunks - which keeps the sort stable
+      int offset = 0;
+      bool sameDigit = false;
+      for (int digit = 0; digit < RADIX; digit++) {
+        int digitCount = 0;
+        for (int chunk = 0; chunk < chunkCount; chunk++) {
+          int& chunkOffset = offsets[(size_t)chunk * RADIX + digit];
+          int chunkDigitCount = chunkOffset;
+          chunkOffset = offset + digitCount;
+          digitCount += chunkDigitCount;
+        }
+        sameDigit = sameDigit || digitCount == count;
+        offset += digitCount;
+      }
+      if (sameDigit) continue;
+
+      forEachSortChunk([&](int chunk) {
+        int* chunkOffsets = &offsets[(size_t)chunk * RADIX];
+        int last = std::min((chunk + 1) * chunkSize, count);
+        for (int i = chunk * chunkSize; i < last; i++) {
+          int pos = chunkOffsets[(keys[i] >> shift) & (RADIX - 1)]++;
+          keysOut[pos] = keys[i];
+          valuesOut[pos] = values[i];
+        }
+      });
+      keys.swap(keysOut);
+      values.swap(valuesOut);
+    }
+  }
+
+  //Bounds of a range of primitives and of their centroids
+  struct BVH::RangeBounds {
+    AABB bounds;
+    AABB centroidBounds;
+
+    void merge(const RangeBounds& other) {
+      bounds.expand(other.bounds);
+      centroidBounds.expand(other.centroidBounds);
+    }
+  };
+
+  void BVH::build(const std::vector<AABB>& primBounds, int blockSize, ThreadPool* threadPool, BVHBuildMode mode) {
+    auto startTime = std::chrono::steady_clock::now();
+    this->blockSize = blockSize;
+    buildStats = BVHBuildStats();
+    buildStats.mode = mode;
+    int primCount = (int)primBounds.size();
+    nodes.clear();
+    primIndices.resize(primCount);
+    std::iota(primIndices.mutableData(), primIndices.mutableData() + primCount, 0);
+    if (primCount == 0) return;
+
+    BuildContext context(threadPool);
+    context.prims.resize(primCount);
+    for (int i = 0; i < primCount; i++) {
+      context.prims[i].bounds = primBounds[i];
+      context.prims[i].index = i;
+    }
+
+    //A binary tree with N leaves has 2N-1 nodes
+    context.buildNodes.resize(2 * primCount - 1);
+    context.nodeCount = 1;
+    if (mode == BVHBuildMode::LBVH) {
+      AABB centroidBounds = computeRangeBounds(context, 0, primCount).centroidBounds;
+      if (primCount >= LBVH_MORTON64_MIN_PRIMS) buildLinear<uint64_t>(context, centroidBounds);
+      else buildLinear<uint32_t>(context, centroidBounds);
+    }
+    else {
+      buildRange(context, 0, 0, primCount, 0, computeRangeBounds(context, 0, primCount));
+      if (threadPool) threadPool->wait(context.tasks);
+    }
+
+    int* indices = primIndices.mutableData();
+    for (int i = 0; i < primCount; i++) {
+      indices[i] = context.prims[i].index;
+    }
+
+    std::vector<BVHNode> flatNodes;
+    flatNodes.reserve(context.nodeCount);
+    flatten(context, 0, mode == BVHBuildMode::LBVH, flatNodes);
+    nodes = std::move(flatNodes);
+
+    buildStats.buildTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    buildStats.nodeCount = (int)nodes.size();
+    for (const BVHNode& node : nodes) {
+      if (node.isLeaf()) buildStats.leafCount++;
+    }
+    buildStats.sahCost = computeSAHCost();
+  }
+
+  void BVH::buildRange(BuildContext& context, int nodeIndex, int begin, int end, int depth, const RangeBounds& rangeBounds) {
+    BuildNode& node = context.buildNodes[nodeIndex];
+    node.bounds = rangeBounds.bounds;
+    node.left = -1;
+    node.begin = begin;
+    node.count = end - begin;
+
+    //Try to split unless the node is trivially small or the depth limit (= traversal stack size) is reached.
+    //The split search also yields the bounds of both halves, so primitives are not revisited just for those.
+    int count = end - begin;
+    int splitPos = begin;
+    RangeBounds leftBounds, rightBounds;
+    bool split = count > 1 && depth < BVH_MAX_DEPTH - 1 &&
+      findSplit(context, begin, end, rangeBounds, count > BVH_MAX_LEAF_SIZE, splitPos, leftBounds, rightBounds);
+    if (!split) return;
+
+    int left = context.nodeCount.fetch_add(2);
+    node.left = left;
+    buildChild(context, left, begin, splitPos, depth + 1, leftBounds);
+    buildChild(context, left + 1, splitPos, end, depth + 1, rightBounds);
+  }
+
+  void BVH::buildChild(BuildContext& context, int nodeIndex, int begin, int end, int depth, const RangeBounds& rangeBounds) {
+    if (context.threadPool && end - begin >= BVH_PARALLEL_SUBTREE_SIZE) {
+      context.threadPool->submit(context.tasks, [this, &context, nodeIndex, begin, end, depth, rangeBounds]() {
+        buildRange(context, nodeIndex, begin, end, depth, rangeBounds);
+      });
+    }
+    else {
+      buildRange(context, nodeIndex, begin, end, depth, rangeBounds);
+    }
+  }
+
+  BVH::RangeBounds BVH::computeRangeBounds(BuildContext& context, int begin, int end) const {
+    return reduceRange<RangeBounds>(context.threadPool, begin, end, [&context](int first, int last, RangeBounds& result) {
+      for (int i = first; i < last; i++) {
+        result.bounds.expand(context.prims[i].bounds);
+        result.centroidBounds.expand(context.prims[i].centroid());
+      }
+    });
+  }
+
+  bool BVH::findSplit(BuildContext& context, int begin, int end, const RangeBounds& rangeBounds, bool forceSplit,
+    int& splitPos, RangeBounds& leftBounds, RangeBounds& rightBounds) {
+    int count = end - begin;
+    const AABB& centroidBounds = rangeBounds.centroidBounds;
+    float parentArea = rangeBounds.bounds.surfaceArea();
+    Vector3 centroidExtent = centroidBounds.extent();
+    int longestAxis = centroidBounds.longestAxis();
+    BuildPrim* prims = context.prims.data();
+
+    //Degenerate node (flat or point-like, or all centroids in one spot) - the SAH has nothing to go on,
+    //fall back to a median split
+    if (parentArea <= 0.0f || centroidExtent[longestAxis] <= 0.0f) {
+      if (!forceSplit) return false;
+      splitPos = begin + count / 2;
+      std::nth_element(prims + begin, prims + splitPos, prims + end, [longestAxis](const BuildPrim& a, const BuildPrim& b) {
+        return a.centroid()[longestAxis] < b.centroid()[longestAxis];
+      });
+      leftBounds = computeRangeBounds(context, begin, splitPos);
+      rightBounds = computeRangeBounds(context, splitPos, end);
+      return true;
+    }
+
+    //Sort the centroids into equally sized bins along every axis
+    float binScale[3];
+    for (int axis = 0; axis < 3; axis++) {
+      binScale[axis] = centroidExtent[axis] > 0.0f ? SAH_BIN_COUNT / centroidExtent[axis] : 0.0f;
+    }
+    Vector3 minCoords = centroidBounds.min;
+    SAHBins binned = reduceRange<SAHBins>(context.threadPool, begin, end,
+      [prims, &minCoords, &binScale](int first, int last, SAHBins& result) {
+        for (int i = first; i < last; i++) {
+          const AABB& primBounds = prims[i].bounds;
+          Vector3 centroid = prims[i].centroid();
+          SAHBin& binX = result.bins[0][binIndex(centroid.x, minCoords.x, binScale[0])];
+          SAHBin& binY = result.bins[1][binIndex(centroid.y, minCoords.y, binScale[1])];
+          SAHBin& binZ = result.bins[2][binIndex(centroid.z, minCoords.z, binScale[2])];
+          binX.bounds.expand(primBounds);
+          binX.count++;
+          binY.bounds.expand(primBounds);
+          binY.count++;
+          binZ.bounds.expand(primBounds);
+          binZ.count++;
+        }
+      });
+
+    //Evaluate the SAH at every boundary between bins
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    int bestBin = 0;
+    for (int axis = 0; axis < 3; axis++) {
+      if (binScale[axis] == 0.0f) continue;
+      const SAHBin* bins = binned.bins[axis];
+
+      //Sweep from the right to get the area and count of every possible right half...
+      float rightAreas[SAH_BIN_COUNT];
+      int rightCounts[SAH_BIN_COUNT];
+      AABB rightBox;
+      int rightCount = 0;
+      for (int b = SAH_BIN_COUNT - 1; b > 0; b--) {
+        rightBox.expand(bins[b].bounds);
+        rightCount += bins[b].count;
+        rightAreas[b] = rightBox.surfaceArea();
+        rightCounts[b] = rightCount;
+      }
+
+      //...then sweep from the left, splitting in front of bin 'b'
+      AABB leftBox;
+      int leftCount = 0;
+      for (int b = 1; b < SAH_BIN_COUNT; b++) {
+        leftBox.expand(bins[b - 1].bounds);
+        leftCount += bins[b - 1].count;
+        if (leftCount == 0 || rightCounts[b] == 0) continue;
+        float cost = leftBox.surfaceArea() * blockCount(leftCount) + rightAreas[b] * blockCount(rightCounts[b]);
+        if (cost < bestCost) {
+          bestCost = cost;
+          bestAxis = axis;
+          bestBin = b;
+        }
+      }
+    }
+
+    //Compare against the cost of keeping everything in a leaf
+    bestCost = SAH_TRAVERSAL_COST + SAH_INTERSECTION_COST * bestCost / parentArea;
+    float leafCost = SAH_INTERSECTION_COST * blockCount(count);
+    if (bestAxis < 0 || (bestCost >= leafCost && !forceSplit)) return false;
+
+    //Bounds of the halves are the union of their bins
+    leftBounds = RangeBounds();
+    rightBounds = RangeBounds();
+    for (int b = 0; b < SAH_BIN_COUNT; b++) {
+      (b < bestBin ? leftBounds : rightBounds).bounds.expand(binned.bins[bestAxis][b].bounds);
+    }
+
+    //Partition by the bin of the centroid, gathering the centroid bounds of both halves on the way
+    float minCoord = centroidBounds.min[bestAxis];
+    float scale = binScale[bestAxis];
+    BuildPrim* first = prims + begin;
+    BuildPrim* last = prims + end;
+    while (true) {
+      while (first < last) {
+        Vector3 centroid = first->centroid();
+        if (binIndex(centroid[bestAxis], minCoord, scale) >= bestBin) break;
+        leftBounds.centroidBounds.expand(centroid);
+        first++;
+      }
+      while (first < last) {
+        Vector3 centroid = (last - 1)->centroid();
+        if (binIndex(centroid[bestAxis], minCoord, scale) < bestBin) break;
+        rightBounds.centroidBounds.expand(centroid);
+        last--;
+      }
+      if (first >= last) break;
+      std::swap(*first, *(last - 1));
+    }
+    splitPos = (int)(first - prims);
+    return true;
+  }
+
+  template<typename MortonCode>
+  void BVH::buildLinear(BuildContext& context, const AABB& centroidBounds) {
+    int primCount = (int)context.prims.size();
+    const int bitsPerAxis = sizeof(MortonCode) == 4 ? 10 : 21;
+    const float gridMax = (float)((1u << bitsPerAxis) - 1);
+
+    //Quantize the centroids to a grid over their bounds. Flat axes collapse to the first cell.
+    Vector3 extent = centroidBounds.extent();
+    Vector3 scale(extent.x > 0.0f ? gridMax / extent.x : 0.0f, extent.y > 0.0f ? gridMax / extent.y : 0.0f,
+      extent.z > 0.0f ? gridMax / extent.z : 0.0f);
+    auto cell = [gridMax](float coord, float minCoord, float scale) {
+      float pos = (coord - minCoord) * scale;
+      return (uint32_t)(pos < 0.0f ? 0.0f : (pos > gridMax ? gridMax : pos));
+    };
+
+    std::vector<MortonCode> codes(primCount);
+    std::vector<int> order(primCount);
+    forEachChunk(context.threadPool, 0, primCount, [&](int first, int last) {
+      for (int i = first; i < last; i++) {
+        Vector3 centroid = context.prims[i].centroid();
+        codes[i] = mortonCode(cell(centroid.x, centroidBounds.min.x, scale.x), cell(centroid.y, centroidBounds.min.y, scale.y),
+          cell(centroid.z, centroidBounds.min.z, scale.z), MortonCode());
+        order[i] = i;
+      }
+    });
+    radixSort(context.threadPool, codes, order);
+
+    std::vector<BuildPrim> sortedPrims(primCount);
+    forEachChunk(context.threadPool, 0, primCount, [&](int first, int last) {
+      for (int i = first; i < last; i++) {
+        sortedPrims[i] = context.prims[order[i]];
+      }
+    });
+    context.prims = std::move(sortedPrims);
+
+    //The codes are local - wait for the subtree tasks here
+    buildLinearRange(context, codes.data(), 0, 0, primCount, 0);
+    if (context.threadPool) context.threadPool->wait(context.tasks);
+  }
+
+  template<typename MortonCode>
+  void BVH::buildLinearRange(BuildContext& context, const MortonCode* codes, int nodeIndex, int begin, int end, int depth) {
+    BuildNode& node = context.buildNodes[nodeIndex];
+    node.left = -1;
+    node.begin = begin;
+    node.count = end - begin;
+
+    int count = end - begin;
+    if (count <= BVH_MAX_LEAF_SIZE || depth >= BVH_MAX_DEPTH - 1) return;
+
+    //All codes of a sorted range share the bits above the highest bit in which its first and last code differ,
+    //so the range splits where that bit changes from 0 to 1. Equal codes (one grid cell) are split in the middle.
+    int splitPos;
+    MortonCode differentBits = codes[begin] ^ codes[end - 1];
+    if (differentBits == 0) {
+      splitPos = begin + count / 2;
+    }
+    else {
+      MortonCode splitBit = highestBit(differentBits);
+      splitPos = (int)(std::partition_point(codes + begin, codes + end, [splitBit](MortonCode code) {
+        return (code & splitBit) == 0;
+      }) - codes);
+    }
+
+    int left = context.nodeCount.fetch_add(2);
+    node.left = left;
+    int childBegin[2] = { begin, splitPos };
+    int childEnd[2] = { splitPos, end };
+    for (int child = 0; child < 2; child++) {
+      int childIndex = left + child;
+      int first = childBegin[child];
+      int last = childEnd[child];
+      if (context.threadPool && last - first >= BVH_PARALLEL_SUBTREE_SIZE) {
+        context.threadPool->submit(context.tasks, [this, &context, codes, childIndex, first, last, depth]() {
+          buildLinearRange(context, codes, childIndex, first, last, depth + 1);
+        });
+      }
+      else {
+        buildLinearRange(context, codes, childIndex, first, last, depth + 1);
+      }
+    }
+  }
+
+  int BVH::flatten(const BuildContext& context, int buildIndex, bool computeBounds, std::vector<BVHNode>& flatNodes) const {
+    const BuildNode& buildNode = context.buildNodes[buildIndex];
+    int nodeIndex = (int)flatNodes.size();
+    flatNodes.push_back(BVHNode());
+    flatNodes[nodeIndex].bounds = buildNode.bounds;
+
+    if (buildNode.left < 0) {
+      if (computeBounds) {
+        AABB bounds;
+        for (int i = buildNode.begin; i < buildNode.begin + buildNode.count; i++) {
+          bounds.expand(context.prims[i].bounds);
+        }
+        flatNodes[nodeIndex].bounds = bounds;
+      }
+      flatNodes[nodeIndex].offset = buildNode.begin;
+      flatNodes[nodeIndex].primCount = buildNode.count;
+      return nodeIndex;
+    }
+
+    //Left child right after the node, only the right child index is stored
+    flatten(context, buildNode.left, computeBounds, flatNodes);
+    int rightIndex = flatten(context, buildNode.left + 1, computeBounds, flatNodes);
+    if (computeBounds) {
+      AABB bounds = flatNodes[nodeIndex + 1].bounds;
+      bounds.expand(flatNodes[rightIndex].bounds);
+      flatNodes[nodeIndex].bounds = bounds;
+    }
+    flatNodes[nodeIndex].offset = rightIndex;
+    flatNodes[nodeIndex].primCount = 0;
+    return nodeIndex;
+  }
+
+  float BVH::computeSAHCost() const {
+    if (nodes.empty()) return 0.0f;
+    float rootArea = nodes[0].bounds.surfaceArea();
+    if (rootArea <= 0.0f) return SAH_INTERSECTION_COST * blockCount(nodes[0].primCount);
+
+    //Every node is visited with a probability proportional to its area
+    double cost = 0.0;
+    for (const BVHNode& node : nodes) {
+      float nodeCost = node.isLeaf() ? SAH_INTERSECTION_COST * blockCount(node.primCount) : SAH_TRAVERSAL_COST;
+      cost += nodeCost * node.bounds.surfaceArea();
+    }
+    return (float)(cost / rootArea);
+  }
+
+  const BVHBuildStats& BVH::getBuildStats() const {
+    return buildStats;
+  }
+
+  int BVH::blockCount(int primCount) const {
+    return (primCount + blockSize - 1) / blockSize;
+  }
+
+  bool BVH::isEmpty() const {
+    return nodes.empty();
+  }
+
+  const AABB& BVH::getBounds() const {
+    static const AABB emptyBounds;
+    return nodes.empty() ? emptyBounds : nodes[0].bounds;
+  }
+
+  const DataArray<BVHNode>& BVH::getNodes() const {
+    return nodes;
+  }
+
+  const DataArray<int>& BVH::getPrimIndices() const {
+    return primIndices;
+  }
+
+  bool BVH::isValid(int primCount) const {
+    if (blockSize < 1 || primIndices.size() != (size_t)primCount) return false;
+    for (int index : primIndices) {
+      if (index < 0 || index >= primCount) return false;
+    }
+    if (nodes.empty()) return primCount == 0;
+
+    //Children are stored after their parent, so the depth of a node is known by the time it is reached
+    std::vector<int> depths(nodes.size(), 0);
+    for (int i = 0; i < (int)nodes.size(); i++) {
+      const BVHNode& node = nodes[i];
+      if (depths[i] >= BVH_MAX_DEPTH) return false;
+      if (node.isLeaf()) {
+        if (node.offset < 0 || node.offset > primCount - node.primCount) return false;
+        continue;
+      }
+      //Left child right after the node, the right one after the left subtree
+      if (node.primCount != 0 || node.offset <= i + 1 || node.offset >= (int)nodes.size()) return false;
+      depths[i + 1] = std::max(depths[i + 1], depths[i] + 1);
+      depths[node.offset] = std::max(depths[node.offset], depths[i] + 1);
+    }
+    return true;
+  }
+
+  void BVH::write(BinaryWriter& writer) const {
+    writer.write((int32_t)blockSize);
+    writer.writeArray(nodes);
+    writer.writeArray(primIndices);
+  }
+
+  bool BVH::read(BinaryReader& reader) {
+    int32_t storedBlockSize;
+    if (!reader.read(storedBlockSize) || !reader.readArray(nodes) || !reader.readArray(primIndices)) return false;
+    blockSize = storedBlockSize;
+    buildStats = BVHBuildStats();
+    return true;
+  }
+}
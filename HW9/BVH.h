@@ -0,0 +1,244 @@
+#pragma once
+#include "AABB.h"
+#include "Ray.h"
+#include "RayPacket.h"
+#include "Constants.h"
+#include "DataArray.h"
+#include <vector>
+
+namespace ChaosCampAM {
+
+  //Forward-declarations
+  class BinaryWriter;
+  class BinaryReader;
+  class ThreadPool;
+
+  //A node of a binary bounding volume hierarchy. Exactly 32 bytes, so two nodes share a cache line.
+  // - Leaf (primCount > 0): 'offset' is the position of the first primitive in the BVH primitive index list.
+  // - Interior (primCount == 0): the left child is stored right after the node, 'offset' is the index of the right child.
+  struct BVHNode {
+    AABB bounds;
+    int offset;
+    int primCount;
+
+    bool isLeaf() const { return primCount > 0; }
+  };
+
+  //How BVH::build() lays out the hierarchy
+  // - SAH: binned surface area heuristic. Slowest to build, fastest to trace - for final renders.
+  // - LBVH: primitives sorted along a Morton curve and split at the bits of their codes. Builds several times faster,
+  //   but traces slower - for interactive previews, where the time to the first pixel matters more.
+  enum class BVHBuildMode { SAH, LBVH };
+
+  //Figures of the last build of a BVH
+  struct BVHBuildStats {
+    BVHBuildMode mode = BVHBuildMode::SAH;
+    double buildTimeMs = 0.0;
+    int nodeCount = 0;
+    int leafCount = 0;
+    //Expected cost of a random ray (see BVH::computeSAHCost())
+    float sahCost = 0.0f;
+  };
+
+  /*
+  * Bounding volume hierarchy over an arbitrary set of primitives, built with the surface area heuristic (SAH) or as a
+  * linear BVH from Morton codes (see BVHBuildMode).
+  * The hierarchy only knows the bounds of the primitives - what a primitive actually is (a triangle, a whole mesh)
+  * is up to the user, who intersects leaf contents through a callback during traversal.
+  */
+  class BVH {
+  public:
+    BVH() {}
+
+    //Build the hierarchy over the given primitive bounds. Primitive 'i' is referenced by index 'i' in the leaves.
+    //'blockSize' is the number of primitives the user intersects in one go (e.g. SIMD lanes) - the SAH then charges
+    //leaves per started block instead of per primitive.
+    //SAH split planes are chosen among SAH_BIN_COUNT bins per axis. If a 'threadPool' is given, large subtrees are built
+    //as separate tasks and the primitives of large nodes are binned (or Morton-coded and sorted) in parallel.
+    //The result does not depend on the number of threads.
+    void build(const std::vector<AABB>& primBounds, int blockSize = 1, ThreadPool* threadPool = nullptr,
+      BVHBuildMode mode = BVHBuildMode::SAH);
+
+    //Visit the leaves the ray enters within [0;tMax], front-to-back.
+    //'leafFunc(int first, int count)' is called for each such leaf with the range of its primitives, given as positions
+    //in getPrimIndices() (so data stored in BVH order can be accessed directly). It may shrink 'tMax' (e.g. on a closer hit)
+    //to cull the rest of the traversal, and returns true to terminate the traversal immediately.
+    template<typename LeafFunc>
+    void traverse(const Ray& ray, const float& tMax, LeafFunc leafFunc) const;
+
+    //Visit the leaves that some ray of the packet may enter within [0;tMax], nearest first by the lower bound of the
+    //entry distances of the packet - same contract as traverse(), with boxes tested against the whole packet
+    //(see RayPacket::intersectBox()).
+    template<typename LeafFunc>
+    void traversePacket(const RayPacket& packet, const float& tMax, LeafFunc leafFunc) const;
+
+    bool isEmpty() const;
+
+    //Cost of the hierarchy by the surface area heuristic - the expected cost of intersecting a ray that hits the root
+    //box, in units of one primitive (block) intersection.
+    float computeSAHCost() const;
+
+    //Figures of the last build() (empty after read()).
+    const BVHBuildStats& getBuildStats() const;
+
+    //Bounds of the whole hierarchy
+    const AABB& getBounds() const;
+
+    const DataArray<BVHNode>& getNodes() const;
+    const DataArray<int>& getPrimIndices() const;
+
+    //True if the hierarchy can be traversed safely over 'primCount' primitives: every primitive index and leaf range
+    //is within bounds, children come after their parents and no node is deeper than the traversal stack allows.
+    //An empty hierarchy is only valid over no primitives. Checked on restored hierarchies, which are not trusted.
+    bool isValid(int primCount) const;
+
+    //Store the built hierarchy in a binary scene file / restore it from one (see SceneCache).
+    //Restored nodes and indices are views into the mapped file. Returns false if the data is truncated.
+    void write(BinaryWriter& writer) const;
+    bool read(BinaryReader& reader);
+
+  private:
+    struct BuildNode;
+    struct BuildContext;
+    struct RangeBounds;
+
+    //Build the subtree over primIndices[begin;end) into the temporary node 'nodeIndex'.
+    //'rangeBounds' are the bounds of the primitives in the range and of their centroids.
+    void buildRange(BuildContext& context, int nodeIndex, int begin, int end, int depth, const RangeBounds& rangeBounds);
+
+    //Build a child subtree - as a task of its own if it is large enough and a thread pool is available.
+    void buildChild(BuildContext& context, int nodeIndex, int begin, int end, int depth, const RangeBounds& rangeBounds);
+
+    //Bounds of primIndices[begin;end) and of their centroids, computed from scratch.
+    RangeBounds computeRangeBounds(BuildContext& context, int begin, int end) const;
+
+    //Binned SAH split search over primIndices[begin;end). Returns false if no split is cheaper than a leaf.
+    //On success 'primIndices' is partitioned, 'splitPos' is the first index of the right half and the bounds of
+    //the two halves are stored in 'leftBounds' / 'rightBounds'.
+    bool findSplit(BuildContext& context, int begin, int end, const RangeBounds& rangeBounds, bool forceSplit,
+      int& splitPos, RangeBounds& leftBounds, RangeBounds& rightBounds);
+
+    //LBVH: sort the primitives by the Morton codes of their centroids, then split the sorted list recursively.
+    template<typename MortonCode>
+    void buildLinear(BuildContext& context, const AABB& centroidBounds);
+
+    //LBVH: build the subtree over the Morton-sorted primitives [begin;end) into the temporary node 'nodeIndex'.
+    //Only the topology is built - node bounds are filled in by flatten().
+    template<typename MortonCode>
+    void buildLinearRange(BuildContext& context, const MortonCode* codes, int nodeIndex, int begin, int end, int depth);
+
+    //Write the temporary subtree 'buildIndex' out in depth-first order. Returns the index of its root in 'flatNodes'.
+    //With 'computeBounds' the node bounds are computed bottom-up on the way, instead of taken from the temporary nodes.
+    int flatten(const BuildContext& context, int buildIndex, bool computeBounds, std::vector<BVHNode>& flatNodes) const;
+
+    //Number of blocks needed to intersect 'primCount' primitives
+    int blockCount(int primCount) const;
+
+    DataArray<BVHNode> nodes;
+    DataArray<int> primIndices;
+    int blockSize = 1;
+    BVHBuildStats buildStats;
+  };
+
+  template<typename LeafFunc>
+  void BVH::traverse(const Ray& ray, const float& tMax, LeafFunc leafFunc) const {
+    if (nodes.empty()) return;
+
+    Vector3 origin = ray.getOrigin();
+    Vector3 dir = ray.getDirection();
+    Vector3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+
+    //Stack of nodes still to visit, together with the distance at which the ray enters them
+    int stackNodes[BVH_MAX_DEPTH];
+    float stackDists[BVH_MAX_DEPTH];
+    int stackSize = 0;
+
+    float tEntry;
+    if (!nodes[0].bounds.intersect(origin, invDir, tMax, tEntry)) return;
+    int nodeIndex = 0;
+
+    while (true) {
+      const BVHNode& node = nodes[nodeIndex];
+      if (node.isLeaf()) {
+        if (leafFunc(node.offset, node.primCount)) return;
+      }
+      else {
+        //Descend into the nearer child first and postpone the farther one
+        int left = nodeIndex + 1;
+        int right = node.offset;
+        float tLeft, tRight;
+        bool hitLeft = nodes[left].bounds.intersect(origin, invDir, tMax, tLeft);
+        bool hitRight = nodes[right].bounds.intersect(origin, invDir, tMax, tRight);
+
+        if (hitLeft && hitRight) {
+          if (tRight < tLeft) {
+            stackNodes[stackSize] = left;
+            stackDists[stackSize++] = tLeft;
+            nodeIndex = right;
+          }
+          else {
+            stackNodes[stackSize] = right;
+            stackDists[stackSize++] = tRight;
+            nodeIndex = left;
+          }
+          continue;
+        }
+        if (hitLeft || hitRight) {
+          nodeIndex = hitLeft ? left : right;
+          continue;
+        }
+      }
+
+      //Pop the next node, skipping those that start behind the closest hit found meanwhile
+      do {
+        if (stackSize == 0) return;
+        nodeIndex = stackNodes[--stackSize];
+      } while (stackDists[stackSize] > tMax);
+    }
+  }
+
+  template<typename LeafFunc>
+  void BVH::traversePacket(const RayPacket& packet, const float& tMax, LeafFunc leafFunc) const {
+    if (nodes.empty()) return;
+
+    int stackNodes[BVH_MAX_DEPTH];
+    float stackDists[BVH_MAX_DEPTH];
+    int stackSize = 0;
+
+    float tEntry;
+    if (!packet.intersectBox(nodes[0].bounds, tMax, tEntry)) return;
+    int nodeIndex = 0;
+
+    while (true) {
+      const BVHNode& node = nodes[nodeIndex];
+      if (node.isLeaf()) {
+        if (leafFunc(node.offset, node.primCount)) return;
+      }
+      else {
+        int left = nodeIndex + 1;
+        int right = node.offset;
+        float tLeft, tRight;
+        bool hitLeft = packet.intersectBox(nodes[left].bounds, tMax, tLeft);
+        bool hitRight = packet.intersectBox(nodes[right].bounds, tMax, tRight);
+
+        if (hitLeft && hitRight) {
+          bool rightFirst = tRight < tLeft;
+          stackNodes[stackSize] = rightFirst ? left : right;
+          stackDists[stackSize++] = rightFirst ? tLeft : tRight;
+          nodeIndex = rightFirst ? right : left;
+          continue;
+        }
+        if (hitLeft || hitRight) {
+          nodeIndex = hitLeft ? left : right;
+          continue;
+        }
+      }
+
+      do {
+        if (stackSize == 0) return;
+        nodeIndex = stackNodes[--stackSize];
+      } while (stackDists[stackSize] > tMax);
+    }
+  }
+
+}
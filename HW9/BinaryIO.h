@@ -0,0 +1,108 @@
+#pragma once
+#include "DataArray.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+namespace ChaosCampAM {
+
+  //Arrays in binary files start at a multiple of this, so that they can be used in place from a mapping
+  //(which is page-aligned) - enough for every type stored, including 64-byte aligned triangle blocks.
+  static const size_t BINARY_ARRAY_ALIGNMENT = 64;
+
+  /*
+  * Writes plain data to a binary stream in the native byte order.
+  * Arrays are stored as their element count followed by the raw elements, starting at an aligned offset.
+  */
+  class BinaryWriter {
+  public:
+    BinaryWriter(std::ostream& out) : out(out), pos(0) {}
+
+    template<typename T>
+    void write(const T& value) {
+      writeBytes(&value, sizeof(T));
+    }
+
+    template<typename T>
+    void writeArray(const T* elements, size_t count) {
+      write((uint64_t)count);
+      pad();
+      writeBytes(elements, count * sizeof(T));
+    }
+
+    template<typename T>
+    void writeArray(const DataArray<T>& arr) {
+      writeArray(arr.data(), arr.size());
+    }
+
+    template<typename T>
+    void writeArray(const std::vector<T>& arr) {
+      writeArray(arr.data(), arr.size());
+    }
+
+    bool good() const { return out.good(); }
+
+  private:
+    void writeBytes(const void* bytes, size_t size) {
+      out.write((const char*)bytes, size);
+      pos += size;
+    }
+
+    void pad() {
+      static const char zeros[BINARY_ARRAY_ALIGNMENT] = {};
+      size_t padding = (BINARY_ARRAY_ALIGNMENT - pos % BINARY_ARRAY_ALIGNMENT) % BINARY_ARRAY_ALIGNMENT;
+      writeBytes(zeros, padding);
+    }
+
+    std::ostream& out;
+    size_t pos;
+  };
+
+  /*
+  * Reads what BinaryWriter wrote from a mapped file. Arrays are not copied - they become views into the mapping,
+  * which they keep alive. Every read is bounds-checked and returns false if the file is too short.
+  */
+  class BinaryReader {
+  public:
+    BinaryReader(std::shared_ptr<const MappedFile> file) : file(std::move(file)), pos(0) {}
+
+    template<typename T>
+    bool read(T& value) {
+      if (!has(sizeof(T))) return false;
+      memcpy((void*)&value, file->getData() + pos, sizeof(T));
+      pos += sizeof(T);
+      return true;
+    }
+
+    template<typename T>
+    bool readArray(DataArray<T>& arr) {
+      uint64_t count;
+      if (!read(count)) return false;
+      pos += (BINARY_ARRAY_ALIGNMENT - pos % BINARY_ARRAY_ALIGNMENT) % BINARY_ARRAY_ALIGNMENT;
+      if (count > (file->getSize() / sizeof(T)) || !has(count * sizeof(T))) return false;
+      arr = DataArray<T>((const T*)(file->getData() + pos), (size_t)count, file);
+      pos += count * sizeof(T);
+      return true;
+    }
+
+    //Copying variant for small arrays
+    template<typename T>
+    bool readArray(std::vector<T>& arr) {
+      DataArray<T> view;
+      if (!readArray(view)) return false;
+      arr.assign(view.begin(), view.end());
+      return true;
+    }
+
+  private:
+    bool has(size_t bytes) const {
+      return pos <= file->getSize() && bytes <= file->getSize() - pos;
+    }
+
+    std::shared_ptr<const MappedFile> file;
+    size_t pos;
+  };
+}
@@ -1,34 +1,62 @@
-#pragma once
-namespace ChaosCampAM {
-  /* MATH CONSTANTS */
-//In MathUtil.h
-
-/* GRAPHICS CONSTANTS */
-//json file string constants - used for parsing
-  static const char* STR_SETTINGS = "settings";
-  static const char* STR_BG_COLOR = "background_color";
-  static const char* STR_IMG_SETTINGS = "image_settings";
-  static const char* STR_WIDTH = "width";
-  static const char* STR_HEIGHT = "height";
-  static const char* STR_CAMERA = "camera";
-  static const char* STR_POS = "position";
-  static const char* STR_MATRIX = "matrix";
-  static const char* STR_OBJECTS = "objects";
-  static const char* STR_VERTICES = "vertices";
-  static const char* STR_TRIANGLES = "triangles";
-  static const char* STR_LIGHTS = "lights";
-  static const char* STR_LIGHT_INTENSITY = "intensity";
-  static const char* STR_MAT_INDEX = "material_index";
-  static const char* STR_MATERIALS = "materials";
-  static const char* STR_MAT_TYPE = "type";
-  static const char* STR_MAT_TYPE_DIFFUSE = "diffuse";
-  static const char* STR_MAT_TYPE_REFLECTIVE = "reflective";
-  static const char* STR_MAT_ALBEDO = "albedo";
-  static const char* STR_MAT_SMOOTH = "smooth_shading";
-
-  //Lighting
-  static const Vector3 ALBEDO = Vector3(0.6f, 0.6f, 0.6f);
-  static const float SHADOW_BIAS = 0.001f;
-  static const float REFLECTION_RAY_BIAS = 0.001f;
-  static const int MAX_TRACING_DEPTH = 4;
+#pragma once
+namespace ChaosCampAM {
+  /* MATH CONSTANTS */
+//In MathUtil.h
+
+/* GRAPHICS CONSTANTS */
+//json file string constants - used for parsing
+  static const char* STR_SETTINGS = "settings";
+  static const char* STR_BG_COLOR = "background_color";
+  static const char* STR_IMG_SETTINGS = "image_settings";
+  static const char* STR_WIDTH = "width";
+  static const char* STR_HEIGHT = "height";
+  static const char* STR_CAMERA = "camera";
+  static const char* STR_POS = "position";
+  static const char* STR_MATRIX = "matrix";
+  static const char* STR_OBJECTS = "objects";
+  static const char* STR_VERTICES = "vertices";
+  static const char* STR_TRIANGLES = "triangles";
+  static const char* STR_INSTANCES = "instances";
+  static const char* STR_INSTANCE_OBJECT = "object";
+  static const char* STR_LIGHTS = "lights";
+  static const char* STR_LIGHT_INTENSITY = "intensity";
+  static const char* STR_MAT_INDEX = "material_index";
+  static const char* STR_MATERIALS = "materials";
+  static const char* STR_MAT_TYPE = "type";
+  static const char* STR_MAT_TYPE_DIFFUSE = "diffuse";
+  static const char* STR_MAT_TYPE_REFLECTIVE = "reflective";
+  static const char* STR_MAT_ALBEDO = "albedo";
+  static const char* STR_MAT_SMOOTH = "smooth_shading";
+  //The DOM of a scene file (parsed in-situ) takes about twice the size of the file - one value per number, mostly.
+  //Its memory pool is allocated at once with JSON_POOL_SIZE_FACTOR times the file size.
+  static const int JSON_POOL_SIZE_FACTOR = 3;
+  //The pool keeps its own bookkeeping at the start of the buffer - tiny files still get a buffer of this size (bytes)
+  static const int JSON_POOL_MIN_SIZE = 4096;
+  //Largest image width / height a scene file may ask for (pixels) - keeps the pixel count of images within an int
+  static const int MAX_IMAGE_SIZE = 16384;
+
+  //Lighting
+  static const Vector3 ALBEDO = Vector3(0.6f, 0.6f, 0.6f);
+  static const float SHADOW_BIAS = 0.001f;
+  static const float REFLECTION_RAY_BIAS = 0.001f;
+  static const int MAX_TRACING_DEPTH = 4;
+
+  //Rendering
+  static const int RENDER_TILE_SIZE = 32; //tiles are squares of RENDER_TILE_SIZE x RENDER_TILE_SIZE pixels
+  static const int WAVEFRONT_SIZE = 1 << 16; //camera rays traced together by the wavefront engine (bounds its queues)
+  static const int WAVEFRONT_CHUNK_SIZE = 1024; //queue entries per task of a wavefront stage
+  static const int ADAPTIVE_SAMPLE_BATCH = 4; //samples added to a pixel per refinement step of adaptive sampling
+
+  //Acceleration structures
+  static const int BVH_MAX_LEAF_SIZE = 8; //leaves with more primitives are always split (unless the depth limit is hit)
+  static const int BVH_MAX_DEPTH = 64; //also the size of the traversal stack
+  static const float SAH_TRAVERSAL_COST = 1.0f; //cost of visiting a node, relative to one primitive intersection
+  static const float SAH_INTERSECTION_COST = 1.0f;
+  static const int SAH_BIN_COUNT = 16; //candidate split planes per axis = SAH_BIN_COUNT - 1
+  static const int BVH_PARALLEL_SUBTREE_SIZE = 4096; //subtrees with at least this many primitives are built as tasks
+  static const int BVH_PARALLEL_BINNING_SIZE = 65536; //nodes with at least this many primitives are binned in parallel
+  //LBVH builds of at least this many primitives use 63-bit Morton codes (21 bits per axis) instead of 30-bit ones.
+  //A 1024^3 grid starts putting several primitives of a dense surface into the same cell beyond this size.
+  static const int LBVH_MORTON64_MIN_PRIMS = 1 << 18;
+  static const int LIGHT_TREE_MAX_LEAF_SIZE = 4; //light tree nodes with more lights are split
 }
\ No newline at end of file
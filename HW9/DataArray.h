@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace ChaosCampAM {
+
+  /*
+  * Contiguous array of plain data that either owns its elements or views memory owned by someone else
+  * (e.g. a memory-mapped scene cache, see SceneCache). A view keeps its 'owner' alive, so copies of it stay valid.
+  * Read access is the same in both cases. Modifying a view first copies the elements into owned storage,
+  * so only the explicit modifiers below may be used to change the contents.
+  */
+  template<typename T>
+  class DataArray {
+  public:
+    DataArray() : ptr(nullptr), count(0) {}
+    DataArray(std::vector<T>&& elements) : owned(std::move(elements)) { sync(); }
+    //View of 'count' elements at 'data', which stay valid as long as 'owner' is alive.
+    DataArray(const T* data, size_t count, std::shared_ptr<const void> owner) :
+      ptr(data), count(count), owner(std::move(owner)) {}
+
+    DataArray(const DataArray& other) : owned(other.owned), owner(other.owner) {
+      if (owner) { ptr = other.ptr; count = other.count; }
+      else sync();
+    }
+    DataArray(DataArray&& other) noexcept : owned(std::move(other.owned)), owner(std::move(other.owner)) {
+      if (owner) { ptr = other.ptr; count = other.count; }
+      else sync();
+      other.ptr = nullptr;
+      other.count = 0;
+    }
+    DataArray& operator=(DataArray other) noexcept {
+      owned.swap(other.owned);
+      owner.swap(other.owner);
+      if (owner) { ptr = other.ptr; count = other.count; }
+      else sync();
+      return *this;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T* data() const { return ptr; }
+    const T& operator[](size_t i) const { return ptr[i]; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + count; }
+    const T& back() const { return ptr[count - 1]; }
+
+    //True if the elements live in memory owned by someone else.
+    bool isView() const { return (bool)owner; }
+
+    //Modifiers
+
+    T* mutableData() { makeOwned(); return owned.data(); }
+    void push_back(const T& value) { makeOwned(); owned.push_back(value); sync(); }
+    template<typename... Args>
+    void emplace_back(Args&&... args) { makeOwned(); owned.emplace_back(std::forward<Args>(args)...); sync(); }
+    void reserve(size_t capacity) { makeOwned(); owned.reserve(capacity); sync(); }
+    void resize(size_t newSize) { makeOwned(); owned.resize(newSize); sync(); }
+    void assign(size_t newSize, const T& value) { makeOwned(); owned.assign(newSize, value); sync(); }
+    void clear() { owner.reset(); owned.clear(); sync(); }
+
+  private:
+    void sync() {
+      ptr = owned.data();
+      count = owned.size();
+    }
+
+    void makeOwned() {
+      if (!owner) return;
+      owned.assign(ptr, ptr + count);
+      owner.reset();
+      sync();
+    }
+
+    std::vector<T> owned;
+    const T* ptr;
+    size_t count;
+    std::shared_ptr<const void> owner;
+  };
+}
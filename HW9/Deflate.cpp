@@ -0,0 +1,196 @@
+#include "Deflate.h"
+
+namespace ChaosCampAM {
+
+  //LZ77 parameters
+  static const int WINDOW_SIZE = 32768;
+  static const int HASH_BITS = 15;
+  static const int MAX_CHAIN = 32; //candidates examined per position - trades compression for speed
+  static const int MIN_MATCH = 3;
+  static const int MAX_MATCH = 258;
+
+  //Length codes 257..285 and distance codes 0..29 (RFC 1951, section 3.2.5)
+  static const int LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99,
+    115, 131, 163, 195, 227, 258 };
+  static const int LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+  static const int DIST_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025,
+    1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+  static const int DIST_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12,
+    12, 13, 13 };
+
+  //Appends bits to a byte buffer, least significant bit first, as DEFLATE requires.
+  class BitWriter {
+  public:
+    BitWriter(std::vector<uint8_t>& out) : out(out), bitBuffer(0), bitCount(0) {}
+
+    //Write the 'count' low bits of 'value', LSB first (header fields, extra bits).
+    void writeBits(uint32_t value, int count) {
+      bitBuffer |= value << bitCount;
+      bitCount += count;
+      while (bitCount >= 8) {
+        out.push_back((uint8_t)(bitBuffer & 0xFF));
+        bitBuffer >>= 8;
+        bitCount -= 8;
+      }
+    }
+
+    //Huffman codes are defined MSB first, so they are bit-reversed before writing.
+    void writeCode(uint32_t code, int length) {
+      uint32_t reversed = 0;
+      for (int i = 0; i < length; i++) {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+      }
+      writeBits(reversed, length);
+    }
+
+    //Pad the last partial byte with zeros.
+    void flush() {
+      if (bitCount > 0) {
+        out.push_back((uint8_t)(bitBuffer & 0xFF));
+      }
+      bitBuffer = 0;
+      bitCount = 0;
+    }
+
+  private:
+    std::vector<uint8_t>& out;
+    uint32_t bitBuffer;
+    int bitCount;
+  };
+
+  //Fixed Huffman code of a literal/length symbol (RFC 1951, section 3.2.6)
+  static void writeLitLen(BitWriter& writer, int symbol) {
+    if (symbol < 144) writer.writeCode(0x30 + symbol, 8);
+    else if (symbol < 256) writer.writeCode(0x190 + symbol - 144, 9);
+    else if (symbol < 280) writer.writeCode(symbol - 256, 7);
+    else writer.writeCode(0xC0 + symbol - 280, 8);
+  }
+
+  static void writeMatch(BitWriter& writer, int length, int dist) {
+    int lengthCode = 28;
+    while (LENGTH_BASE[lengthCode] > length) lengthCode--;
+    writeLitLen(writer, 257 + lengthCode);
+    writer.writeBits(length - LENGTH_BASE[lengthCode], LENGTH_EXTRA[lengthCode]);
+
+    int distCode = 29;
+    while (DIST_BASE[distCode] > dist) distCode--;
+    writer.writeCode(distCode, 5);
+    writer.writeBits(dist - DIST_BASE[distCode], DIST_EXTRA[distCode]);
+  }
+
+  static uint32_t hash3(const uint8_t* p) {
+    return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & ((1 << HASH_BITS) - 1);
+  }
+
+  std::vector<uint8_t> zlibCompress(const uint8_t* data, size_t size) {
+    std::vector<uint8_t> out;
+    out.reserve(size / 2 + 64);
+
+    //zlib header: deflate with a 32K window, no preset dictionary, check bits so that the header is divisible by 31
+    out.push_back(0x78);
+    out.push_back(0x01);
+
+    BitWriter writer(out);
+    writer.writeBits(1, 1); //BFINAL - single block
+    writer.writeBits(1, 2); //BTYPE = 01, fixed Huffman codes
+
+    //Most recent position of every 3-byte hash, and for every position (modulo the window) the previous one with
+    //the same hash
+    std::vector<int> head(1 << HASH_BITS, -1);
+    std::vector<int> prev(WINDOW_SIZE, -1);
+    auto insert = [&](size_t pos) {
+      uint32_t h = hash3(data + pos);
+      prev[pos & (WINDOW_SIZE - 1)] = head[h];
+      head[h] = (int)pos;
+    };
+
+    size_t pos = 0;
+    while (pos < size) {
+      int bestLength = 0;
+      int bestDist = 0;
+
+      if (pos + MIN_MATCH <= size) {
+        int maxLength = size - pos < (size_t)MAX_MATCH ? (int)(size - pos) : MAX_MATCH;
+        int candidate = head[hash3(data + pos)];
+        for (int chain = 0; chain < MAX_CHAIN && candidate >= 0 && pos - candidate <= (size_t)WINDOW_SIZE; chain++) {
+          int length = 0;
+          while (length < maxLength && data[candidate + length] == data[pos + length]) length++;
+          if (length > bestLength) {
+            bestLength = length;
+            bestDist = (int)(pos - candidate);
+            if (length == maxLength) break;
+          }
+
+          //Chains only go back in time - a larger 'previous' position means the slot was reused by a newer one
+          int next = prev[candidate & (WINDOW_SIZE - 1)];
+          if (next >= candidate) break;
+          candidate = next;
+        }
+      }
+
+      if (bestLength >= MIN_MATCH) {
+        writeMatch(writer, bestLength, bestDist);
+        for (int i = 0; i < bestLength; i++, pos++) {
+          if (pos + MIN_MATCH <= size) insert(pos);
+        }
+      }
+      else {
+        writeLitLen(writer, data[pos]);
+        if (pos + MIN_MATCH <= size) insert(pos);
+        pos++;
+      }
+    }
+
+    writeLitLen(writer, 256); //end of block
+    writer.flush();
+
+    //zlib trailer: Adler-32 of the uncompressed data, big-endian
+    uint32_t checksum = adler32(data, size);
+    out.push_back((uint8_t)(checksum >> 24));
+    out.push_back((uint8_t)(checksum >> 16));
+    out.push_back((uint8_t)(checksum >> 8));
+    out.push_back((uint8_t)checksum);
+    return out;
+  }
+
+  //Table for the reflected CRC-32 polynomial 0xEDB88320, one entry per byte value
+  static std::vector<uint32_t> makeCrcTable() {
+    std::vector<uint32_t> table(256);
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      table[n] = c;
+    }
+    return table;
+  }
+
+  uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc) {
+    static const std::vector<uint32_t> table = makeCrcTable();
+    crc = crc ^ 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++) {
+      crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+  }
+
+  uint32_t adler32(const uint8_t* data, size_t size) {
+    const uint32_t MOD_ADLER = 65521;
+    uint32_t a = 1;
+    uint32_t b = 0;
+    //5552 is the largest block for which the sums cannot overflow 32 bits before taking the modulo
+    while (size > 0) {
+      size_t blockSize = size < 5552 ? size : 5552;
+      for (size_t i = 0; i < blockSize; i++) {
+        a += data[i];
+        b += a;
+      }
+      a %= MOD_ADLER;
+      b %= MOD_ADLER;
+      data += blockSize;
+      size -= blockSize;
+    }
+    return (b << 16) | a;
+  }
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ChaosCampAM {
+
+  //Compress a buffer into a zlib stream (RFC 1950) holding a single DEFLATE block (RFC 1951).
+  //LZ77 matching over a 32 KB window with hash chains, encoded with the fixed Huffman codes.
+  std::vector<uint8_t> zlibCompress(const uint8_t* data, size_t size);
+
+  //CRC-32 (ISO 3309, as used by PNG) of a buffer. Pass the previous result as 'crc' to continue a running checksum.
+  uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+  //Adler-32 checksum (as used by zlib) of a buffer.
+  uint32_t adler32(const uint8_t* data, size_t size);
+}
@@ -0,0 +1,52 @@
+#include "Framebuffer.h"
+
+namespace ChaosCampAM {
+
+  Framebuffer::Framebuffer(int width, int height) :
+    width(width), height(height), colorSums(width * height), weights(width * height, 0.0f) {}
+
+  int Framebuffer::getWidth() const {
+    return width;
+  }
+
+  int Framebuffer::getHeight() const {
+    return height;
+  }
+
+  void Framebuffer::clear() {
+    colorSums.assign(colorSums.size(), Vector3());
+    weights.assign(weights.size(), 0.0f);
+  }
+
+  void Framebuffer::setPixel(int x, int y, const Vector3& color) {
+    colorSums[y * width + x] = color;
+    weights[y * width + x] = 1.0f;
+  }
+
+  void Framebuffer::addSample(int x, int y, const Vector3& color, float weight) {
+    colorSums[y * width + x] = colorSums[y * width + x] + color * weight;
+    weights[y * width + x] += weight;
+  }
+
+  Vector3 Framebuffer::getPixel(int x, int y) const {
+    float weight = weights[y * width + x];
+    if (weight <= 0.0f) return Vector3();
+    //Single samples are returned untouched, so they convert to exactly the same 8-bit colour as before accumulation
+    return weight == 1.0f ? colorSums[y * width + x] : colorSums[y * width + x] * (1.0f / weight);
+  }
+
+  float Framebuffer::getWeight(int x, int y) const {
+    return weights[y * width + x];
+  }
+
+  std::vector<ColorRGB> Framebuffer::getRGB8() const {
+    std::vector<ColorRGB> pixels;
+    pixels.reserve(width * height);
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        pixels.push_back(ColorRGB(getPixel(x, y)));
+      }
+    }
+    return pixels;
+  }
+}
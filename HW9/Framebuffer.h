@@ -0,0 +1,47 @@
+#pragma once
+#include "Math/Vector3.h"
+#include "ColorRGB.h"
+#include <vector>
+
+namespace ChaosCampAM {
+
+  /*
+  * In-memory image the renderer traces into.
+  * Every pixel accumulates a sum of float RGB samples together with their total weight, so that several samples per
+  * pixel can be averaged. The 8-bit view for writing image files is produced on demand.
+  * Different pixels may be written from different threads concurrently; the same pixel may not.
+  */
+  class Framebuffer {
+  public:
+    Framebuffer() : width(0), height(0) {}
+    Framebuffer(int width, int height);
+
+    int getWidth() const;
+    int getHeight() const;
+
+    //Discard all samples of all pixels.
+    void clear();
+
+    //Replace whatever the pixel holds by a single sample.
+    void setPixel(int x, int y, const Vector3& color);
+
+    //Accumulate another sample into the pixel.
+    void addSample(int x, int y, const Vector3& color, float weight = 1.0f);
+
+    //Weighted average of the samples of the pixel. Black if it has none.
+    Vector3 getPixel(int x, int y) const;
+
+    //Total weight of the samples accumulated into the pixel.
+    float getWeight(int x, int y) const;
+
+    //Tonemap every pixel to 8 bits per channel (components are clamped to [0;1], see ColorRGB).
+    //Pixels are stored row by row, starting from the top left corner.
+    std::vector<ColorRGB> getRGB8() const;
+
+  private:
+    int width;
+    int height;
+    std::vector<Vector3> colorSums;
+    std::vector<float> weights;
+  };
+}
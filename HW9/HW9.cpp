@@ -1,73 +1,123 @@
-/*
-* Chaos Camp: Ray-Tracing Course
-* HOMEWORK: LECTURE 9, PROBLEMS 1-6
-* Author: Asen Markov
-* Date: 03/05/2022
-*
-* Description:
-* We introduce materials to our ray-tracer. We finally reach recursive ray tracing.
-* 
-* Problems 1 - 2: Render a scene where pixels are shaded based on barycentric coordinates.
-* Problems 3 - 4: Render a scene containing diffuse materials.
-* Problems 5 - 6: Render a scene containing reflective materials.
-* 
-*/
-
-#include <fstream>
-#include <iostream>
-#include <assert.h>
-#include <vector>
-#include <utility>
-#include <string>
-
-#include "ColorRGB.h"
-#include "Math/Vector3.h"
-#include "Math/Matrix3x3.h"
-#include "Math/MathUtil.h"
-#include "Triangle.h"
-#include "Ray.h"
-#include "Camera.h"
-#include "Scene.h"
-#include "SceneParser.h"
-#include "Renderer.h"
-
-using namespace ChaosCampAM;
-
-int main() {
-  Renderer renderer;
-  SceneParser parser;
-
-  //Problem 1
-  //Scene scene1;
-  //parser.parse("input/scene0.crtscene", scene1);
-  //renderer.render(scene1, "output/scene0.ppm",ShadingMode::Barycentric);
-
-  //Problem 2
-  //Scene scene2;
-  //parser.parse("input/scene1.crtscene", scene2);
-  //renderer.render(scene2, "output/scene1.ppm",ShadingMode::Barycentric);
-
-  //Problem 3
-  Scene scene3;
-  parser.parse("input/scene2.crtscene", scene3);
-  renderer.render(scene3, "output/scene2.ppm",ShadingMode::Light);
-
-  //Problem 4
-  //Scene scene4;
-  //parser.parse("input/scene3.crtscene", scene4);
-  //renderer.render(scene4, "output/scene3.ppm",ShadingMode::Light);
-
-  //Problem 5
-  //Scene scene5;
-  //parser.parse("input/scene4.crtscene", scene5);
-  //renderer.render(scene5, "output/scene4.ppm", ShadingMode::Light);
-
-  //Problem 6
-  //Scene scene6;
-  //parser.parse("input/scene5.crtscene", scene6);
-  //renderer.render(scene6, "output/scene5.ppm", ShadingMode::Light);
-
-
-
-  return 0;
-}
+/*
+* Chaos Camp: Ray-Tracing Course
+* HOMEWORK: LECTURE 9, PROBLEMS 1-6
+* Author: Asen Markov
+* Date: 03/05/2022
+*
+* Description:
+* We introduce materials to our ray-tracer. We finally reach recursive ray tracing.
+* 
+* Problems 1 - 2: Render a scene where pixels are shaded based on barycentric coordinates.
+* Problems 3 - 4: Render a scene containing diffuse materials.
+* Problems 5 - 6: Render a scene containing reflective materials.
+* 
+*/
+
+#include <fstream>
+#include <iostream>
+#include <assert.h>
+#include <vector>
+#include <utility>
+#include <string>
+
+#include "ColorRGB.h"
+#include "Math/Vector3.h"
+#include "Math/Matrix3x3.h"
+#include "Math/MathUtil.h"
+#include "Triangle.h"
+#include "Ray.h"
+#include "Camera.h"
+#include "Scene.h"
+#include "SceneParser.h"
+#include "SceneCache.h"
+#include "Renderer.h"
+
+using namespace ChaosCampAM;
+
+int main(int argc, char** argv) {
+  //Converter: HW9 --convert <input.crtscene> [output.crtbin]
+  if (argc >= 3 && std::string(argv[1]) == "--convert") {
+    SceneCache cache;
+    std::string output = argc >= 4 ? argv[3] : cache.getCachePath(argv[2]);
+    if (!cache.convert(argv[2], output)) {
+      std::cout << "Could not convert " << argv[2] << " to " << output << "\n";
+      return 1;
+    }
+    return 0;
+  }
+
+  //Checker: HW9 --check <scene.crtscene>... - every file is parsed by both parsers (DOM and streaming), which must
+  //accept or reject it alike. Prints one line per file, the exit code is 1 if the parsers disagree on any.
+  //Every file of input/invalid is rejected: HW9 --check input/invalid/*.crtscene
+  if (argc >= 3 && std::string(argv[1]) == "--check") {
+    bool agreed = true;
+    for (int i = 2; i < argc; i++) {
+      SceneParser parser;
+      Scene scene;
+      SceneParseError domError, streamError;
+      bool domValid = parser.parse(argv[i], scene, &domError);
+      bool streamValid = parser.parseStreaming(argv[i], scene, &streamError);
+      std::cout << argv[i] << ": ";
+      if (domValid != streamValid) {
+        std::cout << "MISMATCH - parse: " << (domValid ? "valid" : domError.describe()) << ", parseStreaming: " <<
+          (streamValid ? "valid" : streamError.describe()) << "\n";
+        agreed = false;
+      }
+      else {
+        std::cout << (domValid ? std::string("valid") : "rejected - " + domError.describe()) << "\n";
+      }
+    }
+    return agreed ? 0 : 1;
+  }
+
+  //Preview: HW9 --preview - scenes are parsed directly with fast LBVH builds, bypassing the cache,
+  //for the shortest time to the first pixel, and rendered progressively (coarse images are written as they come)
+  bool preview = argc >= 2 && std::string(argv[1]) == "--preview";
+  ProgressiveSettings previewSettings;
+  previewSettings.sampleTarget = 1;
+
+  Renderer renderer;
+  SceneParser parser;
+  SceneCache cache;
+  if (preview) parser.setBVHBuildMode(BVHBuildMode::LBVH);
+
+  //Problem 1
+  //Scene scene1;
+  //parser.parse("input/scene0.crtscene", scene1);
+  //renderer.render(scene1, "output/scene0.ppm",ShadingMode::Barycentric);
+
+  //Problem 2
+  //Scene scene2;
+  //parser.parse("input/scene1.crtscene", scene2);
+  //renderer.render(scene2, "output/scene1.ppm",ShadingMode::Barycentric);
+
+  //Problem 3
+  Scene scene3;
+  bool loaded = preview ? parser.parseStreaming("input/scene2.crtscene", scene3) :
+    cache.loadScene("input/scene2.crtscene", scene3);
+  if (!loaded) {
+    std::cout << "Could not load input/scene2.crtscene\n";
+    return 1;
+  }
+  if (preview) renderer.renderProgressive(scene3, "output/scene2.ppm", ShadingMode::Light, previewSettings);
+  else renderer.render(scene3, "output/scene2.ppm",ShadingMode::Light);
+
+  //Problem 4
+  //Scene scene4;
+  //parser.parse("input/scene3.crtscene", scene4);
+  //renderer.render(scene4, "output/scene3.ppm",ShadingMode::Light);
+
+  //Problem 5
+  //Scene scene5;
+  //parser.parse("input/scene4.crtscene", scene5);
+  //renderer.render(scene5, "output/scene4.ppm", ShadingMode::Light);
+
+  //Problem 6
+  //Scene scene6;
+  //parser.parse("input/scene5.crtscene", scene6);
+  //renderer.render(scene6, "output/scene5.ppm", ShadingMode::Light);
+
+
+
+  return 0;
+}
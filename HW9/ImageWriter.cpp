@@ -0,0 +1,141 @@
+#include "ImageWriter.h"
+#include "Deflate.h"
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+
+namespace ChaosCampAM {
+
+  ImageFormat imageFormatFromFilename(const std::string& filename) {
+    size_t dot = filename.find_last_of('.');
+    if (dot != std::string::npos) {
+      std::string ext = filename.substr(dot + 1);
+      for (char& c : ext) c = (char)tolower(c);
+      if (ext == "png") return ImageFormat::PNG;
+    }
+    return ImageFormat::PPM;
+  }
+
+  bool writePPM(const std::string& filename, int width, int height, const std::vector<ColorRGB>& pixels) {
+    std::ofstream ppmFileStream(filename, std::ios::out | std::ios::binary);
+    if (!ppmFileStream.is_open()) return false;
+
+    ppmFileStream << "P6\n";
+    ppmFileStream << width << " " << height << "\n";
+    ppmFileStream << ColorRGB::maxColorComponents << "\n";
+
+    //ColorRGB is exactly three bytes (r, g, b), so the pixels can be written in one go
+    static_assert(sizeof(ColorRGB) == 3, "ColorRGB must be tightly packed");
+    ppmFileStream.write(reinterpret_cast<const char*>(pixels.data()), (std::streamsize)pixels.size() * 3);
+    return ppmFileStream.good();
+  }
+
+  static void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back((uint8_t)(value >> 24));
+    out.push_back((uint8_t)(value >> 16));
+    out.push_back((uint8_t)(value >> 8));
+    out.push_back((uint8_t)value);
+  }
+
+  //Write a PNG chunk: length, type, data and the CRC of type + data
+  static void writeChunk(std::ofstream& out, const char* type, const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> chunk;
+    chunk.reserve(data.size() + 12);
+    appendBigEndian(chunk, (uint32_t)data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    appendBigEndian(chunk, crc32(chunk.data() + 4, data.size() + 4));
+    out.write(reinterpret_cast<const char*>(chunk.data()), (std::streamsize)chunk.size());
+  }
+
+  //Paeth predictor (PNG specification, section 9.4)
+  static uint8_t paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return (uint8_t)a;
+    return (uint8_t)(pb <= pc ? b : c);
+  }
+
+  //Filter every row with each of the five PNG filters and keep the one with the smallest sum of absolute
+  //(signed) residuals - the heuristic recommended by the PNG specification
+  static std::vector<uint8_t> filterRows(int width, int height, const std::vector<ColorRGB>& pixels) {
+    const size_t bpp = 3;
+    size_t stride = (size_t)width * bpp;
+    const uint8_t* image = reinterpret_cast<const uint8_t*>(pixels.data());
+    std::vector<uint8_t> zeroRow(stride, 0);
+
+    std::vector<uint8_t> filtered;
+    filtered.reserve((stride + 1) * height);
+    std::vector<uint8_t> candidate(stride);
+    std::vector<uint8_t> best(stride);
+
+    for (int y = 0; y < height; y++) {
+      const uint8_t* row = image + y * stride;
+      const uint8_t* up = y > 0 ? row - stride : zeroRow.data();
+      long bestScore = -1;
+      uint8_t bestFilter = 0;
+
+      for (uint8_t filter = 0; filter < 5; filter++) {
+        long score = 0;
+        for (size_t i = 0; i < stride; i++) {
+          int a = i >= bpp ? row[i - bpp] : 0;
+          int b = up[i];
+          int c = i >= bpp ? up[i - bpp] : 0;
+          uint8_t predicted = 0;
+          switch (filter) {
+          case 1: predicted = (uint8_t)a; break;
+          case 2: predicted = (uint8_t)b; break;
+          case 3: predicted = (uint8_t)((a + b) / 2); break;
+          case 4: predicted = paeth(a, b, c); break;
+          default: break;
+          }
+          candidate[i] = (uint8_t)(row[i] - predicted);
+          score += abs((int)(int8_t)candidate[i]);
+        }
+        if (bestScore < 0 || score < bestScore) {
+          bestScore = score;
+          bestFilter = filter;
+          best.swap(candidate);
+        }
+      }
+
+      filtered.push_back(bestFilter);
+      filtered.insert(filtered.end(), best.begin(), best.end());
+    }
+    return filtered;
+  }
+
+  bool writePNG(const std::string& filename, int width, int height, const std::vector<ColorRGB>& pixels) {
+    std::ofstream pngFileStream(filename, std::ios::out | std::ios::binary);
+    if (!pngFileStream.is_open()) return false;
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    pngFileStream.write(reinterpret_cast<const char*>(signature), 8);
+
+    //Header: dimensions, 8 bits per channel, truecolour (RGB), deflate, adaptive filtering, no interlacing
+    std::vector<uint8_t> header;
+    appendBigEndian(header, (uint32_t)width);
+    appendBigEndian(header, (uint32_t)height);
+    header.push_back(8);
+    header.push_back(2);
+    header.push_back(0);
+    header.push_back(0);
+    header.push_back(0);
+    writeChunk(pngFileStream, "IHDR", header);
+
+    std::vector<uint8_t> filtered = filterRows(width, height, pixels);
+    writeChunk(pngFileStream, "IDAT", zlibCompress(filtered.data(), filtered.size()));
+    writeChunk(pngFileStream, "IEND", std::vector<uint8_t>());
+    return pngFileStream.good();
+  }
+
+  bool writeImage(const std::string& filename, int width, int height, const std::vector<ColorRGB>& pixels) {
+    if (imageFormatFromFilename(filename) == ImageFormat::PNG) {
+      return writePNG(filename, width, height, pixels);
+    }
+    return writePPM(filename, width, height, pixels);
+  }
+}
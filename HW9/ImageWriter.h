@@ -0,0 +1,24 @@
+#pragma once
+#include "ColorRGB.h"
+#include <string>
+#include <vector>
+
+namespace ChaosCampAM {
+
+  //Image file formats the renderer can produce
+  enum class ImageFormat { PPM, PNG };
+
+  //Pick the format from the file extension - ".png" gives PNG, anything else a binary PPM.
+  ImageFormat imageFormatFromFilename(const std::string& filename);
+
+  //Write 8-bit RGB pixels (row by row, top left first) to a binary (P6) .ppm file.
+  //Returns false if the file could not be written.
+  bool writePPM(const std::string& filename, int width, int height, const std::vector<ColorRGB>& pixels);
+
+  //Write 8-bit RGB pixels (row by row, top left first) to a .png file. Rows are filtered adaptively and compressed
+  //with the built-in deflate encoder. Returns false if the file could not be written.
+  bool writePNG(const std::string& filename, int width, int height, const std::vector<ColorRGB>& pixels);
+
+  //Write the pixels in the format given by the extension of 'filename'.
+  bool writeImage(const std::string& filename, int width, int height, const std::vector<ColorRGB>& pixels);
+}
@@ -0,0 +1,73 @@
+#include "LightTree.h"
+#include "Math/MathUtil.h"
+#include <algorithm>
+#include <assert.h>
+
+namespace ChaosCampAM {
+
+  void LightTree::build(const std::vector<PointLight>& lights) {
+    nodes.clear();
+    lightIndices.resize(lights.size());
+    for (int i = 0; i < (int)lights.size(); i++) {
+      lightIndices[i] = i;
+    }
+    if (lights.empty()) return;
+    buildNode(lights, 0, (int)lights.size(), 0);
+  }
+
+  int LightTree::buildNode(const std::vector<PointLight>& lights, int first, int count, int depth) {
+    int nodeIndex = (int)nodes.size();
+    nodes.push_back(LightNode());
+    AABB bounds;
+    float intensity = 0.0f;
+    for (int i = first; i < first + count; i++) {
+      bounds.expand(lights[lightIndices[i]].pos);
+      intensity += lights[lightIndices[i]].intensity;
+    }
+
+    //Leaf - the lights stay in scene order
+    if (count <= LIGHT_TREE_MAX_LEAF_SIZE) {
+      std::sort(lightIndices.begin() + first, lightIndices.begin() + first + count);
+      nodes[nodeIndex] = { bounds, intensity, first, count };
+      return nodeIndex;
+    }
+
+    //Split at the median of the largest extent. Halving keeps the depth at log2(lights), far below BVH_MAX_DEPTH.
+    assert(depth < BVH_MAX_DEPTH - 1);
+    Vector3 extent = bounds.max - bounds.min;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    int half = count / 2;
+    std::nth_element(lightIndices.begin() + first, lightIndices.begin() + first + half,
+      lightIndices.begin() + first + count, [&lights, axis](int a, int b) {
+        //ties broken by index, so that the tree does not depend on the implementation of nth_element
+        float posA = lights[a].pos[axis];
+        float posB = lights[b].pos[axis];
+        return posA < posB || (posA == posB && a < b);
+      });
+
+    buildNode(lights, first, half, depth + 1);
+    int right = buildNode(lights, first + half, count - half, depth + 1);
+    nodes[nodeIndex] = { bounds, intensity, right, 0 };
+    return nodeIndex;
+  }
+
+  bool LightTree::mayContribute(const LightNode& node, const Vector3& point, const Vector3& normal, float maxAlbedo,
+    float threshold) {
+    const AABB& box = node.bounds;
+
+    //Behind the surface: the lights are lit at a cosine of 0 if every corner of the box is on the back side of the
+    //tangent plane. The plane itself is kept - rounding may still put a light on it slightly in front.
+    float frontDist = 0.0f;
+    frontDist += normal.x * (normal.x > 0.0f ? box.max.x - point.x : box.min.x - point.x);
+    frontDist += normal.y * (normal.y > 0.0f ? box.max.y - point.y : box.min.y - point.y);
+    frontDist += normal.z * (normal.z > 0.0f ? box.max.z - point.z : box.min.z - point.z);
+    if (frontDist < 0.0f) return false;
+
+    //Too faint: the closest any light can be is the distance to the box, the cosine is at most 1
+    float dx = std::max(std::max(box.min.x - point.x, point.x - box.max.x), 0.0f);
+    float dy = std::max(std::max(box.min.y - point.y, point.y - box.max.y), 0.0f);
+    float dz = std::max(std::max(box.min.z - point.z, point.z - box.max.z), 0.0f);
+    float minDistSq = dx * dx + dy * dy + dz * dz;
+    return node.intensity * maxAlbedo >= threshold * 4 * PI * minDistSq;
+  }
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "AABB.h"
+#include "PointLight.h"
+#include "Constants.h"
+#include <vector>
+
+namespace ChaosCampAM {
+
+  //A node of the light tree - laid out like BVHNode:
+  // - Leaf (lightCount > 0): 'offset' is the position of the first light in the light index list of the tree.
+  // - Interior (lightCount == 0): the left child is stored right after the node, 'offset' is the index of the right child.
+  struct LightNode {
+    AABB bounds; //bounds of the light positions
+    float intensity; //sum of the intensities of all lights below the node
+    int offset;
+    int lightCount;
+
+    bool isLeaf() const { return lightCount > 0; }
+  };
+
+  /*
+  * Bounding volume hierarchy over the point lights of a scene.
+  * Every node bounds the positions of its lights and sums up their intensities, which bounds what the lights of a
+  * whole subtree may add to a shaded point. Subtrees that lie entirely behind the surface, or are too faint to matter,
+  * are skipped without looking at their lights one by one.
+  * Lights within a leaf keep the order of the scene, so a scene with at most LIGHT_TREE_MAX_LEAF_SIZE lights is a single
+  * leaf, visited in scene order.
+  */
+  class LightTree {
+  public:
+    LightTree() {}
+
+    //Build the tree over the given lights. Light 'i' is referenced by index 'i' in the leaves.
+    void build(const std::vector<PointLight>& lights);
+
+    //Visit the lights that may add more than 'threshold' to a point with normal 'normal' of a diffuse surface whose
+    //albedo is at most 'maxAlbedo' in any channel. Lights behind the surface are never visited.
+    //'lightFunc(int lightIndex)' is called for every such light.
+    template<typename LightFunc>
+    void traverse(const Vector3& point, const Vector3& normal, float maxAlbedo, float threshold,
+      LightFunc lightFunc) const;
+
+    bool isEmpty() const { return nodes.empty(); }
+    const std::vector<LightNode>& getNodes() const { return nodes; }
+    const std::vector<int>& getLightIndices() const { return lightIndices; }
+
+  private:
+    //Build the subtree over lightIndices[first; first + count) and return the index of its root node
+    int buildNode(const std::vector<PointLight>& lights, int first, int count, int depth);
+
+    //Whether the lights of a node may add more than 'threshold' to the point (see traverse())
+    static bool mayContribute(const LightNode& node, const Vector3& point, const Vector3& normal, float maxAlbedo,
+      float threshold);
+
+    std::vector<LightNode> nodes;
+    std::vector<int> lightIndices;
+  };
+
+  template<typename LightFunc>
+  void LightTree::traverse(const Vector3& point, const Vector3& normal, float maxAlbedo, float threshold,
+    LightFunc lightFunc) const {
+    if (nodes.empty()) return;
+
+    //Left children are visited before right ones - leaves are reached in the order of the light index list
+    int stack[BVH_MAX_DEPTH];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+      const LightNode& node = nodes[stack[--stackSize]];
+      if (!mayContribute(node, point, normal, maxAlbedo, threshold)) continue;
+      if (node.isLeaf()) {
+        for (int i = node.offset; i < node.offset + node.lightCount; i++) {
+          lightFunc(lightIndices[i]);
+        }
+      }
+      else {
+        int nodeIndex = (int)(&node - nodes.data());
+        stack[stackSize++] = node.offset;
+        stack[stackSize++] = nodeIndex + 1;
+      }
+    }
+  }
+}
@@ -0,0 +1,92 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ChaosCampAM {
+
+  MappedFile::~MappedFile() {
+    close();
+  }
+
+#ifdef _WIN32
+  bool MappedFile::open(const std::string& filename, bool writable) {
+    close();
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+      CloseHandle(file);
+      return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, writable ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+      CloseHandle(file);
+      return false;
+    }
+    void* view = MapViewOfFile(mapping, writable ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+    if (view == NULL) {
+      CloseHandle(mapping);
+      CloseHandle(file);
+      return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = (const uint8_t*)view;
+    size = (size_t)fileSize.QuadPart;
+    this->writable = writable;
+    return true;
+  }
+
+  void MappedFile::close() {
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    data = nullptr;
+    size = 0;
+    writable = false;
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+  }
+#else
+  bool MappedFile::open(const std::string& filename, bool writable) {
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+      ::close(fd);
+      return false;
+    }
+    int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* view = mmap(nullptr, (size_t)fileStat.st_size, protection, MAP_PRIVATE, fd, 0);
+    //The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+
+    data = (const uint8_t*)view;
+    size = (size_t)fileStat.st_size;
+    this->writable = writable;
+    return true;
+  }
+
+  void MappedFile::close() {
+    if (data) munmap((void*)data, size);
+    data = nullptr;
+    size = 0;
+    writable = false;
+  }
+#endif
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ChaosCampAM {
+
+  /*
+  * Read-only memory mapping of a whole file (mmap on POSIX systems, a file mapping object on Windows).
+  * Pages are loaded by the OS on first access and shared with the page cache, so opening a file costs next to nothing.
+  * The mapping is released on destruction; the object cannot be copied.
+  * A writable mapping is private (copy-on-write): pages are copied on the first write, the file itself never changes.
+  */
+  class MappedFile {
+  public:
+    MappedFile() {}
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    //Map the given file. Returns false (and stays closed) if the file cannot be opened or mapped, or is empty.
+    //'writable' gives a private copy-on-write mapping, which may be modified through getWritableData().
+    bool open(const std::string& filename, bool writable = false);
+    void close();
+
+    bool isOpen() const { return data != nullptr; }
+    const uint8_t* getData() const { return data; }
+    //Only valid for a writable mapping
+    uint8_t* getWritableData() { return writable ? const_cast<uint8_t*>(data) : nullptr; }
+    size_t getSize() const { return size; }
+
+  private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    bool writable = false;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+  };
+}
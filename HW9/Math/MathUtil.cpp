@@ -1,12 +1,12 @@
-#include "MathUtil.h"
-
-namespace ChaosCampAM {
-
-  float degToRad(float angle) {
-    return angle * TO_RAD_CONST;
-  }
-
-  float radToDeg(float angle) {
-    return angle * TO_DEG_CONST;
-  }
+#include "MathUtil.h"
+
+namespace ChaosCampAM {
+
+  float degToRad(float angle) {
+    return angle * TO_RAD_CONST;
+  }
+
+  float radToDeg(float angle) {
+    return angle * TO_DEG_CONST;
+  }
 }
\ No newline at end of file
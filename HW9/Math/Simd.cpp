@@ -0,0 +1,38 @@
+#include "Simd.h"
+
+#if defined(CHAOS_SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ChaosCampAM {
+
+  static SimdLevel detectSimdLevel() {
+#if defined(CHAOS_SIMD_X86) && defined(_MSC_VER)
+    //AVX2 needs both the CPU flag (leaf 7, EBX bit 5) and OS support for saving YMM registers (OSXSAVE + XCR0)
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    if (osxsave && avx2 && (_xgetbv(0) & 6) == 6) return SimdLevel::AVX2;
+    return SimdLevel::SSE;
+#elif defined(CHAOS_SIMD_X86)
+    //The builtin also verifies that the OS saves the YMM registers
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 : SimdLevel::SSE;
+#else
+    return SimdLevel::Scalar;
+#endif
+  }
+
+  static const SimdLevel supportedLevel = detectSimdLevel();
+  static SimdLevel activeLevel = supportedLevel;
+
+  SimdLevel getSimdLevel() {
+    return activeLevel;
+  }
+
+  void setSimdLevel(SimdLevel level) {
+    activeLevel = level > supportedLevel ? supportedLevel : level;
+  }
+}
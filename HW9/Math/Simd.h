@@ -0,0 +1,26 @@
+#pragma once
+
+//Hand-vectorised kernels are only compiled for x86/x64. Everywhere else the scalar fallbacks are used.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CHAOS_SIMD_X86
+#endif
+
+//Functions using AVX2 intrinsics must be marked with CHAOS_TARGET_AVX2 (MSVC accepts the intrinsics anywhere,
+//GCC and Clang need the target attribute) and may only be called once getSimdLevel() reported AVX2 support.
+#if defined(CHAOS_SIMD_X86) && (!defined(_MSC_VER) || defined(__clang__))
+#define CHAOS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CHAOS_TARGET_AVX2
+#endif
+
+namespace ChaosCampAM {
+  //Instruction sets the vectorised kernels can be dispatched to, from narrowest to widest.
+  enum class SimdLevel { Scalar, SSE, AVX2 };
+
+  //Widest level supported by the CPU (detected once at startup), unless a narrower one was forced with setSimdLevel().
+  SimdLevel getSimdLevel();
+
+  //Force the kernels down to a narrower level, e.g. to compare them against the scalar fallback.
+  //Levels above what the CPU supports are clamped.
+  void setSimdLevel(SimdLevel level);
+}
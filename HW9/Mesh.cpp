@@ -1,94 +1,264 @@
-#include"Mesh.h"
-#include"Triangle.h"
-#include"Math/MathUtil.h"
-#include<assert.h>
-
-namespace ChaosCampAM {
-
-  Mesh::Mesh(int vertexHint, int triangleHint) {
-    vertexList.reserve(vertexHint);
-    vertexNormalList.reserve(vertexHint);
-    triIndexList.reserve(triangleHint);
-  }
-
-  Mesh::Mesh(const std::vector<Vector3>& vertices, const std::vector<TriProxy>& triangles, int matIndex) :
-    vertexList(vertices), triIndexList(triangles), matIndex(matIndex) {
-    recalculateNormals();
-  }
-
-  void Mesh::pushVertex(const Vector3& vert) {
-    vertexList.push_back(vert);
-  }
-
-  void Mesh::pushTriangle(const TriProxy& tri) {
-    triIndexList.push_back(tri);
-  }
-
-  void Mesh::setMatIndex(int newMatIndex) {
-    matIndex = newMatIndex;
-  }
-
-  void Mesh::recalculateNormals() {
-    //Normal list has the same size as vertex list and initialise with zero vectors.
-    vertexNormalList.reserve(vertexList.size());
-    vertexNormalList.assign(vertexList.size(), Vector3());
-
-    //Loop through all triangles and add normal contribution to the list of normal vectors (for corresponding vertex)
-    for (TriProxy& tri : triIndexList) {
-      Vector3 triNormal = Triangle(vertexList[tri.v0], vertexList[tri.v1], vertexList[tri.v2]).normal();
-      vertexNormalList[tri.v0] = vertexNormalList[tri.v0] + triNormal;
-      vertexNormalList[tri.v1] = vertexNormalList[tri.v1] + triNormal;
-      vertexNormalList[tri.v2] = vertexNormalList[tri.v2] + triNormal;
-    }
-
-    //Normalise all vertex normals
-    for (Vector3& vertNormal : vertexNormalList) {
-      vertNormal.normalize();
-    }
-  }
-
-  float Mesh::intersect(const Ray& ray, InfoIntersect& intersectInfo, int& triIndex) const {
-    //For each triangle index tuple, construct an actual triangle object and test for intersection
-    float closestDist = FLT_MAX;
-    InfoIntersect closestIntersect;
-    intersectInfo.hasIntersection = false;
-
-    int index = 0;
-    for (TriProxy tri : triIndexList) {
-      //ensure valid indices
-      int vertexCount = vertexList.size();
-      assert(tri.v0 < vertexCount && tri.v1 < vertexCount && tri.v2 < vertexCount);
-
-      //construct actual triangle object and intersect
-      Triangle realTri(vertexList.at(tri.v0), vertexList.at(tri.v1), vertexList.at(tri.v2));
-      float dist = realTri.intersect(ray, closestIntersect);
-
-      //keep only closest intersection
-      if (closestIntersect.hasIntersection && dist < closestDist) {
-        closestDist = dist;
-        intersectInfo = closestIntersect;
-        triIndex = index;
-      }
-      index++;
-    }
-
-    //Return -1.0f if no intersection occurred
-    return intersectInfo.hasIntersection ? closestDist : -1.0f;
-  }
-
-  int Mesh::getNumTriangles() const {
-    return triIndexList.size();
-  }
-  int Mesh::getMatIndex() const {
-    return matIndex;
-  }
-  const std::vector<Vector3>& Mesh::getVertices() const {
-    return vertexList;
-  }
-  const std::vector<TriProxy>& Mesh::getTriangles() const {
-    return triIndexList;
-  }
-  const std::vector<Vector3>& Mesh::getVertNormals() const {
-    return vertexNormalList;
-  }
+#include"Mesh.h"
+#include"Triangle.h"
+#include"Math/MathUtil.h"
+#include"BinaryIO.h"
+#include"ThreadPool.h"
+#include<iostream>
+#include<sstream>
+#include<assert.h>
+
+namespace ChaosCampAM {
+
+  Mesh::Mesh(int vertexHint, int triangleHint) {
+    vertexList.reserve(vertexHint);
+    vertexNormalList.reserve(vertexHint);
+    triIndexList.reserve(triangleHint);
+  }
+
+  Mesh::Mesh(const std::vector<Vector3>& vertices, const std::vector<TriProxy>& triangles, int matIndex,
+    BVHBuildMode buildMode) :
+    Mesh(std::vector<Vector3>(vertices), std::vector<TriProxy>(triangles), matIndex, buildMode) {}
+
+  Mesh::Mesh(std::vector<Vector3>&& vertices, std::vector<TriProxy>&& triangles, int matIndex,
+    BVHBuildMode buildMode) :
+    vertexList(std::move(vertices)), triIndexList(std::move(triangles)), matIndex(matIndex) {
+    recalculateNormals();
+    buildBVH(buildMode);
+  }
+
+  void Mesh::pushVertex(const Vector3& vert) {
+    vertexList.push_back(vert);
+  }
+
+  void Mesh::pushTriangle(const TriProxy& tri) {
+    triIndexList.push_back(tri);
+  }
+
+  void Mesh::setMatIndex(int newMatIndex) {
+    matIndex = newMatIndex;
+  }
+
+  void Mesh::recalculateNormals() {
+    //Normal list has the same size as vertex list and initialise with zero vectors.
+    std::vector<Vector3> normals(vertexList.size(), Vector3());
+
+    //Loop through all triangles and add normal contribution to the list of normal vectors (for corresponding vertex)
+    for (const TriProxy& tri : triIndexList) {
+      Vector3 triNormal = Triangle(vertexList[tri.v0], vertexList[tri.v1], vertexList[tri.v2]).normal();
+      normals[tri.v0] = normals[tri.v0] + triNormal;
+      normals[tri.v1] = normals[tri.v1] + triNormal;
+      normals[tri.v2] = normals[tri.v2] + triNormal;
+    }
+
+    //Normalise all vertex normals
+    for (Vector3& vertNormal : normals) {
+      vertNormal.normalize();
+    }
+    vertexNormalList = std::move(normals);
+  }
+
+  void Mesh::buildBVH(BVHBuildMode mode) {
+    //The hierarchy is built over the bounding boxes of the triangles. Leaves are intersected a block at a time.
+    std::vector<AABB> triBounds(triIndexList.size());
+    std::vector<Vector3> faceNormals(triIndexList.size());
+    for (int i = 0; i < (int)triIndexList.size(); i++) {
+      //Indices are valid - the parsers check them on load
+      const TriProxy& tri = triIndexList[i];
+      triBounds[i].expand(vertexList[tri.v0]);
+      triBounds[i].expand(vertexList[tri.v1]);
+      triBounds[i].expand(vertexList[tri.v2]);
+      faceNormals[i] = Triangle(vertexList[tri.v0], vertexList[tri.v1], vertexList[tri.v2]).normal();
+    }
+    //Traversal uses the 8-wide version of the binary hierarchy, which shares its leaves and primitive order
+    BVH binaryBVH;
+    binaryBVH.build(triBounds, TRI_BLOCK_SIZE, &ThreadPool::getDefault(), mode);
+    bvh.build(binaryBVH);
+    triNormals = std::move(faceNormals);
+
+    //Pack the triangles of every leaf into blocks. Nodes are stored depth-first, so leaves come in primitive order.
+    const DataArray<int>& triOrder = bvh.getPrimIndices();
+    std::vector<TriBlock> blocks;
+    std::vector<int> firstBlock(triOrder.size(), -1);
+    for (const BVHNode& node : binaryBVH.getNodes()) {
+      if (!node.isLeaf()) continue;
+      firstBlock[node.offset] = blocks.size();
+      for (int i = 0; i < node.primCount; i++) {
+        if (i % TRI_BLOCK_SIZE == 0) blocks.emplace_back();
+        int index = triOrder[node.offset + i];
+        const TriProxy& tri = triIndexList[index];
+        blocks.back().setLane(i % TRI_BLOCK_SIZE, vertexList[tri.v0], vertexList[tri.v1], vertexList[tri.v2], index);
+      }
+    }
+    triBlocks = std::move(blocks);
+    leafFirstBlock = std::move(firstBlock);
+
+    //Report the build as a single line, meshes may be built concurrently
+    const BVHBuildStats& stats = bvh.getBuildStats();
+    std::ostringstream report;
+    report << "Mesh BVH (" << (stats.mode == BVHBuildMode::LBVH ? "LBVH" : "SAH") << "): " << triIndexList.size() <<
+      " triangles, " << stats.nodeCount << " nodes (" << stats.leafCount << " leaves), SAH cost " << stats.sahCost <<
+      ", " << bvh.getNodes().size() << " BVH8 nodes (" << bvh.getNodes().size() * sizeof(WideBVHNode) / 1024 <<
+      " KB, binary " << stats.nodeCount * sizeof(BVHNode) / 1024 << " KB), built in " << stats.buildTimeMs << " ms\n";
+    std::cout << report.str();
+  }
+
+  float Mesh::intersect(const Ray& ray, InfoIntersect& intersectInfo, int& triIndex, float tMax) const {
+    Vector3 origin = ray.getOrigin();
+    Vector3 dir = ray.getDirection();
+    float closestDist = tMax;
+    int closestTri = -1;
+    float closestU = 0.0f;
+    float closestV = 0.0f;
+    intersectInfo.hasIntersection = false;
+
+    //Walk the BVH front-to-back. Subtrees the ray enters behind the closest hit found so far are skipped.
+    //The triangles of a leaf are tested a whole block at a time.
+    bvh.traverse(ray, closestDist, [&](int first, int count) {
+      int blockBegin = leafFirstBlock[first];
+      int blockEnd = blockBegin + (count + TRI_BLOCK_SIZE - 1) / TRI_BLOCK_SIZE;
+      float dist, u, v;
+      for (int b = blockBegin; b < blockEnd; b++) {
+        //keep only closest intersection
+        int lane = intersectTriBlock(triBlocks[b], origin, dir, closestDist, dist, u, v);
+        if (lane >= 0) {
+          closestDist = dist;
+          closestTri = triBlocks[b].triIndex[lane];
+          closestU = u;
+          closestV = v;
+        }
+      }
+      return false;
+    });
+
+    //Return -1.0f if no intersection occurred
+    if (closestTri < 0) return -1.0f;
+
+    //Fill up intersection info (to be used for shading later) for the closest hit only
+    intersectInfo.triNormal = triNormals[closestTri];
+    intersectInfo.intersectionPoint = ray.getPointOnRay(closestDist);
+    intersectInfo.coords[0] = 1.0f - closestU - closestV;
+    intersectInfo.coords[1] = closestU;
+    intersectInfo.coords[2] = closestV;
+    intersectInfo.hasIntersection = true;
+    triIndex = closestTri;
+    return closestDist;
+  }
+
+  uint64_t Mesh::intersect(const RayPacket& packet, PacketHits& hits) const {
+    uint64_t hitMask = 0;
+    float tMax = hits.maxDist();
+
+    //Leaves are culled for the whole packet during traversal, then for each group of rays against the leaf box
+    bvh.traversePacket(packet, tMax, [&](int first, int count, const AABB& leafBounds) {
+      int groupMask = packet.intersectBoxGroups(leafBounds, hits.dist);
+      if (!groupMask) return false;
+
+      int blockBegin = leafFirstBlock[first];
+      int blockEnd = blockBegin + (count + TRI_BLOCK_SIZE - 1) / TRI_BLOCK_SIZE;
+      uint64_t leafHits = 0;
+      for (int b = blockBegin; b < blockEnd; b++) {
+        leafHits |= intersectTriBlockPacket(triBlocks[b], packet, groupMask, hits);
+      }
+      if (leafHits) {
+        hitMask |= leafHits;
+        tMax = hits.maxDist();
+      }
+      return false;
+    });
+    return hitMask;
+  }
+
+  bool Mesh::occluded(const Ray& ray, float tMax, int* blockIndex) const {
+    Vector3 origin = ray.getOrigin();
+    Vector3 dir = ray.getDirection();
+    bool hit = false;
+    bvh.traverse(ray, tMax, [&](int first, int count) {
+      int blockBegin = leafFirstBlock[first];
+      int blockEnd = blockBegin + (count + TRI_BLOCK_SIZE - 1) / TRI_BLOCK_SIZE;
+      for (int b = blockBegin; b < blockEnd && !hit; b++) {
+        hit = occludesTriBlock(triBlocks[b], origin, dir, tMax);
+        if (hit && blockIndex) *blockIndex = b;
+      }
+      return hit; //first blocker terminates the traversal
+    });
+    return hit;
+  }
+
+  bool Mesh::occludedByBlock(const Ray& ray, float tMax, int blockIndex) const {
+    assert(blockIndex >= 0 && blockIndex < (int)triBlocks.size());
+    return occludesTriBlock(triBlocks[blockIndex], ray.getOrigin(), ray.getDirection(), tMax);
+  }
+
+  int Mesh::getNumTriangles() const {
+    return triIndexList.size();
+  }
+  int Mesh::getMatIndex() const {
+    return matIndex;
+  }
+  const DataArray<Vector3>& Mesh::getVertices() const {
+    return vertexList;
+  }
+  const DataArray<TriProxy>& Mesh::getTriangles() const {
+    return triIndexList;
+  }
+  const DataArray<Vector3>& Mesh::getVertNormals() const {
+    return vertexNormalList;
+  }
+  const DataArray<Vector3>& Mesh::getTriNormals() const {
+    return triNormals;
+  }
+  const WideBVH& Mesh::getBVH() const {
+    return bvh;
+  }
+
+  bool Mesh::isValid(int materialCount) const {
+    int vertexCount = (int)vertexList.size();
+    int triangleCount = (int)triIndexList.size();
+    if (matIndex < 0 || matIndex >= materialCount) return false;
+    if (vertexNormalList.size() != vertexList.size() || triNormals.size() != triIndexList.size()) return false;
+    for (const TriProxy& tri : triIndexList) {
+      if (tri.v0 < 0 || tri.v0 >= vertexCount || tri.v1 < 0 || tri.v1 >= vertexCount || tri.v2 < 0 ||
+        tri.v2 >= vertexCount) {
+        return false;
+      }
+    }
+
+    if (!bvh.isValid(triangleCount) || leafFirstBlock.size() != (size_t)triangleCount) return false;
+    for (const TriBlock& block : triBlocks) {
+      for (int lane = 0; lane < TRI_BLOCK_SIZE; lane++) {
+        //-1 for unused lanes
+        if (block.triIndex[lane] < -1 || block.triIndex[lane] >= triangleCount) return false;
+      }
+    }
+    //Every leaf must find all its blocks
+    int blockCount = (int)triBlocks.size();
+    for (const WideBVHNode& node : bvh.getNodes()) {
+      for (int slot = 0; slot < node.childCount; slot++) {
+        if (node.primCount[slot] <= 0) continue;
+        int first = leafFirstBlock[node.child[slot]];
+        int count = (node.primCount[slot] + TRI_BLOCK_SIZE - 1) / TRI_BLOCK_SIZE;
+        if (first < 0 || first > blockCount - count) return false;
+      }
+    }
+    return true;
+  }
+
+  void Mesh::write(BinaryWriter& writer) const {
+    writer.write((int32_t)matIndex);
+    writer.writeArray(vertexList);
+    writer.writeArray(vertexNormalList);
+    writer.writeArray(triIndexList);
+    writer.writeArray(triNormals);
+    bvh.write(writer);
+    writer.writeArray(triBlocks);
+    writer.writeArray(leafFirstBlock);
+  }
+
+  bool Mesh::read(BinaryReader& reader) {
+    int32_t storedMatIndex;
+    if (!reader.read(storedMatIndex)) return false;
+    matIndex = storedMatIndex;
+    return reader.readArray(vertexList) && reader.readArray(vertexNormalList) && reader.readArray(triIndexList) &&
+      reader.readArray(triNormals) && bvh.read(reader) && reader.readArray(triBlocks) && reader.readArray(leafFirstBlock);
+  }
 }
\ No newline at end of file
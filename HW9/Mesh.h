@@ -1,69 +1,119 @@
-#pragma once
-#include<vector>
-#include "Math/Vector3.h"
-
-namespace ChaosCampAM {
-
-  //Forward-delcare
-  class Ray;
-  class InfoIntersect;
-
-  //A 3-tuple of vertex indices.
-  //Used instead of a Triangle in the mesh class to avoid duplicated vertices. 
-  struct TriProxy {
-    int v0;
-    int v1;
-    int v2;
-    TriProxy(int vert0, int vert1, int vert2) :v0(vert0), v1(vert1), v2(vert2) {}
-  };
-
-  /*
-  * A geometry mesh, composed of triangles.
-  */
-  class Mesh {
-  public:
-    //Construct an empty mesh.
-    //Use 'vertexHint' and 'triangleHint' to reserve memory at construction time.
-    // - 'vertexHint' = number of vertices to reserve.
-    // - 'triangleHint' = number of triangle index tuples to reserve.
-    Mesh(int vertexHint = 100, int triangleHint = 100);
-
-    //Construct a mesh.
-    // - 'vertices' must specify the list of vertices in the mesh.
-    // - 'triangles' must specifiy the list of triangles (each triangle is given as a tuple of indices in the vertex list)
-    // in the mesh.
-    Mesh(const std::vector<Vector3>& vertices, const std::vector<TriProxy>& triangles, int matIndex);
-
-    //Add a vertex to the mesh.
-    void pushVertex(const Vector3& vert);
-
-    //Add a triangle to the mesh. For memory optimisation purposes, the triangle is given as a 3-tuple of vertex indices.
-    void pushTriangle(const TriProxy& tri);
-
-    //Set material index
-    void setMatIndex(int newMatIndex);
-
-    //Uses the current information for mesh vertices and triangles to calculate a normal vector for each vertex.
-    void recalculateNormals();
-
-    //Intersect a ray with the given mesh. 
-    // - Returns the distance from the ray origin to the closest intersection point if such exists. Modifies 'intersection'
-    // to store the intersection point.
-    // - Returns -1.0 (negative value) otherwise.
-    float intersect(const Ray& ray, InfoIntersect& intersectInfo, int& triIndex) const;
-
-    int getNumTriangles() const;
-    int getMatIndex() const;
-
-    const std::vector<Vector3>& getVertices() const;
-    const std::vector<TriProxy>& getTriangles() const;
-    const std::vector<Vector3>& getVertNormals() const;
-
-  private:
-    std::vector<Vector3> vertexList;
-    std::vector<Vector3> vertexNormalList;
-    std::vector<TriProxy> triIndexList;
-    int matIndex;
-  };
-
-}
+#pragma once
+#include<vector>
+#include "Math/Vector3.h"
+#include "WideBVH.h"
+#include "TriangleBlock.h"
+
+namespace ChaosCampAM {
+
+  //Forward-delcare
+  class Ray;
+  struct InfoIntersect;
+  class BinaryWriter;
+  class BinaryReader;
+
+  //A 3-tuple of vertex indices.
+  //Used instead of a Triangle in the mesh class to avoid duplicated vertices. 
+  struct TriProxy {
+    int v0;
+    int v1;
+    int v2;
+    TriProxy(int vert0, int vert1, int vert2) :v0(vert0), v1(vert1), v2(vert2) {}
+  };
+
+  /*
+  * A geometry mesh, composed of triangles.
+  */
+  class Mesh {
+  public:
+    //Construct an empty mesh.
+    //Use 'vertexHint' and 'triangleHint' to reserve memory at construction time.
+    // - 'vertexHint' = number of vertices to reserve.
+    // - 'triangleHint' = number of triangle index tuples to reserve.
+    Mesh(int vertexHint = 100, int triangleHint = 100);
+
+    //Construct a mesh.
+    // - 'vertices' must specify the list of vertices in the mesh.
+    // - 'triangles' must specifiy the list of triangles (each triangle is given as a tuple of indices in the vertex list)
+    // in the mesh. Every index must refer to one of 'vertices' - they are not checked again (the parsers do on load).
+    //Vertex normals and the acceleration structure (built as given by 'buildMode') are computed right away.
+    Mesh(const std::vector<Vector3>& vertices, const std::vector<TriProxy>& triangles, int matIndex,
+      BVHBuildMode buildMode = BVHBuildMode::SAH);
+    //Same, taking over the storage of 'vertices' and 'triangles' instead of copying them.
+    Mesh(std::vector<Vector3>&& vertices, std::vector<TriProxy>&& triangles, int matIndex,
+      BVHBuildMode buildMode = BVHBuildMode::SAH);
+
+    //Add a vertex to the mesh.
+    void pushVertex(const Vector3& vert);
+
+    //Add a triangle to the mesh. For memory optimisation purposes, the triangle is given as a 3-tuple of vertex indices.
+    void pushTriangle(const TriProxy& tri);
+
+    //Set material index
+    void setMatIndex(int newMatIndex);
+
+    //Uses the current information for mesh vertices and triangles to calculate a normal vector for each vertex.
+    void recalculateNormals();
+
+    //Uses the current information for mesh vertices and triangles to (re)build the bounding volume hierarchy,
+    //the triangle blocks its leaves point to and the face normals.
+    //Must be called after the geometry has been modified, before the mesh is intersected.
+    //The hierarchy is built on ThreadPool::getDefault(). Build time, node count and SAH cost are printed to stdout.
+    //LBVH builds much faster than SAH, but the mesh traces slower (see BVHBuildMode).
+    void buildBVH(BVHBuildMode mode = BVHBuildMode::SAH);
+
+    //Intersect a ray with the given mesh. 
+    // - Returns the distance from the ray origin to the closest intersection point if such exists. Modifies 'intersection'
+    // to store the intersection point.
+    // - Returns -1.0 (negative value) otherwise.
+    //Only hits closer than 'tMax' are reported (e.g. the closest hit already found in other meshes).
+    float intersect(const Ray& ray, InfoIntersect& intersectInfo, int& triIndex, float tMax = FLT_MAX) const;
+
+    //Closest-hit test of a packet of rays. Ray 'i' only accepts hits closer than hits.dist[i]; closer hits replace its
+    //entries in 'hits'. Returns a bit mask of the rays whose hit was replaced.
+    //Every ray gets the hit intersect() finds for it.
+    uint64_t intersect(const RayPacket& packet, PacketHits& hits) const;
+
+    //Any-hit query - true if any triangle of the mesh blocks the ray closer than 'tMax'.
+    //Stops at the first blocker found and does not compute any intersection info. Meant for shadow rays.
+    //'blockIndex' (if given) receives the triangle block the blocker was found in.
+    bool occluded(const Ray& ray, float tMax, int* blockIndex = nullptr) const;
+    //Any-hit query against the triangles of a single block (as reported by occluded()) - same test as occluded() runs
+    //on the block, without traversing the BVH.
+    bool occludedByBlock(const Ray& ray, float tMax, int blockIndex) const;
+
+    int getNumTriangles() const;
+    int getMatIndex() const;
+
+    const DataArray<Vector3>& getVertices() const;
+    const DataArray<TriProxy>& getTriangles() const;
+    const DataArray<Vector3>& getVertNormals() const;
+    const DataArray<Vector3>& getTriNormals() const;
+    const WideBVH& getBVH() const;
+
+    //True if the mesh can be rendered safely with 'materialCount' materials: its material and every vertex index
+    //exist, the normals match the vertices and triangles, and the BVH and triangle blocks stay within the mesh.
+    //Checked on restored meshes, which are not trusted.
+    bool isValid(int materialCount) const;
+
+    //Store the mesh with its normals and acceleration structure in a binary scene file / restore it from one
+    //(see SceneCache). A restored mesh is ready to render, its arrays are views into the mapped file.
+    //Returns false if the data is truncated.
+    void write(BinaryWriter& writer) const;
+    bool read(BinaryReader& reader);
+
+  private:
+    DataArray<Vector3> vertexList;
+    DataArray<Vector3> vertexNormalList;
+    DataArray<TriProxy> triIndexList;
+    WideBVH bvh;
+    //Triangles in SIMD-friendly blocks, in BVH leaf order. Every leaf starts a new block.
+    DataArray<TriBlock> triBlocks;
+    //First block of each leaf, indexed by the position of the leaf's first primitive in the BVH order
+    DataArray<int> leafFirstBlock;
+    //Unit face normal of each triangle, for filling in the hit information
+    DataArray<Vector3> triNormals;
+    int matIndex;
+  };
+
+}
@@ -0,0 +1,52 @@
+#include "MeshInstance.h"
+
+namespace ChaosCampAM {
+
+  MeshInstance::MeshInstance(int meshIndex, const Matrix3x3& transform, const Vector3& translation, int matIndex) :
+    meshIndex(meshIndex), matIndex(matIndex), transform(transform), translation(translation),
+    invTransform(transform.getInverse()), normalTransform(invTransform.getTranspose()) {}
+
+  int MeshInstance::getMeshIndex() const {
+    return meshIndex;
+  }
+
+  int MeshInstance::getMatIndex() const {
+    return matIndex;
+  }
+
+  const Matrix3x3& MeshInstance::getTransform() const {
+    return transform;
+  }
+
+  const Vector3& MeshInstance::getTranslation() const {
+    return translation;
+  }
+
+  Ray MeshInstance::toObjectSpace(const Ray& worldRay, float& scale) const {
+    Vector3 dir = invTransform * worldRay.getDirection();
+    //The world direction has unit length
+    scale = dir.getLen();
+    return Ray(invTransform * (worldRay.getOrigin() - translation), dir);
+  }
+
+  Vector3 MeshInstance::normalToWorld(const Vector3& normal) const {
+    Vector3 worldNormal = normalTransform * normal;
+    worldNormal.normalize();
+    return worldNormal;
+  }
+
+  AABB MeshInstance::boundsToWorld(const AABB& objectBounds) const {
+    //An empty box stays empty
+    if (objectBounds.min.x > objectBounds.max.x) return objectBounds;
+
+    //Bounds of the eight transformed corners
+    AABB worldBounds;
+    for (int corner = 0; corner < 8; corner++) {
+      Vector3 point((corner & 1) ? objectBounds.max.x : objectBounds.min.x,
+        (corner & 2) ? objectBounds.max.y : objectBounds.min.y,
+        (corner & 4) ? objectBounds.max.z : objectBounds.min.z);
+      worldBounds.expand(transform * point + translation);
+    }
+    return worldBounds;
+  }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "Math/Vector3.h"
+#include "Math/Matrix3x3.h"
+#include "AABB.h"
+#include "Ray.h"
+
+namespace ChaosCampAM {
+
+  /*
+  * A placement of a shared mesh in the scene: the mesh transformed by a linear part (rotation, scale, shear) and a
+  * translation, optionally with a material of its own. Any number of instances may refer to the same mesh, whose
+  * geometry and acceleration structure are stored only once.
+  * Rays are intersected with an instance by taking them into the object space of its mesh.
+  */
+  class MeshInstance {
+  public:
+    //'meshIndex' refers to Scene::getMeshes(). 'transform' must not be singular.
+    //'matIndex' overrides the material of the mesh, -1 keeps it.
+    MeshInstance(int meshIndex, const Matrix3x3& transform, const Vector3& translation, int matIndex = -1);
+
+    int getMeshIndex() const;
+    //Material override, -1 if the instance uses the material of its mesh
+    int getMatIndex() const;
+    const Matrix3x3& getTransform() const;
+    const Vector3& getTranslation() const;
+
+    //Take a world ray into the object space of the mesh. The direction is normalised again, so distances along
+    //the object ray are 'scale' times the distances along the world ray.
+    Ray toObjectSpace(const Ray& worldRay, float& scale) const;
+
+    //Take a normal from object space to world space (by the inverse transpose of the transform), normalised.
+    Vector3 normalToWorld(const Vector3& normal) const;
+
+    //World bounds of a box given in object space
+    AABB boundsToWorld(const AABB& objectBounds) const;
+
+  private:
+    int meshIndex;
+    int matIndex;
+    Matrix3x3 transform;
+    Vector3 translation;
+    Matrix3x3 invTransform;
+    Matrix3x3 normalTransform; //inverse transpose of 'transform'
+  };
+}
@@ -0,0 +1,224 @@
+#include "NumberParser.h"
+#include "Math/Simd.h"
+#include <cfloat>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#ifdef CHAOS_SIMD_X86
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//The scanners below use SSE2 only, which every x64 CPU supports - there is no need to dispatch on getSimdLevel().
+
+namespace ChaosCampAM {
+
+  //Powers of ten that are exact in double precision
+  static const double EXACT_POW10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  static const int MAX_EXACT_POW10 = 22;
+
+  //Any number of up to 19 decimal digits fits a 64-bit mantissa
+  static const int MAX_MANTISSA_DIGITS = 19;
+
+  static bool isDigit(char c) {
+    return (unsigned char)(c - '0') < 10;
+  }
+
+  //Index of the lowest set bit of a non-zero mask
+  static int lowestBit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+  }
+
+  static int bitCount(unsigned mask) {
+    int count = 0;
+    for (; mask; mask &= mask - 1) count++;
+    return count;
+  }
+
+#ifdef CHAOS_SIMD_X86
+  //Bit mask of the bytes among the 16 at 'pos' that are decimal digits
+  static unsigned digitMask(const char* pos) {
+    __m128i chars = _mm_loadu_si128((const __m128i*)pos);
+    //Digits are the bytes whose unsigned offset from '0' is at most 9
+    __m128i offset = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    __m128i digits = _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(9)), offset);
+    return (unsigned)_mm_movemask_epi8(digits);
+  }
+#endif
+
+  //Length of the run of decimal digits starting at 'begin'
+  static int digitRunLength(const char* begin, const char* end) {
+    const char* pos = begin;
+#ifdef CHAOS_SIMD_X86
+    while (end - pos >= 16) {
+      unsigned mask = digitMask(pos);
+      if (mask != 0xFFFF) return (int)(pos - begin) + lowestBit(~mask);
+      pos += 16;
+    }
+#endif
+    while (pos < end && isDigit(*pos)) pos++;
+    return (int)(pos - begin);
+  }
+
+  //Lengths of the integer part of the number at 'pos' and of its fraction (0 if there is no '.' after the integer part)
+  static void splitDigits(const char* pos, const char* end, int& intLength, int& fractionLength) {
+#ifdef CHAOS_SIMD_X86
+    //Both runs usually fit the same 16 bytes - one load is enough
+    if (end - pos >= 16) {
+      unsigned mask = digitMask(pos);
+      intLength = *pos == '0' ? 1 : lowestBit(~mask);
+      if (intLength == 16) intLength = digitRunLength(pos, end);
+      fractionLength = 0;
+      if (intLength < 15 && pos[intLength] == '.') {
+        fractionLength = lowestBit(~(mask >> (intLength + 1)));
+        if (intLength + 1 + fractionLength == 16) fractionLength = digitRunLength(pos + intLength + 1, end);
+      }
+      else if (intLength >= 15 && pos + intLength < end && pos[intLength] == '.') {
+        fractionLength = digitRunLength(pos + intLength + 1, end);
+      }
+      return;
+    }
+#endif
+    intLength = *pos == '0' ? 1 : digitRunLength(pos, end);
+    fractionLength = 0;
+    if (pos + intLength < end && pos[intLength] == '.') fractionLength = digitRunLength(pos + intLength + 1, end);
+  }
+
+  //Append 'count' digits to 'mantissa'. The caller makes sure the result stays below 10^19.
+  static uint64_t appendDigits(uint64_t mantissa, const char* digits, int count) {
+#ifdef CHAOS_SIMD_X86
+    //Eight digits at once - the bytes (little-endian) are combined pairwise into 2-, 4- and 8-digit numbers
+    for (; count >= 8; digits += 8, count -= 8) {
+      uint64_t chunk;
+      memcpy(&chunk, digits, 8);
+      chunk = ((chunk & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+      chunk = ((chunk & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+      chunk = ((chunk & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+      mantissa = mantissa * 100000000 + chunk;
+    }
+#endif
+    for (int i = 0; i < count; i++) {
+      mantissa = mantissa * 10 + (digits[i] - '0');
+    }
+    return mantissa;
+  }
+
+  const char* parseNumber(const char* begin, const char* end, double& value) {
+    //JSON grammar: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+    const char* pos = begin;
+    bool negative = pos < end && *pos == '-';
+    if (negative) pos++;
+    if (pos == end || !isDigit(*pos)) return begin;
+
+    int intLength, fractionLength;
+    splitDigits(pos, end, intLength, fractionLength);
+    bool zeroInteger = *pos == '0';
+    uint64_t mantissa = 0;
+    int mantissaDigits = zeroInteger ? 0 : intLength;
+    if (mantissaDigits + fractionLength <= MAX_MANTISSA_DIGITS) {
+      mantissa = appendDigits(mantissa, pos, mantissaDigits);
+      mantissa = appendDigits(mantissa, pos + intLength + 1, fractionLength);
+    }
+    pos += intLength;
+
+    bool isInteger = true;
+    int fractionDigits = 0;
+    if (pos < end && *pos == '.') {
+      if (fractionLength == 0) return begin;
+      mantissaDigits += fractionLength;
+      fractionDigits = fractionLength;
+      isInteger = false;
+      pos += 1 + fractionLength;
+    }
+
+    int exponent = 0;
+    if (pos < end && (*pos == 'e' || *pos == 'E')) {
+      pos++;
+      bool negativeExponent = pos < end && *pos == '-';
+      if (pos < end && (*pos == '-' || *pos == '+')) pos++;
+      if (pos == end || !isDigit(*pos)) return begin;
+      for (; pos < end && isDigit(*pos); pos++) {
+        //Large exponents overflow / underflow anyway, they only need to stay large
+        if (exponent < 100000) exponent = exponent * 10 + (*pos - '0');
+      }
+      if (negativeExponent) exponent = -exponent;
+      isInteger = false;
+    }
+
+    //Exact mantissa (at most 2^53, or no scaling at all) and an exact power of ten - a single rounding
+    int exp10 = exponent - fractionDigits;
+    if (mantissaDigits <= MAX_MANTISSA_DIGITS && (exp10 == 0 ||
+      (mantissa <= (1ULL << 53) && exp10 >= -MAX_EXACT_POW10 && exp10 <= MAX_EXACT_POW10))) {
+      value = (double)mantissa;
+      if (exp10 > 0) value *= EXACT_POW10[exp10];
+      else if (exp10 < 0) value /= EXACT_POW10[-exp10];
+    }
+    else {
+      //Too many digits or too large an exponent for the fast path
+      std::string text(negative ? begin + 1 : begin, pos);
+      value = strtod(text.c_str(), nullptr);
+      //Out of the range of double - rejected, as rapidjson does
+      if (value > DBL_MAX) return begin;
+    }
+
+    //"-0" is an integer zero, as rapidjson reads it
+    if (negative && !(isInteger && zeroInteger)) value = -value;
+    return pos;
+  }
+
+  const char* countArrayElements(const char* begin, const char* end, int& count) {
+    count = 0;
+    const char* close = skipWhitespace(begin, end);
+    if (close < end && *close == ']') return close;
+
+    //Elements are separated by commas, up to the first ']'. Anything that could hide a ']' or a comma - strings and
+    //nested values - is left to the caller.
+    int commas = 0;
+    const char* pos = begin;
+    close = nullptr;
+#ifdef CHAOS_SIMD_X86
+    while (!close && end - pos >= 16) {
+      __m128i chars = _mm_loadu_si128((const __m128i*)pos);
+      unsigned commaMask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chars, _mm_set1_epi8(',')));
+      unsigned closeMask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chars, _mm_set1_epi8(']')));
+      __m128i nested = _mm_or_si128(_mm_or_si128(
+        _mm_cmpeq_epi8(chars, _mm_set1_epi8('[')), _mm_cmpeq_epi8(chars, _mm_set1_epi8('{'))),
+        _mm_cmpeq_epi8(chars, _mm_set1_epi8('"')));
+      unsigned nestedMask = (unsigned)_mm_movemask_epi8(nested);
+
+      //Only the bytes before the first ']' belong to the array
+      unsigned arrayMask = 0xFFFF;
+      if (closeMask) {
+        int closeIndex = lowestBit(closeMask);
+        arrayMask = (1u << closeIndex) - 1;
+        close = pos + closeIndex;
+      }
+      if (nestedMask & arrayMask) return begin;
+      commas += bitCount(commaMask & arrayMask);
+      pos += 16;
+    }
+#endif
+    for (; !close && pos < end; pos++) {
+      if (*pos == ']') close = pos;
+      else if (*pos == ',') commas++;
+      else if (*pos == '[' || *pos == '{' || *pos == '"') return begin;
+    }
+    if (!close) return begin;
+
+    count = commas + 1;
+    return close;
+  }
+}
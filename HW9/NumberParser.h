@@ -0,0 +1,49 @@
+#pragma once
+
+namespace ChaosCampAM {
+  //Fast conversion of the JSON number arrays making up nearly all of a scene file ("vertices", "triangles").
+  //All functions work directly on text in memory: 'end' is the end of the text, nothing at or past it is read and
+  //no terminating zero is needed.
+
+  //Parse the JSON number at 'begin'. Returns the position right after it, or 'begin' if there is no valid number.
+  //The result is rounded correctly: numbers of up to 19 digits with a small exponent (virtually every number of a scene
+  //file) are converted exactly with a single floating-point operation, the rest falls back to strtod().
+  const char* parseNumber(const char* begin, const char* end, double& value);
+
+  //Count the elements of a JSON array of numbers, starting right after its '['. Only the delimiters are looked at
+  //(16 bytes at a time), the numbers are not checked. Returns the position of the closing ']', or 'begin' with
+  //'count' = 0 if the array is not closed or holds strings, objects or arrays.
+  const char* countArrayElements(const char* begin, const char* end, int& count);
+
+  //Position of the first character in [begin;end) that is not JSON whitespace, 'end' if there is none.
+  inline const char* skipWhitespace(const char* begin, const char* end) {
+    while (begin < end && (*begin == ' ' || *begin == '\n' || *begin == '\r' || *begin == '\t')) begin++;
+    return begin;
+  }
+
+  //Parse the elements of a JSON array of numbers, starting right after its '['. 'bool func(double)' is called for
+  //every element, in order. Returns the position of the closing ']'.
+  //Stops at the first element that is not a number followed by ',' or ']', or that 'func' rejects, and returns its
+  //position: a JSON parser resuming there (as if the array had just been opened) reads it and reports the error or
+  //passes it to its handler. A ']' right after a comma is not an element - the position right after the last element
+  //taken is returned instead, so that the parser still reports the trailing comma.
+  template<typename Func>
+  const char* parseNumberArray(const char* begin, const char* end, Func func) {
+    const char* pos = skipWhitespace(begin, end);
+    if (pos < end && *pos == ']') return pos;
+
+    const char* taken = begin;
+    while (true) {
+      double value;
+      const char* numberEnd = parseNumber(pos, end, value);
+      if (numberEnd == pos) return pos < end && *pos == ']' ? taken : pos;
+      const char* delimiter = skipWhitespace(numberEnd, end);
+      if (delimiter == end || (*delimiter != ',' && *delimiter != ']')) return pos;
+
+      if (!func(value)) return pos;
+      taken = numberEnd;
+      if (*delimiter == ']') return delimiter;
+      pos = skipWhitespace(delimiter + 1, end);
+    }
+  }
+}
@@ -1,35 +1,40 @@
-#pragma once
-#include "Math/Vector3.h"
-
-namespace ChaosCampAM {
-  //Forward declaration
-  class Camera;
-
-  class Ray {
-  public:
-    //Default: ray in the -z direction starting from the origin
-    Ray() : origin(), dir(0.0, 0.0, -1.0) {}
-    Ray(const Vector3& origin, const Vector3& direction) : origin(origin), dir(direction) { 
-      dir.normalize(); 
-    };
-
-    //Getters
-    Vector3 getOrigin() const { return origin; }
-    Vector3 getDirection() const { return dir; }
-
-    //Get a point lying on the ray, based on parameter t in the range [0;+inf). Negative values forbidden!
-    Vector3 getPointOnRay(float t) const;
-
-  private:
-    Vector3 origin;
-    Vector3 dir;
-  };
-
-  //Non-member to compute the camera ray through the centre of pixel (x,y).
-  //Pixel (0,0) assumed in top left corner.
-  Ray computeCameraRay(int xIndex, int yIndex, int imageHeight, float aspectRatio, const Camera& cam);
-
-  //Compute the reflected ray at an intersection point.
-  //Ray direction of incoming ray is pointing TOWARDS the intersection point.
-  Ray computeReflectedRay(const Vector3& incomingRay, const Vector3& intersectionPoint, const Vector3& normal);
-}
+#pragma once
+#include "Math/Vector3.h"
+
+namespace ChaosCampAM {
+  //Forward declaration
+  class Camera;
+
+  class Ray {
+  public:
+    //Default: ray in the -z direction starting from the origin
+    Ray() : origin(), dir(0.0, 0.0, -1.0) {}
+    Ray(const Vector3& origin, const Vector3& direction) : origin(origin), dir(direction) { 
+      dir.normalize(); 
+    };
+
+    //Getters
+    Vector3 getOrigin() const { return origin; }
+    Vector3 getDirection() const { return dir; }
+
+    //Get a point lying on the ray, based on parameter t in the range [0;+inf). Negative values forbidden!
+    Vector3 getPointOnRay(float t) const;
+
+  private:
+    Vector3 origin;
+    Vector3 dir;
+  };
+
+  //Non-member to compute the camera ray through the centre of pixel (x,y).
+  //Pixel (0,0) assumed in top left corner.
+  Ray computeCameraRay(int xIndex, int yIndex, int imageHeight, float aspectRatio, const Camera& cam);
+
+  //Same, through the point ('offsetX', 'offsetY') of the pixel instead of its centre - both in [0;1), from its top left
+  //corner. Used to take several samples per pixel.
+  Ray computeCameraRay(int xIndex, int yIndex, float offsetX, float offsetY, int imageHeight, float aspectRatio,
+    const Camera& cam);
+
+  //Compute the reflected ray at an intersection point.
+  //Ray direction of incoming ray is pointing TOWARDS the intersection point.
+  Ray computeReflectedRay(const Vector3& incomingRay, const Vector3& intersectionPoint, const Vector3& normal);
+}
@@ -0,0 +1,112 @@
+#include "RayPacket.h"
+#include <assert.h>
+#include <cfloat>
+
+namespace ChaosCampAM {
+
+  //The interval bounds are rounded differently from the distances of the single-ray slab test, so they are widened by
+  //far more than the rounding error of either
+  static const float INTERVAL_SLACK = 1e-4f;
+
+  //Overlap of a box with any of the rays starting at 'origin' whose direction lies in 'dirs'.
+  //For every axis the distances at which the rays enter and leave the slab are bounded from below and from above by
+  //those of the fastest and the slowest rays. A ray of the set can only overlap the box if these bounds overlap.
+  static bool intersectInterval(const Vector3& origin, const DirInterval& dirs, const AABB& box, float tMax,
+    float& tEntry) {
+    float tNear = 0.0f;
+    float tFar = FLT_MAX;
+    for (int axis = 0; axis < 3; axis++) {
+      float o = origin[axis];
+      float lo = box.min[axis];
+      float hi = box.max[axis];
+      float dMin = dirs.min[axis];
+      float dMax = dirs.max[axis];
+      float t0, t1;
+      if (o < lo) {
+        //Only rays heading towards +axis reach the slab
+        if (dMax <= 0.0f) return false;
+        t0 = (lo - o) / dMax;
+        t1 = dMin > 0.0f ? (hi - o) / dMin : FLT_MAX;
+      }
+      else if (o > hi) {
+        //Only rays heading towards -axis reach the slab
+        if (dMin >= 0.0f) return false;
+        t0 = (hi - o) / dMin;
+        t1 = dMax < 0.0f ? (lo - o) / dMax : FLT_MAX;
+      }
+      else {
+        //Inside the slab - rays parallel to it (or some of them, if the directions differ in sign) never leave it
+        t0 = 0.0f;
+        t1 = dMin > 0.0f ? (hi - o) / dMin : (dMax < 0.0f ? (lo - o) / dMax : FLT_MAX);
+      }
+      tNear = t0 > tNear ? t0 : tNear;
+      tFar = t1 < tFar ? t1 : tFar;
+    }
+
+    tEntry = tNear * (1.0f - INTERVAL_SLACK);
+    return tEntry <= tFar * (1.0f + INTERVAL_SLACK) && tEntry <= tMax;
+  }
+
+  void RayPacket::set(const Ray* rays) {
+    origin = rays[0].getOrigin();
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+      assert(rays[i].getOrigin().x == origin.x && rays[i].getOrigin().y == origin.y && rays[i].getOrigin().z == origin.z);
+      Vector3 dir = rays[i].getDirection();
+      dirX[i] = dir.x;
+      dirY[i] = dir.y;
+      dirZ[i] = dir.z;
+    }
+
+    //Direction ranges of the groups, then of the whole packet
+    const float* dirs[3] = { dirX, dirY, dirZ };
+    for (int axis = 0; axis < 3; axis++) {
+      packetDirs.min[axis] = FLT_MAX;
+      packetDirs.max[axis] = -FLT_MAX;
+      for (int g = 0; g < RAY_GROUP_COUNT; g++) {
+        DirInterval& groupRange = groupDirs[g];
+        groupRange.min[axis] = FLT_MAX;
+        groupRange.max[axis] = -FLT_MAX;
+        for (int i = g * RAY_GROUP_SIZE; i < (g + 1) * RAY_GROUP_SIZE; i++) {
+          groupRange.min[axis] = dirs[axis][i] < groupRange.min[axis] ? dirs[axis][i] : groupRange.min[axis];
+          groupRange.max[axis] = dirs[axis][i] > groupRange.max[axis] ? dirs[axis][i] : groupRange.max[axis];
+        }
+        packetDirs.min[axis] = groupRange.min[axis] < packetDirs.min[axis] ? groupRange.min[axis] : packetDirs.min[axis];
+        packetDirs.max[axis] = groupRange.max[axis] > packetDirs.max[axis] ? groupRange.max[axis] : packetDirs.max[axis];
+      }
+    }
+  }
+
+  bool RayPacket::intersectBox(const AABB& box, float tMax, float& tEntry) const {
+    return intersectInterval(origin, packetDirs, box, tMax, tEntry);
+  }
+
+  int RayPacket::intersectBoxGroups(const AABB& box, const float* tMax) const {
+    int groupMask = 0;
+    for (int g = 0; g < RAY_GROUP_COUNT; g++) {
+      float groupTMax = tMax[g * RAY_GROUP_SIZE];
+      for (int i = g * RAY_GROUP_SIZE + 1; i < (g + 1) * RAY_GROUP_SIZE; i++) {
+        groupTMax = tMax[i] > groupTMax ? tMax[i] : groupTMax;
+      }
+      float tEntry;
+      if (intersectInterval(origin, groupDirs[g], box, groupTMax, tEntry)) groupMask |= 1 << g;
+    }
+    return groupMask;
+  }
+
+  PacketHits::PacketHits() {
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+      dist[i] = FLT_MAX;
+      u[i] = 0.0f;
+      v[i] = 0.0f;
+      triIndex[i] = -1;
+    }
+  }
+
+  float PacketHits::maxDist() const {
+    float result = dist[0];
+    for (int i = 1; i < RAY_PACKET_SIZE; i++) {
+      result = dist[i] > result ? dist[i] : result;
+    }
+    return result;
+  }
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "Math/Vector3.h"
+#include "AABB.h"
+#include "Ray.h"
+#include <cstdint>
+
+namespace ChaosCampAM {
+
+  //A packet of camera rays covers RAY_PACKET_WIDTH x RAY_PACKET_WIDTH pixels
+  static const int RAY_PACKET_WIDTH = 8;
+  static const int RAY_PACKET_SIZE = RAY_PACKET_WIDTH * RAY_PACKET_WIDTH;
+
+  //Rays are intersected in groups of RAY_GROUP_SIZE (= lanes of an AVX2 register), one pixel row of the packet each
+  static const int RAY_GROUP_SIZE = RAY_PACKET_WIDTH;
+  static const int RAY_GROUP_COUNT = RAY_PACKET_SIZE / RAY_GROUP_SIZE;
+
+  //Range of each component of the directions of a set of rays
+  struct DirInterval {
+    float min[3];
+    float max[3];
+  };
+
+  /*
+  * A packet of coherent rays sharing their origin (camera rays, or camera rays taken to the object space of an instance),
+  * with the directions stored in structure-of-arrays layout, so that one triangle can be tested against a whole
+  * group of rays at once.
+  * Boxes are tested against the packet as a whole by interval arithmetic on the ranges of the directions: one test
+  * decides whether any ray of the packet (or of one of its groups) may enter the box.
+  */
+  struct alignas(32) RayPacket {
+    float dirX[RAY_PACKET_SIZE];
+    float dirY[RAY_PACKET_SIZE];
+    float dirZ[RAY_PACKET_SIZE];
+    Vector3 origin;
+    DirInterval packetDirs;
+    DirInterval groupDirs[RAY_GROUP_COUNT];
+
+    //Fill the packet with RAY_PACKET_SIZE rays, which must all start at the same point.
+    void set(const Ray* rays);
+
+    //Conservative box test of the whole packet - false only if no ray of the packet overlaps the box within [0;tMax].
+    //'tEntry' receives a lower bound of the distance at which the rays enter the box.
+    bool intersectBox(const AABB& box, float tMax, float& tEntry) const;
+
+    //Bit mask of the groups some ray of which may overlap the box, each group within the largest of its 'tMax' values.
+    int intersectBoxGroups(const AABB& box, const float* tMax) const;
+  };
+
+  //Closest hits found so far for the rays of a packet
+  struct alignas(32) PacketHits {
+    float dist[RAY_PACKET_SIZE]; //only hits closer than 'dist' are accepted
+    float u[RAY_PACKET_SIZE]; //barycentric coordinates associated with v1/v2
+    float v[RAY_PACKET_SIZE];
+    int triIndex[RAY_PACKET_SIZE]; //-1 if the ray has no hit
+
+    //No hits yet - all distances are accepted
+    PacketHits();
+
+    //Largest 'dist' of the packet - rays of the packet can only find hits closer than that
+    float maxDist() const;
+  };
+}
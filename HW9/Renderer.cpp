@@ -1,166 +1,1167 @@
-#include"Renderer.h"
-#include"Scene.h"
-#include"ColorRGB.h"
-#include"Ray.h"
-#include"Mesh.h"
-#include"Material.h"
-#include"Camera.h"
-#include"Math/MathUtil.h"
-#include"Math/Vector3.h"
-#include"Constants.h"
-#include"Triangle.h"
-#include<assert.h>
-#include<algorithm>
-
-#include<iostream>
-void ChaosCampAM::Renderer::render(const Scene& scene, const std::string& filename, const ShadingMode& shadingMode) {
-  //Initial getters
-  const Settings& settings = scene.getSettings();
-  int imageWidth = settings.getWidth();
-  int imageHeight = settings.getHeight();
-  float aspectRatio = settings.getAspectRatio();
-  const Camera& cam = scene.getCamera();
-
-  //Set up output file stream
-  std::ofstream ppmFileStream(filename, std::ios::out | std::ios::binary);
-  assert(ppmFileStream.is_open());
-  ppmFileStream << "P3\n";
-  ppmFileStream << imageWidth << " " << imageHeight << "\n";
-  ppmFileStream << ColorRGB::maxColorComponents << "\n";
-
-  //Loop through pixels and shoot camera rays
-  for (int rowIdx = 0; rowIdx < imageHeight; ++rowIdx) {
-    for (int colIdx = 0; colIdx < imageWidth; ++colIdx) {
-      Ray ray = computeCameraRay(colIdx, rowIdx, imageHeight, aspectRatio, cam);
-
-      //Calculate pixel color by the method of ray-tracing
-      ColorRGB pixelColor = ColorRGB(rayTrace(ray, 0, shadingMode, scene));
-      
-      ppmFileStream << (int)pixelColor.r << " " << (int)pixelColor.g << " " << (int)pixelColor.b << "\t";
-    }
-    ppmFileStream << "\n";
-  }
-
-  ppmFileStream.close();
-}
-
-ChaosCampAM::Vector3 ChaosCampAM::Renderer::rayTrace(const Ray& ray, int depth, ShadingMode shadingMode, const Scene& scene) {
-  //initial definitions
-  Vector3 pixelColor = scene.getSettings().getBgColor();//default colour is background colour
-  if (depth == MAX_TRACING_DEPTH) return pixelColor; //max depth reached - stop tracing
-  const std::vector<Mesh>& meshes = scene.getMeshes();
-
-  //intersect
-  InfoIntersect intersectInfo;
-  int meshIndex = 0;
-  int triIndex = 0;
-  float dist = findIntersection(ray, meshes, intersectInfo, meshIndex, triIndex);
-
-  if (intersectInfo.hasIntersection) {
-    //intersection occured - colour pixel based on shading mode
-    if (shadingMode == ShadingMode::Light) {
-      
-      //extract material properties
-      assert(scene.getMaterials().size() > 0);
-      const Material& mat = scene.getMaterials()[meshes[meshIndex].getMatIndex()];
-      Vector3 albedo = mat.albedo;
-      
-      Vector3 normal = mat.smoothShading ?
-        extractHitNormal(meshes, intersectInfo, meshIndex, triIndex) : //if smooth shading is enabled, take hit normal
-        intersectInfo.triNormal; //else take triangle normal
-      
-      //in case of diffuse material, do lambertian shading
-      if (mat.type == MaterialType::Diffuse) { 
-        pixelColor = shadeLambertian(intersectInfo.intersectionPoint, normal, albedo, scene);
-      }
-      // in case of reflective material, trace a reflected ray
-      else if (mat.type == MaterialType::Reflective) {
-        Ray reflectedRay = computeReflectedRay(ray.getDirection(), intersectInfo.intersectionPoint, normal);
-        pixelColor = rayTrace(reflectedRay, ++depth, shadingMode, scene).compMult(albedo);
-      }
-    }
-    else if (shadingMode == ShadingMode::Barycentric) {
-      pixelColor = shadeBarycentric(intersectInfo.coords);
-    }
-  }
-  return pixelColor;
-}
-
-float ChaosCampAM::Renderer::findIntersection(const Ray& ray, const std::vector<Mesh>& meshes,
-  InfoIntersect& intersectInfo, int& meshIndex, int& triIndex) {
-  //Closest intersection among all meshes
-  float closestDist = FLT_MAX;
-  InfoIntersect closestIntersect;
-  intersectInfo.hasIntersection = false;
-
-  //Loop through all meshes and find closest intersection
-  
-  int index = 0;
-  int triIndexCurrent = 0;
-  for (const Mesh& mesh : meshes) {
-    float dist = mesh.intersect(ray, closestIntersect, triIndexCurrent);
-    if (closestIntersect.hasIntersection && dist < closestDist) {
-      closestDist = dist;
-      intersectInfo = closestIntersect;
-      meshIndex = index;
-      triIndex = triIndexCurrent;
-    }
-    index++;
-  }
- 
-  //If no intersection occurred, return negative distance
-  return intersectInfo.hasIntersection ? closestDist : -1.0f;
-}
-
-ChaosCampAM::Vector3 ChaosCampAM::Renderer::extractHitNormal(const std::vector<Mesh>& meshes, const InfoIntersect& intersectInfo, 
-  int meshIndex, int triIndex) {
-
-  //extract the triangles and vertex normals of the intersected mesh
-  const std::vector<TriProxy>& triangles = meshes[meshIndex].getTriangles();
-  const std::vector<Vector3>& vertexNormals = meshes[meshIndex].getVertNormals();
-
-  //find the vertex normals of the intersected triangle within the mesh
-  Vector3 normal0 = vertexNormals[triangles[triIndex].v0];
-  Vector3 normal1 = vertexNormals[triangles[triIndex].v1];
-  Vector3 normal2 = vertexNormals[triangles[triIndex].v2];
-
-  //calculate hit normal as a weighted sum of the three vertex normals
-  return intersectInfo.coords[0] * normal0 + intersectInfo.coords[1] * normal1 + intersectInfo.coords[2] * normal2;
-}
-
-ChaosCampAM::Vector3 ChaosCampAM::Renderer::shadeLambertian(const Vector3& point, const Vector3& normal, 
-  const Vector3& albedo, const Scene& scene) {
-  Vector3 finalColor;
-  for (PointLight pointLight : scene.getPointLights()) {
-    //Direction from point to light
-    Vector3 lightDir = pointLight.pos - point;
-    //Sphere radius
-    float rad = lightDir.getLen();
-    //Normalise light direction
-    lightDir = lightDir * (1 / rad);
-
-    //Lambertian shading
-    float cos = std::max(0.0f, lightDir.dot(normal));
-    float sphereArea = 4 * PI * rad * rad;
-    Ray shadowRay(point + normal * SHADOW_BIAS, lightDir);
-
-    InfoIntersect intersectInfo;
-    int meshIndexDummyVar = 0;
-    int triIndexDummyVar = 0;
-    float dist = findIntersection(shadowRay, scene.getMeshes(), intersectInfo, meshIndexDummyVar, triIndexDummyVar);
-    if (!intersectInfo.hasIntersection) {
-      //no intersection, i.e. no shadow
-      float r = (pointLight.intensity * albedo.x*cos) / (sphereArea);
-      float g = (pointLight.intensity * albedo.y*cos) / (sphereArea );
-      float b = (pointLight.intensity * albedo.z*cos) / (sphereArea );
-
-      finalColor = finalColor + Vector3(r, g, b);
-    }
-  }
-  return finalColor;
-}
-
-ChaosCampAM::Vector3 ChaosCampAM::Renderer::shadeBarycentric(float coords[3]){
-  assert(abs(coords[0] + coords[1] + coords[2] - 1.0f) < EPSILON_RELAXED);
-  return Vector3(coords[0], coords[1], coords[2]);
-}
+#include"Renderer.h"
+#include"Scene.h"
+#include"ColorRGB.h"
+#include"Ray.h"
+#include"Mesh.h"
+#include"MeshInstance.h"
+#include"Material.h"
+#include"Camera.h"
+#include"Math/MathUtil.h"
+#include"Math/Vector3.h"
+#include"Constants.h"
+#include"Triangle.h"
+#include"Framebuffer.h"
+#include"ImageWriter.h"
+#include"RayPacket.h"
+#include<assert.h>
+#include<algorithm>
+#include<cmath>
+#include<chrono>
+
+#include<iostream>
+ChaosCampAM::Renderer::~Renderer() {
+  waitForOutput();
+}
+
+void ChaosCampAM::Renderer::render(const Scene& scene, const std::string& filename, const ShadingMode& shadingMode) {
+  //Initial getters
+  const Settings& settings = scene.getSettings();
+  int imageWidth = settings.getWidth();
+  int imageHeight = settings.getHeight();
+
+  resetOccluderCaches(scene);
+  Framebuffer framebuffer(imageWidth, imageHeight);
+  if (sampling.enabled) {
+    auto renderAdaptiveFunc = shadingMode == ShadingMode::Barycentric ?
+      &Renderer::renderAdaptive<ShadingMode::Barycentric, MAX_TRACING_DEPTH> :
+      &Renderer::renderAdaptive<ShadingMode::Light, MAX_TRACING_DEPTH>;
+    (this->*renderAdaptiveFunc)(scene, framebuffer);
+  }
+  else if (engine == RenderEngine::Wavefront) {
+    auto renderWavefrontFunc = shadingMode == ShadingMode::Barycentric ?
+      &Renderer::renderWavefront<ShadingMode::Barycentric, MAX_TRACING_DEPTH> :
+      &Renderer::renderWavefront<ShadingMode::Light, MAX_TRACING_DEPTH>;
+    (this->*renderWavefrontFunc)(scene, framebuffer);
+  }
+  else {
+    //Pick the tracing loop for the shading mode once, instead of checking it for every ray
+    auto renderTileFunc = shadingMode == ShadingMode::Barycentric ?
+      &Renderer::renderTile<ShadingMode::Barycentric, MAX_TRACING_DEPTH> :
+      &Renderer::renderTile<ShadingMode::Light, MAX_TRACING_DEPTH>;
+
+    //Trace the image tile by tile on the thread pool. Tiles differ a lot in cost (background vs. reflective regions),
+    //idle threads steal the remaining tiles from busy ones.
+    TaskGroup tiles;
+    for (int y0 = 0; y0 < imageHeight; y0 += RENDER_TILE_SIZE) {
+      for (int x0 = 0; x0 < imageWidth; x0 += RENDER_TILE_SIZE) {
+        int x1 = std::min(x0 + RENDER_TILE_SIZE, imageWidth);
+        int y1 = std::min(y0 + RENDER_TILE_SIZE, imageHeight);
+        threadPool.submit(tiles, [this, renderTileFunc, &scene, x0, y0, x1, y1, &framebuffer]() {
+          (this->*renderTileFunc)(scene, x0, y0, x1, y1, framebuffer);
+        });
+      }
+    }
+    threadPool.wait(tiles);
+  }
+
+  collectShadowRayStats();
+
+  if (sampling.enabled) {
+    double sampleCount = 0.0;
+    for (int rowIdx = 0; rowIdx < imageHeight; ++rowIdx) {
+      for (int colIdx = 0; colIdx < imageWidth; ++colIdx) {
+        sampleCount += framebuffer.getWeight(colIdx, rowIdx);
+      }
+    }
+    std::cout << "Adaptive sampling: " << sampleCount / ((double)imageWidth * imageHeight) << " samples per pixel\n";
+  }
+
+  //Samples per pixel, from black at the minimum through red and yellow to white at the cap
+  std::vector<ColorRGB> heatmap;
+  std::string heatmapFilename = sampling.enabled ? sampling.heatmapFilename : std::string();
+  if (!heatmapFilename.empty()) {
+    heatmap.reserve((size_t)imageWidth * imageHeight);
+    float range = (float)std::max(sampling.maxSamples - sampling.minSamples, 1);
+    for (int rowIdx = 0; rowIdx < imageHeight; ++rowIdx) {
+      for (int colIdx = 0; colIdx < imageWidth; ++colIdx) {
+        float t = (framebuffer.getWeight(colIdx, rowIdx) - sampling.minSamples) / range;
+        heatmap.push_back(ColorRGB(Vector3(3.0f * t, 3.0f * t - 1.0f, 3.0f * t - 2.0f)));
+      }
+    }
+  }
+
+  //Tonemap and encode on a background thread, so that the caller can go on (e.g. load the next scene) meanwhile.
+  //Only one image is in flight at a time.
+  waitForOutput();
+  pendingOutput = std::async(std::launch::async,
+    [filename, fb = std::move(framebuffer), heatmapFilename, heatmap = std::move(heatmap)]() {
+    if (!writeImage(filename, fb.getWidth(), fb.getHeight(), fb.getRGB8())) {
+      std::cout << "Could not write image file: " << filename << "\n";
+    }
+    if (!heatmapFilename.empty() && !writeImage(heatmapFilename, fb.getWidth(), fb.getHeight(), heatmap)) {
+      std::cout << "Could not write image file: " << heatmapFilename << "\n";
+    }
+  });
+}
+
+void ChaosCampAM::Renderer::renderProgressive(const Scene& scene, const std::string& filename,
+  const ShadingMode& shadingMode, const ProgressiveSettings& progressive) {
+  assert(progressive.coarseBlockSize >= 1 && progressive.coarseBlockSize <= RENDER_TILE_SIZE);
+  assert((progressive.coarseBlockSize & (progressive.coarseBlockSize - 1)) == 0);
+  const Settings& settings = scene.getSettings();
+  int imageWidth = settings.getWidth();
+  int imageHeight = settings.getHeight();
+
+  auto progressiveTileFunc = shadingMode == ShadingMode::Barycentric ?
+    &Renderer::progressiveTile<ShadingMode::Barycentric, MAX_TRACING_DEPTH> :
+    &Renderer::progressiveTile<ShadingMode::Light, MAX_TRACING_DEPTH>;
+
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point start = Clock::now();
+  Clock::time_point lastFlush = start;
+  auto elapsedMs = [](Clock::time_point from) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - from).count();
+  };
+  auto outOfTime = [&]() {
+    return progressive.timeBudgetMs > 0.0 && elapsedMs(start) >= progressive.timeBudgetMs;
+  };
+
+  resetOccluderCaches(scene);
+  Framebuffer framebuffer(imageWidth, imageHeight);
+
+  //Passes: the block sizes down to single pixels, then one more sample per pixel each
+  std::vector<int> passBlockSizes;
+  for (int blockSize = progressive.coarseBlockSize; blockSize >= 1; blockSize /= 2) {
+    passBlockSizes.push_back(blockSize);
+  }
+  for (int sampleIndex = 1; sampleIndex < progressive.sampleTarget; sampleIndex++) {
+    passBlockSizes.push_back(0);
+  }
+
+  for (int pass = 0; pass < (int)passBlockSizes.size(); pass++) {
+    int blockSize = passBlockSizes[pass];
+    int sampleIndex = blockSize > 0 ? 0 : pass - (int)passBlockSizes.size() + progressive.sampleTarget;
+    TaskGroup tiles;
+    for (int y0 = 0; y0 < imageHeight; y0 += RENDER_TILE_SIZE) {
+      for (int x0 = 0; x0 < imageWidth; x0 += RENDER_TILE_SIZE) {
+        int x1 = std::min(x0 + RENDER_TILE_SIZE, imageWidth);
+        int y1 = std::min(y0 + RENDER_TILE_SIZE, imageHeight);
+        threadPool.submit(tiles, [=, &scene, &framebuffer, &outOfTime, &progressive]() {
+          if (pass > 0 && outOfTime()) return;
+          (this->*progressiveTileFunc)(scene, x0, y0, x1, y1, blockSize, progressive.coarseBlockSize, sampleIndex,
+            framebuffer);
+        });
+      }
+    }
+    threadPool.wait(tiles);
+
+    //Tracing does not wait for intermediate images - a flush while the previous image is still being written only
+    //goes to the callback
+    bool lastPass = pass + 1 == (int)passBlockSizes.size() || outOfTime();
+    if (lastPass || elapsedMs(lastFlush) >= progressive.flushIntervalMs) {
+      bool writing = pendingOutput.valid() &&
+        pendingOutput.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+      if (!filename.empty() && (lastPass || !writing)) writeInBackground(filename, framebuffer);
+      if (progressive.onFlush) progressive.onFlush(framebuffer, pass);
+      lastFlush = Clock::now();
+    }
+    if (lastPass) break;
+  }
+
+  collectShadowRayStats();
+}
+
+void ChaosCampAM::Renderer::resetOccluderCaches(const Scene& scene) {
+  int lightCount = (int)scene.getPointLights().size();
+  occluderCaches.assign(threadPool.getThreadCount(), OccluderCache());
+  for (OccluderCache& cache : occluderCaches) {
+    cache.occluders.resize(lightCount);
+  }
+}
+
+void ChaosCampAM::Renderer::collectShadowRayStats() {
+  shadowRayStats = ShadowRayStats();
+  for (const OccluderCache& cache : occluderCaches) {
+    shadowRayStats.rays += cache.rays;
+    shadowRayStats.blocked += cache.blocked;
+    shadowRayStats.cacheHits += cache.hits;
+  }
+  if (occluderCaching && shadowRayStats.blocked > 0) {
+    std::cout << "Shadow rays: " << shadowRayStats.rays << ", blocked: " << shadowRayStats.blocked
+      << ", found by the occluder cache: " << 100.0 * shadowRayStats.cacheHits / shadowRayStats.blocked << "%\n";
+  }
+}
+
+void ChaosCampAM::Renderer::writeInBackground(const std::string& filename, const Framebuffer& framebuffer) {
+  waitForOutput();
+  pendingOutput = std::async(std::launch::async, [filename, fb = framebuffer]() {
+    if (!writeImage(filename, fb.getWidth(), fb.getHeight(), fb.getRGB8())) {
+      std::cout << "Could not write image file: " << filename << "\n";
+    }
+  });
+}
+
+void ChaosCampAM::Renderer::waitForOutput() {
+  if (pendingOutput.valid()) {
+    pendingOutput.get();
+  }
+}
+
+int ChaosCampAM::Renderer::getThreadCount() const {
+  return threadPool.getThreadCount();
+}
+
+void ChaosCampAM::Renderer::setPacketTracing(bool enabled) {
+  packetTracing = enabled;
+}
+
+void ChaosCampAM::Renderer::setEngine(RenderEngine engine) {
+  this->engine = engine;
+}
+
+void ChaosCampAM::Renderer::setLightThreshold(float threshold) {
+  lightThreshold = threshold;
+}
+
+void ChaosCampAM::Renderer::setAdaptiveSampling(const AdaptiveSampling& sampling) {
+  assert(sampling.minSamples == 1 || sampling.minSamples == 4);
+  assert(sampling.maxSamples >= sampling.minSamples);
+  this->sampling = sampling;
+}
+
+void ChaosCampAM::Renderer::setOccluderCache(bool enabled) {
+  occluderCaching = enabled;
+}
+
+const ChaosCampAM::ShadowRayStats& ChaosCampAM::Renderer::getShadowRayStats() const {
+  return shadowRayStats;
+}
+
+template<ChaosCampAM::ShadingMode Mode, int MaxDepth>
+void ChaosCampAM::Renderer::renderTile(const Scene& scene, int x0, int y0, int x1, int y1,
+  Framebuffer& framebuffer) const {
+  const Settings& settings = scene.getSettings();
+  int imageHeight = settings.getHeight();
+  float aspectRatio = settings.getAspectRatio();
+  const Camera& cam = scene.getCamera();
+
+  //Camera rays of neighbouring pixels are nearly parallel - trace them in packets
+  if (packetTracing) {
+    for (int rowIdx = y0; rowIdx < y1; rowIdx += RAY_PACKET_WIDTH) {
+      for (int colIdx = x0; colIdx < x1; colIdx += RAY_PACKET_WIDTH) {
+        renderPacket<Mode, MaxDepth>(scene, colIdx, rowIdx, std::min(colIdx + RAY_PACKET_WIDTH, x1),
+          std::min(rowIdx + RAY_PACKET_WIDTH, y1), framebuffer);
+      }
+    }
+    return;
+  }
+
+  //Loop through the pixels of the tile and shoot camera rays. Tiles do not overlap, so no synchronisation is needed.
+  for (int rowIdx = y0; rowIdx < y1; ++rowIdx) {
+    for (int colIdx = x0; colIdx < x1; ++colIdx) {
+      Ray ray = computeCameraRay(colIdx, rowIdx, imageHeight, aspectRatio, cam);
+
+      //Calculate pixel color by the method of ray-tracing
+      framebuffer.setPixel(colIdx, rowIdx, rayTrace<Mode, MaxDepth>(ray, scene));
+    }
+  }
+}
+
+template<ChaosCampAM::ShadingMode Mode, int MaxDepth>
+void ChaosCampAM::Renderer::renderPacket(const Scene& scene, int x0, int y0, int x1, int y1,
+  Framebuffer& framebuffer) const {
+  const Settings& settings = scene.getSettings();
+  int imageHeight = settings.getHeight();
+  float aspectRatio = settings.getAspectRatio();
+  const Camera& cam = scene.getCamera();
+
+  //A packet is always full - at the border of the image the last pixel of a row (and the last row) are repeated
+  Ray rays[RAY_PACKET_SIZE];
+  for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+    int colIdx = std::min(x0 + i % RAY_PACKET_WIDTH, x1 - 1);
+    int rowIdx = std::min(y0 + i / RAY_PACKET_WIDTH, y1 - 1);
+    rays[i] = computeCameraRay(colIdx, rowIdx, imageHeight, aspectRatio, cam);
+  }
+  RayPacket packet;
+  packet.set(rays);
+
+  PacketHits hits;
+  int meshIndex[RAY_PACKET_SIZE];
+  int instanceIndex[RAY_PACKET_SIZE];
+  findIntersection(rays, packet, scene, hits, meshIndex, instanceIndex);
+
+  //Shade pixel by pixel
+  for (int rowIdx = y0; rowIdx < y1; ++rowIdx) {
+    for (int colIdx = x0; colIdx < x1; ++colIdx) {
+      int i = (rowIdx - y0) * RAY_PACKET_WIDTH + (colIdx - x0);
+      InfoIntersect intersectInfo = extractPacketHit(rays[i], scene, hits, i, meshIndex[i], instanceIndex[i]);
+      framebuffer.setPixel(colIdx, rowIdx,
+        shadeHit<Mode, MaxDepth>(rays[i], scene, intersectInfo, meshIndex[i], instanceIndex[i], hits.triIndex[i]));
+    }
+  }
+}
+
+//Luminance sums of the samples of every pixel, and the mean luminance of the initial samples (which the refinement
+//pass only reads, so that tiles can look at the pixels of their neighbours)
+struct ChaosCampAM::Renderer::SampleStats {
+  int width;
+  std::vector<float> lumSums;
+  std::vector<float> lumSqSums;
+  std::vector<float> initialLums;
+};
+
+//Luminance of a colour as it ends up in the image
+static float displayLuminance(const ChaosCampAM::Vector3& color) {
+  float r = std::min(std::max(color.x, 0.0f), 1.0f);
+  float g = std::min(std::max(color.y, 0.0f), 1.0f);
+  float b = std::min(std::max(color.z, 0.0f), 1.0f);
+  return 0.2126f * r + 0.7152f * g + 0.0722f * b;
+}
+
+//Uniform number in [0;1) for a pixel, sample and dimension. A hash rather than a random generator, so that the samples
+//do not depend on the order in which the pixels are traced.
+static float hashToUnit(int x, int y, int sample, int dim) {
+  uint32_t h = (uint32_t)x * 0x8da6b343u ^ (uint32_t)y * 0xd8163841u ^ (uint32_t)sample * 0xcb1ab31fu ^
+    (uint32_t)dim * 0x165667b1u;
+  h ^= h >> 16;
+  h *= 0x7feb352du;
+  h ^= h >> 15;
+  h *= 0x846ca68bu;
+  h ^= h >> 16;
+  return (float)(h >> 8) * (1.0f / 16777216.0f);
+}
+
+//Position of sample 'i' within pixel (x, y). The initial samples are stratified - the pixel centre, or one jittered
+//sample per quarter of the pixel. Further samples follow the R2 low-discrepancy sequence, shifted per pixel.
+static void samplePosition(int x, int y, int i, int minSamples, float& offsetX, float& offsetY) {
+  if (minSamples == 1 && i == 0) {
+    offsetX = 0.5f;
+    offsetY = 0.5f;
+  }
+  else if (i < minSamples) {
+    offsetX = ((float)(i & 1) + hashToUnit(x, y, i, 0)) * 0.5f;
+    offsetY = ((float)(i >> 1) + hashToUnit(x, y, i, 1)) * 0.5f;
+  }
+  else {
+    offsetX = hashToUnit(x, y, 0, 2) + (float)i * 0.7548776662f;
+    offsetY = hashToUnit(x, y, 0, 3) + (float)i * 0.5698402910f;
+    offsetX -= std::floor(offsetX);
+    offsetY -= std::floor(offsetY);
+  }
+}
+
+template<ChaosCampAM::ShadingMode Mode, int MaxDepth>
+void ChaosCampAM::Renderer::renderAdaptive(const Scene& scene, Framebuffer& framebuffer) {
+  int imageWidth = scene.getSettings().getWidth();
+  int imageHeight = scene.getSettings().getHeight();
+  SampleStats stats;
+  stats.width = imageWidth;
+  stats.lumSums.assign((size_t)imageWidth * imageHeight, 0.0f);
+  stats.lumSqSums.assign((size_t)imageWidth * imageHeight, 0.0f);
+
+  for (int pass = 0; pass < 2; pass++) {
+    bool refine = pass == 1;
+    if (refine) {
+      stats.initialLums = stats.lumSums;
+      for (float& lum : stats.initialLums) {
+        lum /= (float)sampling.minSamples;
+      }
+    }
+
+    TaskGroup tiles;
+    for (int y0 = 0; y0 < imageHeight; y0 += RENDER_TILE_SIZE) {
+      for (int x0 = 0; x0 < imageWidth; x0 += RENDER_TILE_SIZE) {
+        int x1 = std::min(x0 + RENDER_TILE_SIZE, imageWidth);
+        int y1 = std::min(y0 + RENDER_TILE_SIZE, imageHeight);
+        threadPool.submit(tiles, [this, &scene, x0, y0, x1, y1, refine, &framebuffer, &stats]() {
+          sampleTile<Mode, MaxDepth>(scene, x0, y0, x1, y1, refine, framebuffer, stats);
+        });
+      }
+    }
+    threadPool.wait(tiles);
+  }
+}
+
+template<ChaosCampAM::ShadingMode Mode, int MaxDepth>
+void ChaosCampAM::Renderer::sampleTile(const Scene& scene, int x0, int y0, int x1, int y1, bool refine,
+  Framebuffer& framebuffer, SampleStats& stats) const {
+  int imageWidth = scene.getSettings().getWidth();
+  int imageHeight = scene.getSettings().getHeight();
+  for (int rowIdx = y0; rowIdx < y1; ++rowIdx) {
+    for (int colIdx = x0; colIdx < x1; ++colIdx) {
+      if (!refine) {
+        addSamples<Mode, MaxDepth>(scene, colIdx, rowIdx, 0, sampling.minSamples, framebuffer, stats);
+        continue;
+      }
+
+      //Edges: largest difference to the 4 neighbours after the initial samples
+      size_t pixel = (size_t)rowIdx * imageWidth + colIdx;
+      float lum = stats.initialLums[pixel];
+      float contrast = 0.0f;
+      if (colIdx > 0) contrast = std::max(contrast, std::abs(lum - stats.initialLums[pixel - 1]));
+      if (colIdx + 1 < imageWidth) contrast = std::max(contrast, std::abs(lum - stats.initialLums[pixel + 1]));
+      if (rowIdx > 0) contrast = std::max(contrast, std::abs(lum - stats.initialLums[pixel - imageWidth]));
+      if (rowIdx + 1 < imageHeight) contrast = std::max(contrast, std::abs(lum - stats.initialLums[pixel + imageWidth]));
+
+      int sampleCount = sampling.minSamples;
+      while (sampleCount < sampling.maxSamples) {
+        //Standard error of the mean luminance - unknown with a single sample
+        bool noisy = false;
+        if (sampleCount > 1) {
+          float mean = stats.lumSums[pixel] / sampleCount;
+          float variance = std::max(stats.lumSqSums[pixel] / sampleCount - mean * mean, 0.0f) *
+            sampleCount / (sampleCount - 1);
+          noisy = variance / sampleCount > sampling.errorThreshold * sampling.errorThreshold;
+        }
+        bool edge = sampleCount == sampling.minSamples && contrast > sampling.contrastThreshold;
+        if (!noisy && !edge) break;
+
+        int count = std::min(ADAPTIVE_SAMPLE_BATCH, sampling.maxSamples - sampleCount);
+        addSamples<Mode, MaxDepth>(scene, colIdx, rowIdx, sampleCount, count, framebuffer, stats);
+        sampleCount += count;
+      }
+    }
+  }
+}
+
+template<ChaosCampAM::ShadingMode Mode, int MaxDepth>
+void ChaosCampAM::Renderer::addSamples(const Scene& scene, int x, int y, int first, int count,
+  Framebuffer& framebuffer, SampleStats& stats) const {
+  const Settings& settings = scene.getSettings();
+  int imageHeight = settings.getHeight();
+  float aspectRatio = settings.getAspectRatio();
+  const Camera& cam = scene.getCamera();
+  size_t pixel = (size_t)y * stats.width + x;
+
+  for (int i = first; i < first + count; i++) {
+    float offsetX, offsetY;
+    samplePosition(x, y, i, sampling.minSamples, offsetX, offsetY);
+    Ray ray = computeCameraRay(x, y, offsetX, offsetY, imageHeight, aspectRatio, cam);
+    Vector3 color = rayTrace<Mode, MaxDepth>(ray, scene);
+    framebuffer.addSample(x, y, color);
+
+    float lum = displayLuminance(color);
+    stats.lumSums[pixel] += lum;
+    stats.lumSqSums[pixel] += lum * lum;
+  }
+}
+
+template<ChaosCampAM::ShadingMode Mode, int MaxDepth>
+void ChaosCampAM::Renderer::progressiveTile(const Scene& scene, int x0, int y0, int x1, int y1, int blockSize,
+  int coarseBlockSize, int sampleIndex, Framebuffer& framebuffer) const {
+  const Settings& settings = scene.getSettings();
+  int imageHeight = settings.getHeight();
+  float aspectRatio = settings.getAspectRatio();
+  const Camera& cam = scene.getCamera();
+
+  if (blockSize == 0) {
+    for (int rowIdx = y0; rowIdx < y1; ++rowIdx) {
+      for (int colIdx = x0; colIdx < x1; ++colIdx) {
+        float offsetX, offsetY;
+        samplePosition(colIdx, rowIdx, sampleIndex, 1, offsetX, offsetY);
+        Ray ray = computeCameraRay(colIdx, rowIdx, offsetX, offsetY, imageHeight, aspectRatio, cam);
+        framebuffer.addSample(colIdx, rowIdx, rayTrace<Mode, MaxDepth>(ray, scene));
+      }
+    }
+    return;
+  }
+
+  //Tiles start at multiples of RENDER_TILE_SIZE, so blocks never cross them. Corners of blocks twice the size were
+  //traced by the previous pass.
+  for (int rowIdx = y0; rowIdx < y1; rowIdx += blockSize) {
+    for (int colIdx = x0; colIdx < x1; colIdx += blockSize) {
+      bool traced = blockSize < coarseBlockSize && rowIdx % (2 * blockSize) == 0 && colIdx % (2 * blockSize) == 0;
+      if (traced) continue;
+      Ray ray = computeCameraRay(colIdx, rowIdx, imageHeight, aspectRatio, cam);
+      Vector3 color = rayTrace<Mode, MaxDepth>(ray, scene);
+      for (int y = rowIdx; y < std::min(rowIdx + blockSize, y1); y++) {
+        for (int x = colIdx; x < std::min(colIdx + blockSize, x1); x++) {
+          framebuffer.setPixel(x, y, color);
+        }
+      }
+    }
+  }
+}
+
+template<typename LightFunc>
+void ChaosCampAM::Renderer::forEachLight(const Scene& scene, const Vector3& point, const Vector3& normal,
+  const Vector3& albedo, LightFunc lightFunc) const {
+  const std::vector<PointLight>& lights = scene.getPointLights();
+  float maxAlbedo = std::max(albedo.x, std::max(albedo.y, albedo.z));
+  scene.getLightTree().traverse(point, normal, maxAlbedo, lightThreshold, [&](int lightIndex) {
+    Ray shadowRay;
+    float lightDist;
+    Vector3 light = directLight(point, normal, albedo, lights[lightIndex], shadowRay, lightDist);
+
+    //A light that cannot add anything (behind the surface, or below the threshold) needs no shadow ray
+    float maxLight = std::max(light.x, std::max(light.y, light.z));
+    if (maxLight <= 0.0f || maxLight < lightThreshold) return;
+    lightFunc(lightIndex, light, shadowRay, lightDist);
+  });
+}
+
+//Pixels [x0;x1) x [y0;y1) traced as one packet of camera rays
+struct ChaosCampAM::Renderer::PacketRect {
+  int x0, y0, x1, y1;
+};
+
+//Path of a pixel: the ray to trace next, and how much of its light reaches the pixel
+struct ChaosCampAM::Renderer::WavefrontPath {
+  Ray ray;
+  Vector3 throughput; //product of the albedos of the mirrors the path has been reflected by
+  int x, y;
+};
+
+//Closest hit of a path, as found by findIntersection()
+struct ChaosCampAM::Renderer::WavefrontHit {
+  InfoIntersect info;
+  int meshIndex;
+  int instanceIndex;
+  int triIndex;
+  int matIndex; //-1 if the ray missed everything
+};
+
+//Shadow ray towards one light from a diffuse hit
+struct ChaosCampAM::Renderer::ShadowQuery {
+  Ray ray;
+  float lightDist;
+  int lightIndex;
+  Vector3 light; //added to the pixel if nothing blocks the ray
+  bool visible;
+};
+
+//Diffuse hit whose light is the sum of the unoccluded 'shadowQueries' [firstQuery; firstQuery + queryCount)
+struct ChaosCampAM::Renderer::DiffuseHit {
+  int path;
+  int firstQuery;
+  int queryCount;
+};
+
+//Call 'func(first, last)' for consecutive ranges of at most WAVEFRONT_CHUNK_SIZE entries covering [0;count), in parallel
+template<typename Func>
+static void forEachChunk(ChaosCampAM::ThreadPool& threadPool, int count, Func func) {
+  const int chunkSize = ChaosCampAM::WAVEFRONT_CHUNK_SIZE;
+  threadPool.parallelFor(0, (count + chunkSize - 1) / chunkSize, 1, [&](int chunk) {
+    int first = chunk * chunkSize;
+    func(first, std::min(first + chunkSize, count));
+  });
+}
+
+template<ChaosCampAM::ShadingMode Mode, int MaxDepth>
+void ChaosCampAM::Renderer::renderWavefront(const Scene& scene, Framebuffer& framebuffer) {
+  const Settings& settings = scene.getSettings();
+  int imageWidth = settings.getWidth();
+  int imageHeight = settings.getHeight();
+  float aspectRatio = settings.getAspectRatio();
+  const Camera& cam = scene.getCamera();
+  const Vector3& bgColor = settings.getBgColor();
+
+  //Camera rays are generated packet by packet, tile by tile - neighbouring rays stay next to each other in the queues
+  std::vector<PacketRect> packets;
+  for (int y0 = 0; y0 < imageHeight; y0 += RENDER_TILE_SIZE) {
+    for (int x0 = 0; x0 < imageWidth; x0 += RENDER_TILE_SIZE) {
+      int x1 = std::min(x0 + RENDER_TILE_SIZE, imageWidth);
+      int y1 = std::min(y0 + RENDER_TILE_SIZE, imageHeight);
+      for (int rowIdx = y0; rowIdx < y1; rowIdx += RAY_PACKET_WIDTH) {
+        for (int colIdx = x0; colIdx < x1; colIdx += RAY_PACKET_WIDTH) {
+          packets.push_back({ colIdx, rowIdx, std::min(colIdx + RAY_PACKET_WIDTH, x1),
+            std::min(rowIdx + RAY_PACKET_WIDTH, y1) });
+        }
+      }
+    }
+  }
+
+  //Queues, reused from wave to wave
+  std::vector<WavefrontPath> paths;
+  std::vector<WavefrontPath> nextPaths;
+  std::vector<WavefrontHit> hits;
+  std::vector<int> packetStarts;
+  std::vector<int> order;
+  std::vector<int> bucketStarts;
+  std::vector<ShadowQuery> shadowQueries;
+  std::vector<DiffuseHit> diffuseHits;
+  const std::vector<int> noPackets;
+
+  int packetCount = (int)packets.size();
+  for (int firstPacket = 0; firstPacket < packetCount;) {
+    //The wave: as many whole packets as fit into WAVEFRONT_SIZE paths
+    int lastPacket = firstPacket;
+    packetStarts.assign(1, 0);
+    while (lastPacket < packetCount) {
+      const PacketRect& rect = packets[lastPacket];
+      int start = packetStarts.back() + (rect.x1 - rect.x0) * (rect.y1 - rect.y0);
+      if (start > WAVEFRONT_SIZE) break;
+      packetStarts.push_back(start);
+      lastPacket++;
+    }
+
+    //Generate the camera rays
+    paths.resize(packetStarts.back());
+    threadPool.parallelFor(firstPacket, lastPacket, WAVEFRONT_CHUNK_SIZE / RAY_PACKET_SIZE, [&](int p) {
+      const PacketRect& rect = packets[p];
+      WavefrontPath* path = &paths[packetStarts[p - firstPacket]];
+      for (int rowIdx = rect.y0; rowIdx < rect.y1; ++rowIdx) {
+        for (int colIdx = rect.x0; colIdx < rect.x1; ++colIdx) {
+          path->ray = computeCameraRay(colIdx, rowIdx, imageHeight, aspectRatio, cam);
+          path->throughput = Vector3(1.0f, 1.0f, 1.0f);
+          path->x = colIdx;
+          path->y = rowIdx;
+          path++;
+        }
+      }
+    });
+
+    //One bounce per iteration, until every path has ended
+    for (int depth = 0; depth < MaxDepth && !paths.empty(); depth++) {
+      //Only camera rays are coherent enough to be intersected as packets
+      intersectStage(scene, paths, depth == 0 && packetTracing ? packetStarts : noPackets, hits);
+
+      if constexpr (Mode == ShadingMode::Barycentric) {
+        //colour pixels based on the barycentric coordinates of the hits, no secondary rays
+        forEachChunk(threadPool, (int)paths.size(), [&](int first, int last) {
+          for (int i = first; i < last; i++) {
+            framebuffer.setPixel(paths[i].x, paths[i].y,
+              hits[i].info.hasIntersection ? shadeBarycentric(hits[i].info.coords) : bgColor);
+          }
+        });
+        paths.clear();
+      }
+      else {
+        sortStage(scene, hits, order, bucketStarts);
+        shadeStage(scene, paths, hits, order, bucketStarts, shadowQueries, diffuseHits, nextPaths, framebuffer);
+        shadowStage(scene, shadowQueries);
+        resolveStage(paths, shadowQueries, diffuseHits, framebuffer);
+        std::swap(paths, nextPaths);
+      }
+    }
+
+    //max depth reached
+    forEachChunk(threadPool, (int)paths.size(), [&](int first, int last) {
+      for (int i = first; i < last; i++) {
+        framebuffer.setPixel(paths[i].x, paths[i].y, bgColor.compMult(paths[i].throughput));
+      }
+    });
+
+    firstPacket = lastPacket;
+  }
+}
+
+void ChaosCampAM::Renderer::intersectStage(const Scene& scene, const std::vector<WavefrontPath>& paths,
+  const std::vector<int>& packetStarts, std::vector<WavefrontHit>& hits) {
+  hits.resize(paths.size());
+
+  if (packetStarts.empty()) {
+    forEachChunk(threadPool, (int)paths.size(), [&](int first, int last) {
+      for (int i = first; i < last; i++) {
+        WavefrontHit& hit = hits[i];
+        hit.meshIndex = 0;
+        hit.instanceIndex = -1;
+        hit.triIndex = 0;
+        findIntersection(paths[i].ray, scene, hit.info, hit.meshIndex, hit.instanceIndex, hit.triIndex);
+        hit.matIndex = hit.info.hasIntersection ? getHitMaterial(scene, hit.meshIndex, hit.instanceIndex) : -1;
+      }
+    });
+    return;
+  }
+
+  //Packets at the border of the image are partial - they are filled up by repeating their last ray
+  int packetCount = (int)packetStarts.size() - 1;
+  threadPool.parallelFor(0, packetCount, WAVEFRONT_CHUNK_SIZE / RAY_PACKET_SIZE, [&](int p) {
+    int first = packetStarts[p];
+    int count = packetStarts[p + 1] - first;
+    Ray rays[RAY_PACKET_SIZE];
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+      rays[i] = paths[first + std::min(i, count - 1)].ray;
+    }
+    RayPacket packet;
+    packet.set(rays);
+
+    PacketHits packetHits;
+    int meshIndex[RAY_PACKET_SIZE];
+    int instanceIndex[RAY_PACKET_SIZE];
+    findIntersection(rays, packet, scene, packetHits, meshIndex, instanceIndex);
+
+    for (int i = 0; i < count; i++) {
+      WavefrontHit& hit = hits[first + i];
+      hit.info = extractPacketHit(rays[i], scene, packetHits, i, meshIndex[i], instanceIndex[i]);
+      hit.meshIndex = meshIndex[i];
+      hit.instanceIndex = instanceIndex[i];
+      hit.triIndex = packetHits.triIndex[i];
+      hit.matIndex = hit.info.hasIntersection ? getHitMaterial(scene, hit.meshIndex, hit.instanceIndex) : -1;
+    }
+  });
+}
+
+void ChaosCampAM::Renderer::sortStage(const Scene& scene, const std::vector<WavefrontHit>& hits,
+  std::vector<int>& order, std::vector<int>& bucketStarts) {
+  //Counting sort, one bucket per material plus one for the misses. Every chunk of hits counts its keys separately,
+  //so that the hits can be scattered in parallel and still keep their order within the buckets.
+  int hitCount = (int)hits.size();
+  int bucketCount = (int)scene.getMaterials().size() + 1;
+  int chunkCount = (hitCount + WAVEFRONT_CHUNK_SIZE - 1) / WAVEFRONT_CHUNK_SIZE;
+  auto bucketOf = [bucketCount](const WavefrontHit& hit) {
+    return hit.matIndex >= 0 ? hit.matIndex : bucketCount - 1;
+  };
+
+  std::vector<int> chunkOffsets(chunkCount * bucketCount, 0);
+  forEachChunk(threadPool, hitCount, [&](int first, int last) {
+    int* counts = &chunkOffsets[first / WAVEFRONT_CHUNK_SIZE * bucketCount];
+    for (int i = first; i < last; i++) {
+      counts[bucketOf(hits[i])]++;
+    }
+  });
+
+  //Turn the counts into the position of the first hit of every chunk within the sorted order
+  bucketStarts.resize(bucketCount + 1);
+  int offset = 0;
+  for (int bucket = 0; bucket < bucketCount; bucket++) {
+    bucketStarts[bucket] = offset;
+    for (int chunk = 0; chunk < chunkCount; chunk++) {
+      int count = chunkOffsets[chunk * bucketCount + bucket];
+      chunkOffsets[chunk * bucketCount + bucket] = offset;
+      offset += count;
+    }
+  }
+  bucketStarts[bucketCount] = offset;
+
+  order.resize(hitCount);
+  forEachChunk(threadPool, hitCount, [&](int first, int last) {
+    int* offsets = &chunkOffsets[first / WAVEFRONT_CHUNK_SIZE * bucketCount];
+    for (int i = first; i < last; i++) {
+      order[offsets[bucketOf(hits[i])]++] = i;
+    }
+  });
+}
+
+void ChaosCampAM::Renderer::shadeStage(const Scene& scene, const std::vector<WavefrontPath>& paths,
+  const std::vector<WavefrontHit>& hits, const std::vector<int>& order, const std::vector<int>& bucketStarts,
+  std::vector<ShadowQuery>& shadowQueries, std::vector<DiffuseHit>& diffuseHits, std::vector<WavefrontPath>& nextPaths,
+  Framebuffer& framebuffer) {
+  const Vector3& bgColor = scene.getSettings().getBgColor();
+  const std::vector<Material>& materials = scene.getMaterials();
+  int materialCount = (int)materials.size();
+
+  //All hits of a material emit the same kind of entry, so every bucket knows where its output goes up front:
+  //the slots of its diffuse hits, or of its reflected paths
+  std::vector<int> slotStarts(materialCount, 0);
+  int diffuseCount = 0;
+  int reflectedCount = 0;
+  for (int matIndex = 0; matIndex < materialCount; matIndex++) {
+    int bucketSize = bucketStarts[matIndex + 1] - bucketStarts[matIndex];
+    if (materials[matIndex].type == MaterialType::Diffuse) {
+      slotStarts[matIndex] = diffuseCount;
+      diffuseCount += bucketSize;
+    }
+    else if (materials[matIndex].type == MaterialType::Reflective) {
+      slotStarts[matIndex] = reflectedCount;
+      reflectedCount += bucketSize;
+    }
+  }
+  diffuseHits.resize(diffuseCount);
+  nextPaths.resize(reflectedCount);
+
+  //Chunks never span two buckets - the material is the same for all hits of a chunk
+  struct ShadeChunk {
+    int bucket, first, last;
+  };
+  std::vector<ShadeChunk> chunks;
+  for (int bucket = 0; bucket <= materialCount; bucket++) {
+    for (int first = bucketStarts[bucket]; first < bucketStarts[bucket + 1]; first += WAVEFRONT_CHUNK_SIZE) {
+      chunks.push_back({ bucket, first, std::min(first + WAVEFRONT_CHUNK_SIZE, bucketStarts[bucket + 1]) });
+    }
+  }
+
+  //The number of lights a hit needs shadow rays for is only known once it is shaded - every chunk collects its
+  //shadow queries separately, they are put together afterwards
+  std::vector<std::vector<ShadowQuery>> chunkQueries(chunks.size());
+  threadPool.parallelFor(0, (int)chunks.size(), 1, [&](int c) {
+    const ShadeChunk& chunk = chunks[c];
+    const Material* mat = chunk.bucket < materialCount ? &materials[chunk.bucket] : nullptr;
+    bool diffuse = mat && mat->type == MaterialType::Diffuse;
+    bool reflective = mat && mat->type == MaterialType::Reflective;
+    std::vector<ShadowQuery>& queries = chunkQueries[c];
+    for (int pos = chunk.first; pos < chunk.last; pos++) {
+      int pathIndex = order[pos];
+      const WavefrontPath& path = paths[pathIndex];
+      const WavefrontHit& hit = hits[pathIndex];
+
+      //missed everything, or a material that ends the path
+      if (!diffuse && !reflective) {
+        framebuffer.setPixel(path.x, path.y, bgColor.compMult(path.throughput));
+        continue;
+      }
+
+      int slot = slotStarts[chunk.bucket] + pos - bucketStarts[chunk.bucket];
+      const Vector3& point = hit.info.intersectionPoint;
+      Vector3 normal = getShadingNormal(scene, *mat, hit.info, hit.meshIndex, hit.instanceIndex, hit.triIndex);
+      if (diffuse) {
+        //lambertian shading - the light of every shadow ray that is not blocked ends up in the pixel
+        DiffuseHit& diffuseHit = diffuseHits[slot];
+        diffuseHit.path = pathIndex;
+        diffuseHit.firstQuery = (int)queries.size();
+        forEachLight(scene, point, normal, mat->albedo,
+          [&](int lightIndex, const Vector3& light, const Ray& shadowRay, float lightDist) {
+            queries.push_back({ shadowRay, lightDist, lightIndex, light, false });
+          });
+        diffuseHit.queryCount = (int)queries.size() - diffuseHit.firstQuery;
+      }
+      else {
+        WavefrontPath& reflected = nextPaths[slot];
+        reflected.ray = computeReflectedRay(path.ray.getDirection(), point, normal);
+        reflected.throughput = path.throughput.compMult(mat->albedo);
+        reflected.x = path.x;
+        reflected.y = path.y;
+      }
+    }
+  });
+
+  //Concatenate the shadow queries of the chunks, in chunk order
+  std::vector<int> queryStarts(chunks.size() + 1, 0);
+  for (int c = 0; c < (int)chunks.size(); c++) {
+    queryStarts[c + 1] = queryStarts[c] + (int)chunkQueries[c].size();
+  }
+  shadowQueries.resize(queryStarts.back());
+  threadPool.parallelFor(0, (int)chunks.size(), 1, [&](int c) {
+    const ShadeChunk& chunk = chunks[c];
+    std::copy(chunkQueries[c].begin(), chunkQueries[c].end(), shadowQueries.begin() + queryStarts[c]);
+    if (chunk.bucket < materialCount && materials[chunk.bucket].type == MaterialType::Diffuse) {
+      int firstSlot = slotStarts[chunk.bucket] + chunk.first - bucketStarts[chunk.bucket];
+      for (int slot = firstSlot; slot < firstSlot + chunk.last - chunk.first; slot++) {
+        diffuseHits[slot].firstQuery += queryStarts[c];
+      }
+    }
+  });
+}
+
+void ChaosCampAM::Renderer::shadowStage(const Scene& scene, std::vector<ShadowQuery>& shadowQueries) {
+  forEachChunk(threadPool, (int)shadowQueries.size(), [&](int first, int last) {
+    for (int i = first; i < last; i++) {
+      const ShadowQuery& query = shadowQueries[i];
+      shadowQueries[i].visible = !isOccluded(query.ray, scene, query.lightDist, query.lightIndex);
+    }
+  });
+}
+
+void ChaosCampAM::Renderer::resolveStage(const std::vector<WavefrontPath>& paths,
+  const std::vector<ShadowQuery>& shadowQueries, const std::vector<DiffuseHit>& diffuseHits, Framebuffer& framebuffer) {
+  //Sum in the order the queries were emitted in, like shadeLambertian()
+  forEachChunk(threadPool, (int)diffuseHits.size(), [&](int first, int last) {
+    for (int slot = first; slot < last; slot++) {
+      const DiffuseHit& diffuseHit = diffuseHits[slot];
+      const WavefrontPath& path = paths[diffuseHit.path];
+      Vector3 finalColor;
+      for (int i = diffuseHit.firstQuery; i < diffuseHit.firstQuery + diffuseHit.queryCount; i++) {
+        if (shadowQueries[i].visible) finalColor = finalColor + shadowQueries[i].light;
+      }
+      framebuffer.setPixel(path.x, path.y, finalColor.compMult(path.throughput));
+    }
+  });
+}
+
+template<ChaosCampAM::ShadingMode Mode, int MaxDepth>
+ChaosCampAM::Vector3 ChaosCampAM::Renderer::rayTrace(const Ray& primaryRay, const Scene& scene) const {
+  InfoIntersect intersectInfo;
+  int meshIndex = 0;
+  int instanceIndex = -1;
+  int triIndex = 0;
+  findIntersection(primaryRay, scene, intersectInfo, meshIndex, instanceIndex, triIndex);
+  return shadeHit<Mode, MaxDepth>(primaryRay, scene, intersectInfo, meshIndex, instanceIndex, triIndex);
+}
+
+template<ChaosCampAM::ShadingMode Mode, int MaxDepth>
+ChaosCampAM::Vector3 ChaosCampAM::Renderer::shadeHit(const Ray& primaryRay, const Scene& scene, const InfoIntersect& hit,
+  int meshIndex, int instanceIndex, int triIndex) const {
+  //initial definitions
+  const Vector3& bgColor = scene.getSettings().getBgColor();//default colour is background colour
+  const std::vector<Material>& materials = scene.getMaterials();
+
+  InfoIntersect intersectInfo = hit;
+
+  if constexpr (Mode == ShadingMode::Barycentric) {
+    //colour pixel based on the barycentric coordinates of the hit, no secondary rays
+    return intersectInfo.hasIntersection ? shadeBarycentric(intersectInfo.coords) : bgColor;
+  }
+  else {
+    //Product of the albedos of the mirrors the ray has been reflected by
+    Vector3 throughput(1.0f, 1.0f, 1.0f);
+    Ray ray = primaryRay;
+
+    for (int depth = 0; depth < MaxDepth; depth++) {
+      //intersect - the hit of the primary ray is given
+      if (depth > 0) findIntersection(ray, scene, intersectInfo, meshIndex, instanceIndex, triIndex);
+      if (!intersectInfo.hasIntersection) break;
+
+      //extract material properties
+      assert(materials.size() > 0);
+      const Material& mat = materials[getHitMaterial(scene, meshIndex, instanceIndex)];
+      Vector3 normal = getShadingNormal(scene, mat, intersectInfo, meshIndex, instanceIndex, triIndex);
+
+      //in case of diffuse material, do lambertian shading - the path ends here
+      if (mat.type == MaterialType::Diffuse) {
+        return shadeLambertian(intersectInfo.intersectionPoint, normal, mat.albedo, scene).compMult(throughput);
+      }
+      //in case of reflective material, go on with the reflected ray
+      else if (mat.type == MaterialType::Reflective) {
+        throughput = throughput.compMult(mat.albedo);
+        ray = computeReflectedRay(ray.getDirection(), intersectInfo.intersectionPoint, normal);
+      }
+      else {
+        break;
+      }
+    }
+
+    //missed everything (or max depth reached)
+    return bgColor.compMult(throughput);
+  }
+}
+
+float ChaosCampAM::Renderer::findIntersection(const Ray& ray, const Scene& scene,
+  InfoIntersect& intersectInfo, int& meshIndex, int& instanceIndex, int& triIndex) const {
+  //Closest intersection among all meshes
+  const std::vector<Mesh>& meshes = scene.getMeshes();
+  const std::vector<MeshInstance>& instances = scene.getInstances();
+  int meshCount = (int)meshes.size();
+  float closestDist = FLT_MAX;
+  InfoIntersect closestIntersect;
+  intersectInfo.hasIntersection = false;
+
+  //Visit the meshes whose bounds the ray enters, nearest first. Each mesh only looks for hits closer than the
+  //closest one so far, and meshes entered behind it are skipped altogether.
+  const DataArray<int>& meshOrder = scene.getBVH().getPrimIndices();
+  int triIndexCurrent = 0;
+  scene.getBVH().traverse(ray, closestDist, [&](int first, int count) {
+    for (int i = first; i < first + count; i++) {
+      int index = meshOrder[i];
+      if (index < meshCount) {
+        float dist = meshes[index].intersect(ray, closestIntersect, triIndexCurrent, closestDist);
+        if (closestIntersect.hasIntersection && dist < closestDist) {
+          closestDist = dist;
+          intersectInfo = closestIntersect;
+          meshIndex = index;
+          instanceIndex = -1;
+          triIndex = triIndexCurrent;
+        }
+      }
+      else {
+        //Instance - intersect its mesh with the ray taken to object space, where distances are 'scale' times longer
+        const MeshInstance& instance = instances[index - meshCount];
+        float scale;
+        Ray objectRay = instance.toObjectSpace(ray, scale);
+        float dist = meshes[instance.getMeshIndex()].intersect(objectRay, closestIntersect, triIndexCurrent,
+          closestDist * scale) / scale;
+        if (closestIntersect.hasIntersection && dist < closestDist) {
+          closestDist = dist;
+          intersectInfo = closestIntersect;
+          intersectInfo.intersectionPoint = ray.getPointOnRay(dist);
+          intersectInfo.triNormal = instance.normalToWorld(closestIntersect.triNormal);
+          meshIndex = instance.getMeshIndex();
+          instanceIndex = index - meshCount;
+          triIndex = triIndexCurrent;
+        }
+      }
+    }
+    return false;
+  });
+
+  //If no intersection occurred, return negative distance
+  return intersectInfo.hasIntersection ? closestDist : -1.0f;
+}
+
+bool ChaosCampAM::Renderer::isOccluded(const Ray& ray, const Scene& scene, float tMax, int lightIndex) const {
+  const std::vector<Mesh>& meshes = scene.getMeshes();
+  const std::vector<MeshInstance>& instances = scene.getInstances();
+  int meshCount = (int)meshes.size();
+
+  //Any-hit test of one primitive of the top-level BVH - a mesh, or an instance with the ray taken to object space.
+  //Either the whole mesh, or only the given triangle block of it.
+  auto occludedBy = [&](int prim, int* blockIndex, bool singleBlock) {
+    if (prim < meshCount) {
+      return singleBlock ? meshes[prim].occludedByBlock(ray, tMax, *blockIndex) :
+        meshes[prim].occluded(ray, tMax, blockIndex);
+    }
+    const MeshInstance& instance = instances[prim - meshCount];
+    float scale;
+    Ray objectRay = instance.toObjectSpace(ray, scale);
+    const Mesh& mesh = meshes[instance.getMeshIndex()];
+    return singleBlock ? mesh.occludedByBlock(objectRay, tMax * scale, *blockIndex) :
+      mesh.occluded(objectRay, tMax * scale, blockIndex);
+  };
+
+  //Try the last blocker of this light first
+  OccluderCache* cache = occluderCaching ? &occluderCaches[threadPool.getThreadIndex()] : nullptr;
+  if (cache) {
+    cache->rays++;
+    Occluder& last = cache->occluders[lightIndex];
+    if (last.prim >= 0 && occludedBy(last.prim, &last.block, true)) {
+      cache->blocked++;
+      cache->hits++;
+      return true;
+    }
+  }
+
+  const DataArray<int>& meshOrder = scene.getBVH().getPrimIndices();
+  bool occluded = false;
+  scene.getBVH().traverse(ray, tMax, [&](int first, int count) {
+    for (int i = first; i < first + count && !occluded; i++) {
+      int blockIndex;
+      occluded = occludedBy(meshOrder[i], &blockIndex, false);
+      if (occluded && cache) {
+        cache->occluders[lightIndex].prim = meshOrder[i];
+        cache->occluders[lightIndex].block = blockIndex;
+      }
+    }
+    return occluded;
+  });
+
+  //The cache is only tried right after a blocked ray - lit regions do not pay for a test that keeps failing
+  if (cache && occluded) cache->blocked++;
+  if (cache && !occluded) cache->occluders[lightIndex].prim = -1;
+  return occluded;
+}
+
+void ChaosCampAM::Renderer::findIntersection(const Ray* rays, const RayPacket& packet, const Scene& scene,
+  PacketHits& hits, int* meshIndex, int* instanceIndex) const {
+  const std::vector<Mesh>& meshes = scene.getMeshes();
+  const std::vector<MeshInstance>& instances = scene.getInstances();
+  int meshCount = (int)meshes.size();
+
+  //Meshes are culled behind the farthest hit of the packet
+  const DataArray<int>& meshOrder = scene.getBVH().getPrimIndices();
+  float tMax = hits.maxDist();
+  scene.getBVH().traversePacket(packet, tMax, [&](int first, int count) {
+    for (int i = first; i < first + count; i++) {
+      int index = meshOrder[i];
+      uint64_t hitMask = 0;
+      if (index < meshCount) {
+        hitMask = meshes[index].intersect(packet, hits);
+        for (int r = 0; r < RAY_PACKET_SIZE; r++) {
+          if (!(hitMask & ((uint64_t)1 << r))) continue;
+          meshIndex[r] = index;
+          instanceIndex[r] = -1;
+        }
+      }
+      else {
+        //Instance - the rays taken to object space still share their origin, so they make a packet of their own
+        const MeshInstance& instance = instances[index - meshCount];
+        Ray objectRays[RAY_PACKET_SIZE];
+        float scale[RAY_PACKET_SIZE];
+        PacketHits objectHits;
+        for (int r = 0; r < RAY_PACKET_SIZE; r++) {
+          objectRays[r] = instance.toObjectSpace(rays[r], scale[r]);
+          objectHits.dist[r] = hits.dist[r] * scale[r];
+        }
+        RayPacket objectPacket;
+        objectPacket.set(objectRays);
+
+        uint64_t objectHitMask = meshes[instance.getMeshIndex()].intersect(objectPacket, objectHits);
+        for (int r = 0; r < RAY_PACKET_SIZE; r++) {
+          if (!(objectHitMask & ((uint64_t)1 << r))) continue;
+          float dist = objectHits.dist[r] / scale[r];
+          if (dist < hits.dist[r]) {
+            hits.dist[r] = dist;
+            hits.u[r] = objectHits.u[r];
+            hits.v[r] = objectHits.v[r];
+            hits.triIndex[r] = objectHits.triIndex[r];
+            meshIndex[r] = instance.getMeshIndex();
+            instanceIndex[r] = index - meshCount;
+            hitMask |= (uint64_t)1 << r;
+          }
+        }
+      }
+      if (hitMask) tMax = hits.maxDist();
+    }
+    return false;
+  });
+}
+
+ChaosCampAM::InfoIntersect ChaosCampAM::Renderer::extractPacketHit(const Ray& ray, const Scene& scene,
+  const PacketHits& hits, int i, int meshIndex, int instanceIndex) const {
+  InfoIntersect intersectInfo;
+  if (hits.triIndex[i] < 0) return intersectInfo;
+
+  intersectInfo.triNormal = scene.getMeshes()[meshIndex].getTriNormals()[hits.triIndex[i]];
+  if (instanceIndex >= 0) {
+    intersectInfo.triNormal = scene.getInstances()[instanceIndex].normalToWorld(intersectInfo.triNormal);
+  }
+  intersectInfo.intersectionPoint = ray.getPointOnRay(hits.dist[i]);
+  intersectInfo.coords[0] = 1.0f - hits.u[i] - hits.v[i];
+  intersectInfo.coords[1] = hits.u[i];
+  intersectInfo.coords[2] = hits.v[i];
+  intersectInfo.hasIntersection = true;
+  return intersectInfo;
+}
+
+ChaosCampAM::Vector3 ChaosCampAM::Renderer::extractHitNormal(const std::vector<Mesh>& meshes, const InfoIntersect& intersectInfo, 
+  int meshIndex, int triIndex) const {
+
+  //extract the triangles and vertex normals of the intersected mesh
+  const DataArray<TriProxy>& triangles = meshes[meshIndex].getTriangles();
+  const DataArray<Vector3>& vertexNormals = meshes[meshIndex].getVertNormals();
+
+  //find the vertex normals of the intersected triangle within the mesh
+  Vector3 normal0 = vertexNormals[triangles[triIndex].v0];
+  Vector3 normal1 = vertexNormals[triangles[triIndex].v1];
+  Vector3 normal2 = vertexNormals[triangles[triIndex].v2];
+
+  //calculate hit normal as a weighted sum of the three vertex normals
+  return intersectInfo.coords[0] * normal0 + intersectInfo.coords[1] * normal1 + intersectInfo.coords[2] * normal2;
+}
+
+int ChaosCampAM::Renderer::getHitMaterial(const Scene& scene, int meshIndex, int instanceIndex) const {
+  if (instanceIndex >= 0 && scene.getInstances()[instanceIndex].getMatIndex() >= 0) {
+    return scene.getInstances()[instanceIndex].getMatIndex();
+  }
+  return scene.getMeshes()[meshIndex].getMatIndex();
+}
+
+ChaosCampAM::Vector3 ChaosCampAM::Renderer::getShadingNormal(const Scene& scene, const Material& mat,
+  const InfoIntersect& intersectInfo, int meshIndex, int instanceIndex, int triIndex) const {
+  if (!mat.smoothShading) return intersectInfo.triNormal;
+
+  //take hit normal, interpolated in the object space of the mesh
+  Vector3 normal = extractHitNormal(scene.getMeshes(), intersectInfo, meshIndex, triIndex);
+  if (instanceIndex >= 0) normal = scene.getInstances()[instanceIndex].normalToWorld(normal);
+  return normal;
+}
+
+ChaosCampAM::Vector3 ChaosCampAM::Renderer::shadeLambertian(const Vector3& point, const Vector3& normal, 
+  const Vector3& albedo, const Scene& scene) const {
+  Vector3 finalColor;
+  forEachLight(scene, point, normal, albedo, [&](int lightIndex, const Vector3& light, const Ray& shadowRay,
+    float lightDist) {
+    if (!isOccluded(shadowRay, scene, lightDist, lightIndex)) {
+      //no intersection, i.e. no shadow
+      finalColor = finalColor + light;
+    }
+  });
+  return finalColor;
+}
+
+ChaosCampAM::Vector3 ChaosCampAM::Renderer::directLight(const Vector3& point, const Vector3& normal,
+  const Vector3& albedo, const PointLight& pointLight, Ray& shadowRay, float& lightDist) const {
+  //Direction from point to light
+  Vector3 lightDir = pointLight.pos - point;
+  //Sphere radius
+  float rad = lightDir.getLen();
+  //Normalise light direction
+  lightDir = lightDir * (1 / rad);
+
+  //Lambertian shading
+  float cos = std::max(0.0f, lightDir.dot(normal));
+  float sphereArea = 4 * PI * rad * rad;
+
+  //Only geometry between the (biased) shadow ray origin and the light can cast a shadow
+  Vector3 shadowOrigin = point + normal * SHADOW_BIAS;
+  shadowRay = Ray(shadowOrigin, lightDir);
+  lightDist = (pointLight.pos - shadowOrigin).getLen();
+
+  float r = (pointLight.intensity * albedo.x*cos) / (sphereArea);
+  float g = (pointLight.intensity * albedo.y*cos) / (sphereArea );
+  float b = (pointLight.intensity * albedo.z*cos) / (sphereArea );
+  return Vector3(r, g, b);
+}
+
+ChaosCampAM::Vector3 ChaosCampAM::Renderer::shadeBarycentric(float coords[3]) const {
+  assert(abs(coords[0] + coords[1] + coords[2] - 1.0f) < EPSILON_RELAXED);
+  return Vector3(coords[0], coords[1], coords[2]);
+}
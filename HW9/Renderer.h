@@ -1,59 +1,291 @@
-#pragma once
-#include<string>
-#include<fstream>
-#include<vector>
-
-namespace ChaosCampAM {
-
-  //Forward declarations
-  class Scene;
-  class Ray;
-  class Mesh;
-  class Material;
-  class Camera;
-  class Vector3;
-  class ColorRGB;
-  class InfoIntersect;
-
-  //Shading mode
-  enum class ShadingMode {Light, Barycentric};
-
-  /*
-  * A Ray-Tracing Renderer. Takes a scene description and renders an image file.
-  * De-coupled from any scene data - a universal renderer that can be applied to many different scenes.
-  */
-  class Renderer {
-  public:
-    Renderer() {} //empty constructor
-
-    //Render a scene to a .ppm file with the given filename (newly created).
-    void render(const Scene& scene, const std::string& filename, const ShadingMode& shadingMode);
-
-  private:
-    
-    //Trace the given ray into the scene and determine colour at intersection point (if any). In case of no intersection, returns
-    //the background colour.
-    //Recursively traces new rays into the scene uppon hitting a reflective material.
-    //
-    //Note: colour is returned as a vector (colour values between 0.0 and 1.0)
-    Vector3 rayTrace(const Ray& ray, int depth, ShadingMode shadingMode, const Scene& scene);
-
-    //Find the closest intersection point (if any) of a ray with a collection of meshes.
-    // - Returns distance to closest intersection. Intersection point stored in 'intersection'.
-    // - If no intersection found, returns -1.0.
-    float findIntersection(const Ray& ray, const std::vector<Mesh>& meshes, InfoIntersect& intersectInfo, 
-      int& meshIndex, int& triIndex);
-
-    //Given the available intersection information (intersection point, index of intersected mesh, index of intersected triangle),
-    //compute the hit normal (interpolated from the three vertex normals at the vertices of the triangle).
-    Vector3 extractHitNormal(const std::vector<Mesh>& meshes, const InfoIntersect& intersectInfo, int meshIndex, int triIndex);
-
-    //Perform Lambertian shading on a given point. 
-    //Diffuse lighting for now.
-    Vector3 shadeLambertian(const Vector3& point, const Vector3& normal, const Vector3& albedo, const Scene& scene);
-    
-    //Color point based on its barycentric coordinates. No lights required.
-    Vector3 shadeBarycentric(float coords[3]);
-    
-  };
+#pragma once
+#include<string>
+#include<fstream>
+#include<vector>
+#include<future>
+#include<functional>
+#include<cstdint>
+#include"ThreadPool.h"
+
+namespace ChaosCampAM {
+
+  //Forward declarations
+  class Scene;
+  class Ray;
+  class Mesh;
+  class Material;
+  class Camera;
+  class Vector3;
+  class InfoIntersect;
+  struct PointLight;
+  struct RayPacket;
+  struct PacketHits;
+
+  //Shading mode
+  enum class ShadingMode {Light, Barycentric};
+
+  //How the rays of an image are scheduled (the image is the same either way):
+  // - Recursive: pixel by pixel - every path is followed to its end (reflections, shadow rays) before the next starts.
+  // - Wavefront: breadth-first - the rays of many pixels are kept in queues and traced stage by stage (intersection,
+  //   shading sorted by material, shadow rays), each stage one tight parallel loop over its queue.
+  enum class RenderEngine {Recursive, Wavefront};
+
+  class Framebuffer;
+
+  //Adaptive anti-aliasing (see Renderer::setAdaptiveSampling()). Every pixel starts with 'minSamples' samples; pixels
+  //that differ from a neighbour, or whose samples disagree, get more, 4 at a time, up to 'maxSamples'.
+  struct AdaptiveSampling {
+    bool enabled = false;
+    int minSamples = 4; //1 (the pixel centre) or 4 (one jittered sample per quarter of the pixel)
+    int maxSamples = 16;
+    //Pixels are refined while the standard error of the mean luminance of their samples is above 'errorThreshold'.
+    //Pixels differing by more than 'contrastThreshold' in luminance from a neighbour are refined at least once.
+    //Luminance is measured as in the image (components clamped to [0;1]).
+    float errorThreshold = 0.005f;
+    float contrastThreshold = 0.05f;
+    //If not empty, an image of the samples taken per pixel is written there as well (black: 'minSamples',
+    //through red and yellow, to white: 'maxSamples')
+    std::string heatmapFilename;
+  };
+
+  //Progressive rendering (see Renderer::renderProgressive()).
+  //The first pass traces one pixel per 'coarseBlockSize' x 'coarseBlockSize' block and fills the block with it; every
+  //further pass halves the blocks, until all pixels are traced. Passes after that add a jittered sample to every pixel.
+  struct ProgressiveSettings {
+    int coarseBlockSize = 8; //power of 2, at most RENDER_TILE_SIZE
+    int sampleTarget = 16; //stop once every pixel has this many samples
+    //Stop once this much time has passed (0: no limit). Tiles of a pass are no longer started beyond it - only the
+    //first pass is always completed.
+    double timeBudgetMs = 0.0;
+    //The current image is flushed after a pass if at least this much time passed since the last flush, and always
+    //after the last pass
+    double flushIntervalMs = 250.0;
+    //Called on every flush, on the calling thread, with the samples traced so far and the number of the pass
+    std::function<void(const Framebuffer& framebuffer, int pass)> onFlush;
+  };
+
+  //Shadow rays traced by the last render() call
+  struct ShadowRayStats {
+    uint64_t rays = 0;
+    uint64_t blocked = 0;
+    uint64_t cacheHits = 0; //blocked rays found by the occluder cache, without traversing the scene
+  };
+
+  /*
+  * A Ray-Tracing Renderer. Takes a scene description and renders an image file.
+  * De-coupled from any scene data - a universal renderer that can be applied to many different scenes.
+  * The image is split into tiles that are traced in parallel. The scene and the renderer are only read while tracing,
+  * and every pixel is computed independently, so the output does not depend on the number of threads.
+  * Rays are traced either pixel by pixel, or breadth-first through ray queues (see RenderEngine).
+  */
+  class Renderer {
+  public:
+    //'threadCount' = number of threads tracing the image. 0 uses one thread per hardware thread.
+    Renderer(int threadCount = 0) : threadPool(threadCount) {}
+    //Waits for the last image to be written.
+    ~Renderer();
+
+    //Render a scene to an image file with the given filename (newly created). The format is picked by the extension:
+    //".png" for PNG, anything else for a binary .ppm.
+    //The image is traced into an in-memory framebuffer, then written on a background thread - the call returns as soon
+    //as tracing is done. Use waitForOutput() to make sure the file is complete.
+    void render(const Scene& scene, const std::string& filename, const ShadingMode& shadingMode);
+
+    //Render a scene progressively - a coarse image first, refined pass by pass (see ProgressiveSettings). Every
+    //flush writes the current image to 'filename' (unless it is empty) and calls 'settings.onFlush' (if set).
+    //The image is the same as that of render() once every pixel has been traced, then sampled further.
+    void renderProgressive(const Scene& scene, const std::string& filename, const ShadingMode& shadingMode,
+      const ProgressiveSettings& settings);
+
+    //Block until the image of the last render() call has been written to disk.
+    void waitForOutput();
+
+    int getThreadCount() const;
+
+    //Find the primary hits of whole packets of camera rays (on by default). The image is the same either way.
+    void setPacketTracing(bool enabled);
+
+    //Ray scheduling (recursive by default)
+    void setEngine(RenderEngine engine);
+
+    //Test the triangles that blocked the last shadow ray towards the same light first, before traversing the scene
+    //(on by default). Neighbouring points tend to be shadowed by the same triangles. The image is the same either way.
+    void setOccluderCache(bool enabled);
+
+    //Anti-alias by adaptive supersampling. Off by default - one ray through the centre of every pixel.
+    //Sampled images are always traced by the recursive engine, without packets.
+    void setAdaptiveSampling(const AdaptiveSampling& sampling);
+
+    //Shadow rays of the last render() call (counted only while the occluder cache is on, and printed to stdout)
+    const ShadowRayStats& getShadowRayStats() const;
+
+    //Lights that would add less than 'threshold' (in linear colour, 1.0 = white) to a diffuse point are skipped,
+    //without tracing their shadow rays. Lights behind the surface are always skipped. With the default of 0, only
+    //those are - the image is the same as with all lights traced.
+    void setLightThreshold(float threshold);
+
+  private:
+    //Queue entries of the wavefront engine, see Renderer.cpp
+    struct PacketRect;
+    struct WavefrontPath;
+    struct WavefrontHit;
+    struct ShadowQuery;
+    struct DiffuseHit;
+    //Per-pixel luminance statistics of adaptive sampling, see Renderer.cpp
+    struct SampleStats;
+
+    //Trace all pixels of the tile [x0;x1) x [y0;y1) into the framebuffer.
+    template<ShadingMode Mode, int MaxDepth>
+    void renderTile(const Scene& scene, int x0, int y0, int x1, int y1, Framebuffer& framebuffer) const;
+
+    //Trace the pixels [x0;x1) x [y0;y1) (at most RAY_PACKET_WIDTH x RAY_PACKET_WIDTH) as one packet of camera rays.
+    //Only the primary hits are found for the whole packet - reflected rays diverge and are traced one by one.
+    template<ShadingMode Mode, int MaxDepth>
+    void renderPacket(const Scene& scene, int x0, int y0, int x1, int y1, Framebuffer& framebuffer) const;
+
+    //Adaptive sampling: every tile takes the initial samples of its pixels, then, once all tiles are done (so that
+    //the pixels of neighbouring tiles can be compared), refines its pixels.
+    template<ShadingMode Mode, int MaxDepth>
+    void renderAdaptive(const Scene& scene, Framebuffer& framebuffer);
+    template<ShadingMode Mode, int MaxDepth>
+    void sampleTile(const Scene& scene, int x0, int y0, int x1, int y1, bool refine, Framebuffer& framebuffer,
+      SampleStats& stats) const;
+    //Trace samples [first; first + count) of pixel (x, y) into the framebuffer
+    template<ShadingMode Mode, int MaxDepth>
+    void addSamples(const Scene& scene, int x, int y, int first, int count, Framebuffer& framebuffer,
+      SampleStats& stats) const;
+
+    //Progressive pass over the tile [x0;x1) x [y0;y1): with 'blockSize' > 0 trace the pixels at the corners of the
+    //blocks of that size not traced by earlier passes and fill their blocks, otherwise add sample 'sampleIndex' to
+    //every pixel
+    template<ShadingMode Mode, int MaxDepth>
+    void progressiveTile(const Scene& scene, int x0, int y0, int x1, int y1, int blockSize, int coarseBlockSize,
+      int sampleIndex, Framebuffer& framebuffer) const;
+
+    //Occluder caches for a new image / sum of their counts into 'shadowRayStats' once it is traced
+    void resetOccluderCaches(const Scene& scene);
+    void collectShadowRayStats();
+
+    //Write a copy of the framebuffer to an image file on a background thread, once the previous image has been written
+    void writeInBackground(const std::string& filename, const Framebuffer& framebuffer);
+
+    //Wavefront engine: trace the image in waves of at most WAVEFRONT_SIZE camera rays. The paths of a wave are
+    //advanced one bounce at a time through the stages below, until all of them have ended or MaxDepth is reached.
+    template<ShadingMode Mode, int MaxDepth>
+    void renderWavefront(const Scene& scene, Framebuffer& framebuffer);
+
+    //Wavefront stages. Each one is a parallel loop over a queue, writing its results to separate queues.
+    //Closest hits of 'paths'. Camera rays are intersected as packets, given by the start of each in 'packetStarts'.
+    void intersectStage(const Scene& scene, const std::vector<WavefrontPath>& paths,
+      const std::vector<int>& packetStarts, std::vector<WavefrontHit>& hits);
+    //Indices of 'hits' sorted by material (stable), misses last. 'bucketStarts' receives where the hits of every
+    //material start in 'order', with one more entry for the misses and one for the end.
+    void sortStage(const Scene& scene, const std::vector<WavefrontHit>& hits, std::vector<int>& order,
+      std::vector<int>& bucketStarts);
+    //Shade the sorted hits: diffuse hits emit a shadow query per light that may light them (see 'diffuseHits'),
+    //reflective hits continue as the reflected path in 'nextPaths'; the other paths end and are written out.
+    void shadeStage(const Scene& scene, const std::vector<WavefrontPath>& paths, const std::vector<WavefrontHit>& hits,
+      const std::vector<int>& order, const std::vector<int>& bucketStarts, std::vector<ShadowQuery>& shadowQueries,
+      std::vector<DiffuseHit>& diffuseHits, std::vector<WavefrontPath>& nextPaths, Framebuffer& framebuffer);
+    //Trace the shadow queries, then sum the unoccluded light of every diffuse hit into its pixel
+    void shadowStage(const Scene& scene, std::vector<ShadowQuery>& shadowQueries);
+    void resolveStage(const std::vector<WavefrontPath>& paths, const std::vector<ShadowQuery>& shadowQueries,
+      const std::vector<DiffuseHit>& diffuseHits, Framebuffer& framebuffer);
+    
+    //Trace the given ray into the scene and determine colour at intersection point (if any). In case of no intersection, returns
+    //the background colour.
+    //Uppon hitting a reflective material the reflected ray is followed in a loop, carrying the product of the albedos met
+    //so far. At most 'MaxDepth' rays are traced - the background colour is used beyond that.
+    //The shading mode and depth are compile-time parameters, picked once per image in render().
+    //
+    //Note: colour is returned as a vector (colour values between 0.0 and 1.0)
+    template<ShadingMode Mode, int MaxDepth>
+    Vector3 rayTrace(const Ray& ray, const Scene& scene) const;
+
+    //Same as rayTrace(), with the closest hit of the ray already found (see findIntersection()).
+    template<ShadingMode Mode, int MaxDepth>
+    Vector3 shadeHit(const Ray& ray, const Scene& scene, const InfoIntersect& hit, int meshIndex, int instanceIndex,
+      int triIndex) const;
+
+    //Find the closest intersection point (if any) of a ray with the meshes and mesh instances of the scene.
+    //Only meshes whose bounds the ray enters are visited, front-to-back, through the top-level BVH of the scene.
+    // - Returns distance to closest intersection. Intersection point stored in 'intersection'.
+    // - If no intersection found, returns -1.0.
+    //'meshIndex' is the mesh hit; 'instanceIndex' the instance it was hit through, or -1 if the mesh itself was hit.
+    //Intersection point and triangle normal are in world space either way.
+    float findIntersection(const Ray& ray, const Scene& scene, InfoIntersect& intersectInfo, 
+      int& meshIndex, int& instanceIndex, int& triIndex) const;
+
+    //Closest hits of a packet of rays ('rays' and 'packet' hold the same RAY_PACKET_SIZE rays). Meshes are culled for
+    //the whole packet through the top-level BVH of the scene.
+    //Per ray, 'hits' and 'meshIndex' / 'instanceIndex' receive what findIntersection() finds for it.
+    void findIntersection(const Ray* rays, const RayPacket& packet, const Scene& scene, PacketHits& hits,
+      int* meshIndex, int* instanceIndex) const;
+
+    //Hit information of ray 'i' of a packet, filled in the way findIntersection() does for a single ray
+    InfoIntersect extractPacketHit(const Ray& ray, const Scene& scene, const PacketHits& hits, int i, int meshIndex,
+      int instanceIndex) const;
+
+    //Any-hit query for shadow rays - true if some mesh or mesh instance of the scene blocks the ray closer than 'tMax'
+    //(i.e. between the ray origin and the light). Exits on the first blocker found.
+    //The blocker of the last shadow ray towards light 'lightIndex' is tried first (see setOccluderCache()).
+    bool isOccluded(const Ray& ray, const Scene& scene, float tMax, int lightIndex) const;
+
+    //Given the available intersection information (intersection point, index of intersected mesh, index of intersected triangle),
+    //compute the hit normal (interpolated from the three vertex normals at the vertices of the triangle).
+    Vector3 extractHitNormal(const std::vector<Mesh>& meshes, const InfoIntersect& intersectInfo, int meshIndex, int triIndex) const;
+
+    //Material of a hit - an instance may override the material of its mesh
+    int getHitMaterial(const Scene& scene, int meshIndex, int instanceIndex) const;
+
+    //Normal to shade a hit with: the triangle normal, or the interpolated vertex normal for smooth shading.
+    Vector3 getShadingNormal(const Scene& scene, const Material& mat, const InfoIntersect& intersectInfo, int meshIndex,
+      int instanceIndex, int triIndex) const;
+
+    //Perform Lambertian shading on a given point. 
+    //Diffuse lighting for now.
+    Vector3 shadeLambertian(const Vector3& point, const Vector3& normal, const Vector3& albedo, const Scene& scene) const;
+
+    //Light a point light adds to a diffuse point unless it is in shadow, and the shadow ray to test that with
+    //(blocked by geometry closer than 'lightDist').
+    Vector3 directLight(const Vector3& point, const Vector3& normal, const Vector3& albedo, const PointLight& light,
+      Ray& shadowRay, float& lightDist) const;
+
+    //Visit the lights that may light a diffuse point (see setLightThreshold()), found through the light tree of the
+    //scene. 'lightFunc(int lightIndex, const Vector3& light, const Ray& shadowRay, float lightDist)' receives what
+    //directLight() gives for each of them.
+    template<typename LightFunc>
+    void forEachLight(const Scene& scene, const Vector3& point, const Vector3& normal, const Vector3& albedo,
+      LightFunc lightFunc) const;
+    
+    //Color point based on its barycentric coordinates. No lights required.
+    Vector3 shadeBarycentric(float coords[3]) const;
+
+    //Triangle block that blocked the last shadow ray towards a light: 'prim' is the mesh or instance (as a primitive
+    //of the top-level BVH of the scene), -1 if there is none yet
+    struct Occluder {
+      int prim = -1;
+      int block = -1;
+    };
+
+    //Occluders of one thread, one per light. Aligned so that no two threads write to the same cache line.
+    struct alignas(64) OccluderCache {
+      std::vector<Occluder> occluders;
+      uint64_t rays = 0;
+      uint64_t blocked = 0;
+      uint64_t hits = 0;
+    };
+
+    ThreadPool threadPool;
+    bool packetTracing = true;
+    RenderEngine engine = RenderEngine::Recursive;
+    float lightThreshold = 0.0f;
+    bool occluderCaching = true;
+    AdaptiveSampling sampling;
+    //Indexed by ThreadPool::getThreadIndex(). Only touched by the owning thread while tracing.
+    mutable std::vector<OccluderCache> occluderCaches;
+    ShadowRayStats shadowRayStats;
+    std::future<void> pendingOutput; //image file being written in the background
+
+  };
 }
\ No newline at end of file
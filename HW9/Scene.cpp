@@ -1,74 +1,249 @@
-#include "Scene.h"
-#include <fstream>
-#include <iostream>
-
-namespace ChaosCampAM {
-  Scene::Scene() {}
-
-  const std::vector<Mesh>& Scene::getMeshes() const {
-    return meshes;
-  }
-
-  const std::vector<Material>& Scene::getMaterials() const {
-    return materials;
-  }
-
-  const Camera& Scene::getCamera() const {
-    return cam;
-  }
-
-  const Settings& Scene::getSettings() const {
-    return settings;
-  }
-
-  const std::vector<PointLight>& Scene::getPointLights() const {
-    return pointLights;
-  }
-
-  void Scene::setCamera(const Camera& newCam) {
-    cam = newCam;
-  }
-
-  void Scene::setSettings(const Settings& newSettings) {
-    settings = newSettings;
-  }
-
-  void Scene::setMeshes(const std::vector<Mesh>& newMeshes) {
-    meshes = newMeshes;
-  }
-
-  void Scene::setMaterials(const std::vector<Material>& newMaterials) {
-    materials = newMaterials;
-  }
-
-  void Scene::setPointLights(const std::vector<PointLight>& newPointLights) {
-    pointLights = newPointLights;
-  }
-
-  void Scene::addMesh(const Mesh& mesh) {
-    meshes.push_back(mesh);
-  }
-  void Scene::addMesh(const std::vector<Vector3>& vertices, const std::vector<TriProxy>& triangles, int matIndex) {
-    meshes.emplace_back(vertices, triangles, matIndex);
-  }
-
-  void Scene::addMaterial(const Material& mat) {
-    materials.push_back(mat);
-  }
-
-  void Scene::addPointLight(const PointLight& pointLight) {
-    pointLights.push_back(pointLight);
-  }
-
-  void Scene::reserveMeshes(int numMeshes) {
-    meshes.reserve(numMeshes);
-  }
-
-  void Scene::reserveMaterials(int numMaterials) {
-    materials.reserve(numMaterials);
-  }
-
-  void Scene::reservePointLights(int numPointLights) {
-    pointLights.reserve(numPointLights);
-  }
+#include "Scene.h"
+#include "BinaryIO.h"
+#include "Constants.h"
+#include <assert.h>
+#include <fstream>
+#include <iostream>
+
+namespace ChaosCampAM {
+  Scene::Scene() {}
+
+  const std::vector<Mesh>& Scene::getMeshes() const {
+    return meshes;
+  }
+
+  const std::vector<MeshInstance>& Scene::getInstances() const {
+    return instances;
+  }
+
+  const std::vector<Material>& Scene::getMaterials() const {
+    return materials;
+  }
+
+  const Camera& Scene::getCamera() const {
+    return cam;
+  }
+
+  const Settings& Scene::getSettings() const {
+    return settings;
+  }
+
+  const std::vector<PointLight>& Scene::getPointLights() const {
+    return pointLights;
+  }
+
+  const BVH& Scene::getBVH() const {
+    return meshBVH;
+  }
+
+  const LightTree& Scene::getLightTree() const {
+    return lightTree;
+  }
+
+  void Scene::setCamera(const Camera& newCam) {
+    cam = newCam;
+  }
+
+  void Scene::setSettings(const Settings& newSettings) {
+    settings = newSettings;
+  }
+
+  void Scene::setMeshes(const std::vector<Mesh>& newMeshes) {
+    meshes = newMeshes;
+  }
+
+  void Scene::setMeshes(std::vector<Mesh>&& newMeshes) {
+    meshes = std::move(newMeshes);
+  }
+
+  void Scene::setMaterials(const std::vector<Material>& newMaterials) {
+    materials = newMaterials;
+  }
+
+  void Scene::setPointLights(const std::vector<PointLight>& newPointLights) {
+    pointLights = newPointLights;
+  }
+
+  void Scene::addMesh(const Mesh& mesh) {
+    meshes.push_back(mesh);
+  }
+  void Scene::addMesh(Mesh&& mesh) {
+    meshes.push_back(std::move(mesh));
+  }
+  void Scene::addMesh(const std::vector<Vector3>& vertices, const std::vector<TriProxy>& triangles, int matIndex,
+    BVHBuildMode buildMode) {
+    meshes.emplace_back(vertices, triangles, matIndex, buildMode);
+  }
+  void Scene::addMesh(std::vector<Vector3>&& vertices, std::vector<TriProxy>&& triangles, int matIndex,
+    BVHBuildMode buildMode) {
+    meshes.emplace_back(std::move(vertices), std::move(triangles), matIndex, buildMode);
+  }
+
+  void Scene::addInstance(const MeshInstance& instance) {
+    instances.push_back(instance);
+  }
+
+  void Scene::addMaterial(const Material& mat) {
+    materials.push_back(mat);
+  }
+
+  void Scene::addPointLight(const PointLight& pointLight) {
+    pointLights.push_back(pointLight);
+  }
+
+  void Scene::reserveMeshes(int numMeshes) {
+    meshes.reserve(numMeshes);
+  }
+
+  void Scene::reserveInstances(int numInstances) {
+    instances.reserve(numInstances);
+  }
+
+  void Scene::reserveMaterials(int numMaterials) {
+    materials.reserve(numMaterials);
+  }
+
+  void Scene::reservePointLights(int numPointLights) {
+    pointLights.reserve(numPointLights);
+  }
+
+  void Scene::buildBVH() {
+    //Meshes are already in world space, so the root box of each mesh BVH is its world bound
+    std::vector<AABB> meshBounds;
+    meshBounds.reserve(meshes.size() + instances.size());
+    for (const Mesh& mesh : meshes) {
+      meshBounds.push_back(mesh.getBVH().getBounds());
+    }
+    //Instances are bounded by the transformed root box of their mesh
+    for (const MeshInstance& instance : instances) {
+      assert(instance.getMeshIndex() >= 0 && instance.getMeshIndex() < (int)meshes.size());
+      meshBounds.push_back(instance.boundsToWorld(meshes[instance.getMeshIndex()].getBVH().getBounds()));
+    }
+    meshBVH.build(meshBounds);
+    lightTree.build(pointLights);
+  }
+
+  void Scene::rebuildBVHs(BVHBuildMode mode) {
+    for (Mesh& mesh : meshes) {
+      mesh.buildBVH(mode);
+    }
+    buildBVH();
+  }
+
+  bool Scene::isValid() const {
+    int meshCount = (int)meshes.size();
+    int materialCount = (int)materials.size();
+    if (settings.getWidth() < 1 || settings.getWidth() > MAX_IMAGE_SIZE || settings.getHeight() < 1 ||
+      settings.getHeight() > MAX_IMAGE_SIZE) {
+      return false;
+    }
+    for (const Material& mat : materials) {
+      if (mat.type != MaterialType::Diffuse && mat.type != MaterialType::Reflective) return false;
+    }
+    for (const Mesh& mesh : meshes) {
+      if (!mesh.isValid(materialCount)) return false;
+    }
+    for (const MeshInstance& instance : instances) {
+      //-1 for the material of the mesh
+      if (instance.getMeshIndex() < 0 || instance.getMeshIndex() >= meshCount || instance.getMatIndex() < -1 ||
+        instance.getMatIndex() >= materialCount || instance.getTransform().getDeterminant() == 0.0f) {
+        return false;
+      }
+    }
+    return meshBVH.isValid(meshCount + (int)instances.size());
+  }
+
+  void Scene::write(BinaryWriter& writer) const {
+    writer.write((int32_t)settings.getWidth());
+    writer.write((int32_t)settings.getHeight());
+    writer.write(settings.getBgColor());
+
+    //Camera orientation row by row
+    writer.write(cam.getPosition());
+    for (int row = 0; row < 3; row++) {
+      for (int col = 0; col < 3; col++) {
+        writer.write(cam.getOrientation().getEntry(row, col));
+      }
+    }
+
+    writer.writeArray(pointLights);
+
+    //Materials member by member, so that no padding bytes end up in the file
+    writer.write((uint64_t)materials.size());
+    for (const Material& mat : materials) {
+      writer.write((int32_t)mat.type);
+      writer.write(mat.albedo);
+      writer.write((int32_t)mat.smoothShading);
+    }
+
+    writer.write((uint64_t)meshes.size());
+    for (const Mesh& mesh : meshes) {
+      mesh.write(writer);
+    }
+
+    //Instances by their defining members, the inverse transforms are recomputed on loading
+    writer.write((uint64_t)instances.size());
+    for (const MeshInstance& instance : instances) {
+      writer.write((int32_t)instance.getMeshIndex());
+      writer.write((int32_t)instance.getMatIndex());
+      for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 3; col++) {
+          writer.write(instance.getTransform().getEntry(row, col));
+        }
+      }
+      writer.write(instance.getTranslation());
+    }
+    meshBVH.write(writer);
+  }
+
+  bool Scene::read(BinaryReader& reader) {
+    int32_t width, height;
+    Vector3 bgColor;
+    if (!reader.read(width) || !reader.read(height) || !reader.read(bgColor)) return false;
+    settings = Settings(width, height, bgColor);
+
+    Vector3 camPos;
+    float m[3][3];
+    if (!reader.read(camPos) || !reader.read(m)) return false;
+    cam = Camera(camPos, Matrix3x3(m[0][0], m[0][1], m[0][2], m[1][0], m[1][1], m[1][2], m[2][0], m[2][1], m[2][2]));
+
+    if (!reader.readArray(pointLights)) return false;
+
+    uint64_t materialCount;
+    if (!reader.read(materialCount)) return false;
+    materials.clear();
+    for (uint64_t i = 0; i < materialCount; i++) {
+      int32_t type, smooth;
+      Vector3 albedo;
+      if (!reader.read(type) || !reader.read(albedo) || !reader.read(smooth)) return false;
+      materials.emplace_back((MaterialType)type, albedo, smooth != 0);
+    }
+
+    uint64_t meshCount;
+    if (!reader.read(meshCount)) return false;
+    meshes.clear();
+    for (uint64_t i = 0; i < meshCount; i++) {
+      meshes.emplace_back(0, 0);
+      if (!meshes.back().read(reader)) return false;
+    }
+
+    uint64_t instanceCount;
+    if (!reader.read(instanceCount)) return false;
+    instances.clear();
+    for (uint64_t i = 0; i < instanceCount; i++) {
+      int32_t meshIndex, matIndex;
+      float t[3][3];
+      Vector3 translation;
+      if (!reader.read(meshIndex) || !reader.read(matIndex) || !reader.read(t) || !reader.read(translation)) return false;
+      Matrix3x3 transform(t[0][0], t[0][1], t[0][2], t[1][0], t[1][1], t[1][2], t[2][0], t[2][1], t[2][2]);
+      //The instance inverts its transform right away
+      if (transform.getDeterminant() == 0.0f) return false;
+      instances.emplace_back(meshIndex, transform, translation, matIndex);
+    }
+    if (!meshBVH.read(reader) || !isValid()) return false;
+
+    //The light tree is not stored - it is cheap to build, next to loading the rest of the scene
+    lightTree.build(pointLights);
+    return true;
+  }
 }
\ No newline at end of file
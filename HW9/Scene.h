@@ -1,66 +1,113 @@
-#pragma once
-#include"Settings.h"
-#include"Camera.h"
-#include"Mesh.h"
-#include"Material.h"
-#include"PointLight.h"
-#include<vector>
-#include<string>
-
-namespace ChaosCampAM {  
-  //A scene object holding all the data for a scene:
-  // - Geometry
-  // - Camera
-  // - Scene settings
-  // - (to be added) lighting, materials, etc.
-  //
-  //This is a scene description only! All rendering functionality is in the dedicated Renderer class.
-
-  class Scene {
-  public: 
-    Scene();
-
-    //Getters
-
-    const std::vector<Mesh>& getMeshes() const;
-    const std::vector<Material>& getMaterials() const;
-    const Camera& getCamera() const;
-    const Settings& getSettings() const;
-    const std::vector<PointLight>& getPointLights() const;
-
-    //Setters
-
-    void setCamera(const Camera& newCam);
-    void setSettings(const Settings& newSettings);
-
-    //It is advisable not to use this function, as it may cause a lot of copying.
-    void setMeshes(const std::vector<Mesh>& newMeshes);
-    //It is advisable not to use this function, as it may cause a lot of copying.
-    void setMaterials(const std::vector<Material>& newMaterials);
-    //It is advisable not to use this function, as it may cause a lot of copying.
-    void setPointLights(const std::vector<PointLight>& newPointLights);
-
-    //Add an existing mesh to the scene.
-    void addMesh(const Mesh& mesh);
-    //Add a mesh to the scene. Mesh constructed in place.
-    void addMesh(const std::vector<Vector3>& vertices, const std::vector<TriProxy>& triangles, int matIndex);
-    //Add an existing material to the scene.
-    void addMaterial(const Material& mat);
-    //Add an existing point light to the scene.
-    void addPointLight(const PointLight& pointLight);
-
-    //Allocate memory for the given number of meshes.
-    void reserveMeshes(int numMeshes);
-    //Allocate memory for the given number of materials.
-    void reserveMaterials(int numMaterials);
-    //Allocate memory for the given number of point lights
-    void reservePointLights(int numPointLights);
-
-  private:
-    std::vector<Mesh> meshes;
-    std::vector<Material> materials;
-    std::vector<PointLight> pointLights;
-    Camera cam;
-    Settings settings;
-  };
-}
+#pragma once
+#include"Settings.h"
+#include"Camera.h"
+#include"Mesh.h"
+#include"Material.h"
+#include"PointLight.h"
+#include"MeshInstance.h"
+#include"BVH.h"
+#include"LightTree.h"
+#include<vector>
+#include<string>
+
+namespace ChaosCampAM {  
+  //Forward-declarations
+  class BinaryWriter;
+  class BinaryReader;
+
+  //A scene object holding all the data for a scene:
+  // - Geometry: meshes, each rendered where it is defined, and instances placing further copies of them
+  // - Camera
+  // - Scene settings
+  // - (to be added) lighting, materials, etc.
+  //
+  //This is a scene description only! All rendering functionality is in the dedicated Renderer class.
+
+  class Scene {
+  public: 
+    Scene();
+
+    //Getters
+
+    const std::vector<Mesh>& getMeshes() const;
+    const std::vector<MeshInstance>& getInstances() const;
+    const std::vector<Material>& getMaterials() const;
+    const Camera& getCamera() const;
+    const Settings& getSettings() const;
+    const std::vector<PointLight>& getPointLights() const;
+    //Top-level acceleration structure. Its primitives are the meshes, referenced by their index in getMeshes(),
+    //followed by the instances - primitive 'getMeshes().size() + i' is instance 'i'.
+    const BVH& getBVH() const;
+    //Hierarchy over the point lights, referenced by their index in getPointLights()
+    const LightTree& getLightTree() const;
+
+    //Setters
+
+    void setCamera(const Camera& newCam);
+    void setSettings(const Settings& newSettings);
+
+    //It is advisable not to use this function, as it may cause a lot of copying.
+    void setMeshes(const std::vector<Mesh>& newMeshes);
+    //Replace all meshes, taking over the given list without copying.
+    void setMeshes(std::vector<Mesh>&& newMeshes);
+    //It is advisable not to use this function, as it may cause a lot of copying.
+    void setMaterials(const std::vector<Material>& newMaterials);
+    //It is advisable not to use this function, as it may cause a lot of copying.
+    void setPointLights(const std::vector<PointLight>& newPointLights);
+
+    //Add an existing mesh to the scene.
+    void addMesh(const Mesh& mesh);
+    //Add an existing mesh to the scene, taking over its storage.
+    void addMesh(Mesh&& mesh);
+    //Add a mesh to the scene. Mesh constructed in place, its BVH built as given by 'buildMode'.
+    void addMesh(const std::vector<Vector3>& vertices, const std::vector<TriProxy>& triangles, int matIndex,
+      BVHBuildMode buildMode = BVHBuildMode::SAH);
+    //Same, the mesh taking over the storage of 'vertices' and 'triangles'.
+    void addMesh(std::vector<Vector3>&& vertices, std::vector<TriProxy>&& triangles, int matIndex,
+      BVHBuildMode buildMode = BVHBuildMode::SAH);
+    //Add an instance of a mesh to the scene. The mesh it refers to may be added later, but before buildBVH().
+    void addInstance(const MeshInstance& instance);
+    //Add an existing material to the scene.
+    void addMaterial(const Material& mat);
+    //Add an existing point light to the scene.
+    void addPointLight(const PointLight& pointLight);
+
+    //Allocate memory for the given number of meshes.
+    void reserveMeshes(int numMeshes);
+    //Allocate memory for the given number of instances.
+    void reserveInstances(int numInstances);
+    //Allocate memory for the given number of materials.
+    void reserveMaterials(int numMaterials);
+    //Allocate memory for the given number of point lights
+    void reservePointLights(int numPointLights);
+
+    //(Re)build the top-level bounding volume hierarchy over the world bounds of all meshes and instances, and the
+    //light tree. Must be called once all meshes and lights are added, before the scene is rendered.
+    void buildBVH();
+
+    //Rebuild the BVHs of all meshes with the given build mode, then the top-level BVH - e.g. to switch a loaded
+    //scene between fast LBVH previews and SAH final renders.
+    void rebuildBVHs(BVHBuildMode mode);
+
+    //True if the scene can be rendered safely: the image size is within [1;MAX_IMAGE_SIZE], every index refers to an
+    //existing mesh, material or vertex, instance transforms can be inverted and all acceleration structures stay within
+    //what they index (see Mesh::isValid()). The BVH must have been built.
+    bool isValid() const;
+
+    //Store the whole scene, including all acceleration structures, in a binary scene file / replace the scene
+    //with one restored from such a file (see SceneCache). Returns false if the data is truncated or the restored
+    //scene is not valid (see isValid()) - cache files are not trusted.
+    void write(BinaryWriter& writer) const;
+    bool read(BinaryReader& reader);
+
+  private:
+    std::vector<Mesh> meshes;
+    std::vector<MeshInstance> instances;
+    std::vector<Material> materials;
+    std::vector<PointLight> pointLights;
+    BVH meshBVH;
+    LightTree lightTree;
+    Camera cam;
+    Settings settings;
+  };
+}
@@ -0,0 +1,154 @@
+#include "SceneCache.h"
+#include "Scene.h"
+#include "SceneParser.h"
+#include "BinaryIO.h"
+#include "MappedFile.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+namespace ChaosCampAM {
+
+  static const char CACHE_MAGIC[8] = { 'C', 'R', 'T', 'B', 'I', 'N', 0, 0 };
+  //Reads back differently on a machine with the other byte order
+  static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+  //Start of every .crtbin file
+  struct SceneCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    //Sizes of the structs stored raw, to reject files written by a build with a different layout
+    uint32_t vectorSize;
+    uint32_t triangleSize;
+    uint32_t nodeSize;
+    uint32_t wideNodeSize;
+    uint32_t blockSize;
+    //Source .crtscene the file was made from
+    uint64_t sourceSize;
+    int64_t sourceTime;
+  };
+
+  static SceneCacheHeader makeHeader(uint64_t sourceSize, int64_t sourceTime) {
+    SceneCacheHeader header = {};
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = SCENE_CACHE_VERSION;
+    header.byteOrderMark = BYTE_ORDER_MARK;
+    header.vectorSize = sizeof(Vector3);
+    header.triangleSize = sizeof(TriProxy);
+    header.nodeSize = sizeof(BVHNode);
+    header.wideNodeSize = sizeof(WideBVHNode);
+    header.blockSize = sizeof(TriBlock);
+    header.sourceSize = sourceSize;
+    header.sourceTime = sourceTime;
+    return header;
+  }
+
+  bool SceneCache::save(const Scene& scene, const std::string& filename) {
+    return writeFile(scene, filename, 0, 0);
+  }
+
+  bool SceneCache::load(const std::string& filename, Scene& scene) {
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    return readFile(filename, scene, sourceSize, sourceTime);
+  }
+
+  bool SceneCache::convert(const std::string& sceneFilename, const std::string& cacheFilename) {
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    if (!getSourceStamp(sceneFilename, sourceSize, sourceTime)) return false;
+
+    Scene scene;
+    SceneParser parser;
+    if (!parser.parseStreaming(sceneFilename, scene)) return false;
+    return writeFile(scene, cacheFilename, sourceSize, sourceTime);
+  }
+
+  bool SceneCache::loadScene(const std::string& sceneFilename, Scene& scene) {
+    std::string cacheFilename = getCachePath(sceneFilename);
+    uint64_t sourceSize = 0, cachedSize;
+    int64_t sourceTime = 0, cachedTime;
+    bool hasSource = getSourceStamp(sceneFilename, sourceSize, sourceTime);
+
+    //Use the cache only if it was made from the scene file as it is now
+    if (readFile(cacheFilename, scene, cachedSize, cachedTime) &&
+      (!hasSource || (cachedSize == sourceSize && cachedTime == sourceTime))) {
+      return true;
+    }
+
+    scene = Scene();
+    SceneParser parser;
+    if (!parser.parseStreaming(sceneFilename, scene)) {
+      //A stale cache must not stand in for a scene file that no longer parses
+      std::error_code error;
+      std::filesystem::remove(cacheFilename, error);
+      return false;
+    }
+    if (!writeFile(scene, cacheFilename, sourceSize, sourceTime)) {
+      std::cout << "Could not write scene cache " << cacheFilename << "\n";
+    }
+    return true;
+  }
+
+  std::string SceneCache::getCachePath(const std::string& sceneFilename) const {
+    return std::filesystem::path(sceneFilename).replace_extension(".crtbin").string();
+  }
+
+  bool SceneCache::writeFile(const Scene& scene, const std::string& filename, uint64_t sourceSize, int64_t sourceTime) {
+    //Never cache what readFile() would reject
+    if (!scene.isValid()) return false;
+
+    //Write to a temporary file first, so that an interrupted write never leaves a broken cache behind
+    std::string tempFilename = filename + ".tmp";
+    {
+      std::ofstream out(tempFilename, std::ios::binary);
+      if (!out.is_open()) return false;
+
+      BinaryWriter writer(out);
+      writer.write(makeHeader(sourceSize, sourceTime));
+      scene.write(writer);
+      out.flush();
+      if (!writer.good()) {
+        out.close();
+        std::remove(tempFilename.c_str());
+        return false;
+      }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempFilename, filename, error);
+    return !error;
+  }
+
+  bool SceneCache::readFile(const std::string& filename, Scene& scene, uint64_t& sourceSize, int64_t& sourceTime) {
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(filename)) return false;
+
+    BinaryReader reader(file);
+    SceneCacheHeader header;
+    SceneCacheHeader expected = makeHeader(0, 0);
+    if (!reader.read(header) || memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+      header.version != expected.version || header.byteOrderMark != expected.byteOrderMark ||
+      header.vectorSize != expected.vectorSize || header.triangleSize != expected.triangleSize ||
+      header.nodeSize != expected.nodeSize || header.wideNodeSize != expected.wideNodeSize ||
+      header.blockSize != expected.blockSize) {
+      return false;
+    }
+
+    sourceSize = header.sourceSize;
+    sourceTime = header.sourceTime;
+    return scene.read(reader);
+  }
+
+  bool SceneCache::getSourceStamp(const std::string& sceneFilename, uint64_t& size, int64_t& time) const {
+    std::error_code error;
+    size = std::filesystem::file_size(sceneFilename, error);
+    if (error) return false;
+    time = (int64_t)std::filesystem::last_write_time(sceneFilename, error).time_since_epoch().count();
+    return !error;
+  }
+}
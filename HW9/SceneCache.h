@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace ChaosCampAM {
+  //Forward-declarations
+  class Scene;
+
+  //Version of the .crtbin layout. Must be increased whenever anything stored in it changes
+  //(including the layout of BVH nodes and triangle blocks) - files of other versions are rejected and rebuilt.
+  static const uint32_t SCENE_CACHE_VERSION = 3;
+
+  /*
+  * Binary compiled-scene files (.crtbin).
+  * A .crtbin holds a fully prepared Scene: settings, camera, lights, materials and, for every mesh, the vertices,
+  * triangles, normals and acceleration structures. Loading maps the file into memory and the meshes use the mapped
+  * arrays directly - nothing is parsed, copied or built, so reopening a scene costs next to nothing.
+  * The file is tied to the machine architecture (native byte order and struct layout) and records the size and
+  * modification time of the .crtscene it was made from, so that stale files are detected.
+  */
+  class SceneCache {
+  public:
+    SceneCache() {}
+
+    //Write 'scene' (which must be fully built) to a .crtbin file. Returns false if the file could not be written, or
+    //the scene is not valid (see Scene::isValid()).
+    bool save(const Scene& scene, const std::string& filename);
+
+    //Replace 'scene' by the one stored in a .crtbin file. Returns false (leaving 'scene' in an unspecified state)
+    //if the file is missing, of another version or architecture, truncated or corrupted (see Scene::isValid()).
+    bool load(const std::string& filename, Scene& scene);
+
+    //Parse a .crtscene file and write it out as .crtbin. Returns false, writing nothing, if the scene file is rejected.
+    bool convert(const std::string& sceneFilename, const std::string& cacheFilename);
+
+    //Load a .crtscene through its cache: the .crtbin next to it (see getCachePath()) is used if it was made from the
+    //current version of the scene file and is intact, otherwise the scene is parsed and the cache (re)written.
+    //Returns false if the scene file is rejected - any cache of it is then deleted, so that it is parsed (and the
+    //error reported) again next time.
+    bool loadScene(const std::string& sceneFilename, Scene& scene);
+
+    //Cache file of a scene file - same path with the extension replaced by .crtbin
+    std::string getCachePath(const std::string& sceneFilename) const;
+
+  private:
+    //save() / load() together with the size and modification time of the .crtscene the file was made from
+    bool writeFile(const Scene& scene, const std::string& filename, uint64_t sourceSize, int64_t sourceTime);
+    bool readFile(const std::string& filename, Scene& scene, uint64_t& sourceSize, int64_t& sourceTime);
+
+    //Size and modification time of a scene file. Returns false if the file does not exist.
+    bool getSourceStamp(const std::string& sceneFilename, uint64_t& size, int64_t& time) const;
+  };
+}
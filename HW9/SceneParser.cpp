@@ -1,213 +1,525 @@
-#include "SceneParser.h"
-#include "Scene.h"
-#include <fstream>
-#include <iostream>
-#include <vector>
-#include "Constants.h"
-
-#include "rapidjson/istreamwrapper.h"
-
-namespace ChaosCampAM {
-  void SceneParser::parse(const std::string& filename, Scene& scene) {
-    rapidjson::Document doc = getJsonDoc(filename);
-
-    parseSettings(scene,doc);
-    parseCamera(scene,doc);
-    parseObjects(scene,doc);
-    parseLights(scene, doc);
-    parseMaterials(scene, doc);
-  }
-
-  rapidjson::Document SceneParser::getJsonDoc(const std::string& filename) {
-    std::ifstream input(filename);
-    assert(input.is_open());
-
-    //Parse to rapidjson DOM
-    rapidjson::IStreamWrapper inStream(input);
-    rapidjson::Document doc;
-    doc.ParseStream(inStream);
-
-    if (doc.HasParseError()) {
-      std::cout << "Parse Error: " << doc.GetParseError() << "\n";
-      std::cout << "Error Offset: " << doc.GetErrorOffset() << "\n";
-      assert(false);
-    }
-
-    assert(doc.IsObject());
-    return doc;
-  }
-
-  void SceneParser::parseSettings(Scene& scene, const rapidjson::Document& doc) {
-    const rapidjson::Value& settingsVal = doc.FindMember(STR_SETTINGS)->value;
-
-    if (!settingsVal.IsNull() && settingsVal.IsObject()) {
-      Settings settings;
-
-      //Extract Background colour
-      const rapidjson::Value& bgColVal = settingsVal.FindMember(STR_BG_COLOR)->value;
-      assert(!bgColVal.IsNull() && bgColVal.IsArray());
-      settings.setBgColor(loadVector(bgColVal.GetArray()));
-
-      //Extract width and height
-      const rapidjson::Value& imgSettingsVal = settingsVal.FindMember(STR_IMG_SETTINGS)->value;
-      assert(!imgSettingsVal.IsNull() && imgSettingsVal.IsObject());
-      const rapidjson::Value& imgWidthVal = imgSettingsVal.FindMember(STR_WIDTH)->value;
-      const rapidjson::Value& imgHeightVal = imgSettingsVal.FindMember(STR_HEIGHT)->value;
-      assert(!imgWidthVal.IsNull() && imgWidthVal.IsInt() && !imgHeightVal.IsNull() && imgHeightVal.IsInt());
-      settings.setWidth(imgWidthVal.GetInt());
-      settings.setHeight(imgHeightVal.GetInt());
-
-      scene.setSettings(settings);
-    }
-  }
-
-  void SceneParser::parseCamera(Scene& scene, const rapidjson::Document& doc) {
-    const rapidjson::Value& camVal = doc.FindMember(STR_CAMERA)->value;
-    if (!camVal.IsNull() && camVal.IsObject()) {
-      Camera cam;
-
-      //Extract position
-      const rapidjson::Value& camPosVal = camVal.FindMember(STR_POS)->value;
-      assert(!camPosVal.IsNull() && camPosVal.IsArray());
-      cam.setPosition(loadVector(camPosVal.GetArray()));
-
-      //Extract orientation
-      const rapidjson::Value& camOrientVal = camVal.FindMember(STR_MATRIX)->value;
-      assert(!camOrientVal.IsNull() && camOrientVal.IsArray());
-      cam.setOrientation(loadMatrix(camOrientVal.GetArray()));
-
-      scene.setCamera(cam);
-    }
-  }
-
-  void SceneParser::parseLights(Scene& scene, const rapidjson::Document& doc) {
-    const rapidjson::Value& lightVal = doc.FindMember(STR_LIGHTS)->value;
-    if (!lightVal.IsNull() && lightVal.IsArray()) {
-      scene.reservePointLights(lightVal.Size());
-
-      for (int i = 0; i < lightVal.Size(); i++) { //For each light
-        //Extract intensity
-        const rapidjson::Value& intensityVal = lightVal[i].FindMember(STR_LIGHT_INTENSITY)->value;
-        assert(!intensityVal.IsNull() && intensityVal.IsNumber());
-        float intensity = intensityVal.GetFloat();
-
-        //Extract position
-        const rapidjson::Value& posVal = lightVal[i].FindMember(STR_POS)->value;
-        assert(!posVal.IsNull() && posVal.IsArray());
-        Vector3 position = loadVector(posVal.GetArray());
-
-        scene.addPointLight(PointLight(position,intensity));
-      }
-    }
-  }
-
-  void SceneParser::parseMaterials(Scene& scene, const rapidjson::Document& doc) {
-    const rapidjson::Value& matVal = doc.FindMember(STR_MATERIALS)->value;
-    if (!matVal.IsNull() && matVal.IsArray()) {
-      scene.reserveMaterials(matVal.Size());
-
-      for (int i = 0; i < matVal.Size(); i++) { // For each material
-        //Extract type
-        const rapidjson::Value& typeVal = matVal[i].FindMember(STR_MAT_TYPE)->value;
-        assert(!typeVal.IsNull() && typeVal.IsString());
-        std::string typeStr = typeVal.GetString();
-        MaterialType type = MaterialType::Diffuse; //Diffuse by default
-        if (typeStr.compare(STR_MAT_TYPE_REFLECTIVE) == 0) { //Reflective
-          type = MaterialType::Reflective;
-        }
-
-        //Extract albedo
-        const rapidjson::Value& albedoVal = matVal[i].FindMember(STR_MAT_ALBEDO)->value;
-        assert(!albedoVal.IsNull() && albedoVal.IsArray());
-        Vector3 albedo = loadVector(albedoVal.GetArray());
-
-        //Extract smooth_shading
-        const rapidjson::Value& smoothVal = matVal[i].FindMember(STR_MAT_SMOOTH)->value;
-        assert(!smoothVal.IsNull() && smoothVal.IsBool());
-        bool smooth = smoothVal.GetBool();
-        
-        scene.addMaterial(Material(type, albedo, smooth));
-      }
-    }
-  }
-
-  void SceneParser::parseObjects(Scene& scene, const rapidjson::Document& doc) {
-    const rapidjson::Value& objVal = doc.FindMember(STR_OBJECTS)->value;
-    if (!objVal.IsNull() && objVal.IsArray()) {
-      scene.reserveMeshes(objVal.Size());
-
-      for (int i = 0; i < objVal.Size(); i++) { //For each mesh
-        //Extract material index
-        const rapidjson::Value& matIndexVal = objVal[i].FindMember(STR_MAT_INDEX)->value;
-        assert(!matIndexVal.IsNull() && matIndexVal.IsInt());
-        int matIndex = matIndexVal.GetInt();
-
-        //Extract vertices
-        const rapidjson::Value& verticesVal = objVal[i].FindMember(STR_VERTICES)->value;
-        assert(!verticesVal.IsNull() && verticesVal.IsArray());
-        std::vector<Vector3> vertices;
-        loadVertices(verticesVal.GetArray(), vertices);
-
-        //Extract triangles
-        const rapidjson::Value& trianglesVal = objVal[i].FindMember(STR_TRIANGLES)->value;
-        assert(!trianglesVal.IsNull() && trianglesVal.IsArray());
-        std::vector<TriProxy> triangles;
-        loadTriangles(trianglesVal.GetArray(), triangles);
-
-        scene.addMesh(vertices, triangles, matIndex);
-      }
-    }
-  }
-
-  Vector3 SceneParser::loadVector(const rapidjson::Value::ConstArray& arr) {
-    assert(arr.Size() == 3);
-    Vector3 vec(arr[0].GetFloat(), arr[1].GetFloat(), arr[2].GetFloat());
-    return vec;
-  }
-
-  Matrix3x3 SceneParser::loadMatrix(const rapidjson::Value::ConstArray& arr) {
-    assert(arr.Size() == 9);
-    //.crtscene stores matrices in column-major fashion!
-    Matrix3x3 mat(
-      arr[0].GetFloat(), arr[3].GetFloat(), arr[6].GetFloat(),//row 0
-      arr[1].GetFloat(), arr[4].GetFloat(), arr[7].GetFloat(),//row 1
-      arr[2].GetFloat(), arr[5].GetFloat(), arr[8].GetFloat() //row 2
-    );
-    return mat;
-  }
-
-  void SceneParser::loadVertices(const rapidjson::Value::ConstArray& arr, std::vector<Vector3>& vertices) {
-    int arrSize = arr.Size();
-    assert(arrSize % 3 == 0);
-
-    //Empty vector and allocate required memory all at once
-    vertices.clear();
-    vertices.reserve(arrSize / 3);
-
-    //Add all vertices to the list
-    for (int i = 0; i < arrSize / 3; i++) {
-      vertices.emplace_back(
-        arr[3 * i].GetFloat(),
-        arr[3 * i + 1].GetFloat(),
-        arr[3 * i + 2].GetFloat()
-      );
-    }
-  }
-
-  void SceneParser::loadTriangles(const rapidjson::Value::ConstArray& arr, std::vector<TriProxy>& triangles) {
-    int arrSize = arr.Size();
-    assert(arrSize % 3 == 0);
-
-    //Empty vector and allocate required memory all at once
-    triangles.clear();
-    triangles.reserve(arrSize / 3);
-
-    for (int i = 0; i < arrSize / 3; i++) {
-      triangles.emplace_back(
-        arr[3 * i].GetInt(),
-        arr[3 * i + 1].GetInt(),
-        arr[3 * i + 2].GetInt()
-      );
-    }
-  }
-}
+#include "SceneParser.h"
+#include "Scene.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "Constants.h"
+#include "MappedFile.h"
+#include "NumberParser.h"
+#include "ThreadPool.h"
+#include "SceneSaxHandler.h"
+
+#include "rapidjson/memorystream.h"
+#include "rapidjson/error/en.h"
+
+namespace ChaosCampAM {
+  void SceneParser::setBVHBuildMode(BVHBuildMode mode) {
+    bvhBuildMode = mode;
+  }
+
+  //Byte offset of the value a JSON pointer refers to, found by walking the original text of the document, which must
+  //be valid JSON. If a member or element on the way is missing, the offset of the object / array lacking it.
+  //Only used to report errors - scene files are never walked twice otherwise.
+  static size_t locateValue(const char* text, size_t size, const std::string& pointer) {
+    const char* end = text + size;
+    const char* pos = skipWhitespace(text, end);
+
+    //Position after the string / value starting at 'from'
+    auto skipString = [end](const char* from) {
+      for (from++; from < end && *from != '"'; from++) {
+        if (*from == '\\') from++;
+      }
+      return from < end ? from + 1 : end;
+    };
+    auto skipValue = [end, &skipString](const char* from) {
+      int depth = 0;
+      while (from < end) {
+        char c = *from;
+        if (c == '"') { from = skipString(from); if (depth == 0) return from; continue; }
+        if (c == '{' || c == '[') depth++;
+        else if (c == '}' || c == ']') { if (depth == 0) return from; if (--depth == 0) return from + 1; }
+        else if (depth == 0 && (c == ',' || c == ' ' || c == '\t' || c == '\r' || c == '\n')) return from;
+        from++;
+      }
+      return from;
+    };
+
+    size_t tokenBegin = 1;
+    while (tokenBegin <= pointer.size() && pos < end) {
+      size_t tokenEnd = pointer.find('/', tokenBegin);
+      if (tokenEnd == std::string::npos) tokenEnd = pointer.size();
+      std::string token = pointer.substr(tokenBegin, tokenEnd - tokenBegin);
+      tokenBegin = tokenEnd + 1;
+
+      const char* container = pos;
+      const char* found = nullptr;
+      if (*pos == '{') {
+        //Members are "key" : value, separated by commas
+        pos = skipWhitespace(pos + 1, end);
+        while (pos < end && *pos == '"') {
+          const char* keyEnd = skipString(pos);
+          bool match = std::string(pos + 1, keyEnd - 1) == token;
+          pos = skipWhitespace(skipWhitespace(keyEnd, end) + 1, end);
+          if (match) { found = pos; break; }
+          pos = skipWhitespace(skipValue(pos), end);
+          if (pos < end && *pos == ',') pos = skipWhitespace(pos + 1, end);
+        }
+      }
+      else if (*pos == '[') {
+        int index = atoi(token.c_str());
+        pos = skipWhitespace(pos + 1, end);
+        for (int i = 0; pos < end && *pos != ']'; i++) {
+          if (i == index) { found = pos; break; }
+          pos = skipWhitespace(skipValue(pos), end);
+          if (pos < end && *pos == ',') pos = skipWhitespace(pos + 1, end);
+        }
+      }
+      if (!found) return (size_t)(container - text);
+      pos = found;
+    }
+    return (size_t)(pos - text);
+  }
+
+  //Same, in the scene file 'filename'
+  static size_t locateValue(const std::string& filename, const std::string& pointer) {
+    MappedFile file;
+    if (!file.open(filename)) return 0;
+    return locateValue((const char*)file.getData(), file.getSize(), pointer);
+  }
+
+  bool SceneParser::parse(const std::string& filename, Scene& scene, SceneParseError* error) {
+    SceneParseError localError;
+    SceneParseError& parseError = error ? *error : localError;
+    parseError = SceneParseError();
+
+    //The DOM keeps pointing into the file (strings are parsed in-situ) and into the memory pool, both outlive it.
+    //The pool starts in a buffer of the parser, sized from the file, so that repeated loads allocate nothing new.
+    MappedFile file;
+    bool valid = file.open(filename, true);
+    if (!valid) parseError.expected = "a readable, non-empty file";
+    if (valid) {
+      size_t poolSize = std::max(file.getSize() * JSON_POOL_SIZE_FACTOR, (size_t)JSON_POOL_MIN_SIZE);
+      if (jsonPoolBuffer.size() < poolSize) jsonPoolBuffer.resize(poolSize);
+      rapidjson::MemoryPoolAllocator<> allocator(jsonPoolBuffer.data(), jsonPoolBuffer.size(), file.getSize());
+      rapidjson::Document doc(&allocator);
+
+      valid = getJsonDoc(file, doc, parseError);
+      if (valid) {
+        //The scene is only replaced once the whole file has been accepted
+        Scene parsed;
+        parseSettings(parsed, doc);
+        parseCamera(parsed, doc);
+        parseLights(parsed, doc);
+        parseMaterials(parsed, doc);
+        valid = parseObjects(parsed, doc, parseError) && parseInstances(parsed, doc, parseError);
+
+        if (valid) {
+          parsed.buildBVH();
+          scene = std::move(parsed);
+        }
+      }
+      //The mapping has been modified by the in-situ parse - rejected values are looked up in a fresh one
+      if (!valid && !doc.HasParseError()) parseError.offset = locateValue(filename, parseError.pointer);
+    }
+
+    if (!valid && !error) {
+      std::cout << "Could not parse " << filename << ": " << parseError.describe() << "\n";
+    }
+    return valid;
+  }
+
+  //Run the SAX 'handler' over the scene file, mapped into memory. rapidjson goes through the file token by token, so
+  //that the vertex and triangle lists can be read past it by the handler (see SceneSaxHandler::readNumberArray()).
+  //Returns false (setting 'error') if the file cannot be read, is not valid JSON or the handler rejects a value.
+  template<unsigned parseFlags>
+  static bool readSceneStream(const std::string& filename, SceneSaxHandler& handler, SceneParseError& error) {
+    MappedFile file;
+    if (!file.open(filename)) {
+      error.expected = "a readable, non-empty file";
+      return false;
+    }
+
+    const char* text = (const char*)file.getData();
+    const char* textEnd = text + file.getSize();
+    rapidjson::MemoryStream inStream(text, file.getSize());
+    rapidjson::Reader reader;
+    reader.IterativeParseInit();
+    while (!reader.IterativeParseComplete()) {
+      if (!reader.IterativeParseNext<parseFlags>(inStream, handler)) break;
+      inStream.src_ = handler.readNumberArray(inStream.src_, textEnd);
+    }
+
+    if (!reader.HasParseError()) return true;
+    if (reader.GetParseErrorCode() == rapidjson::kParseErrorTermination) {
+      //Stopped by the handler - the value it rejected is looked up in the text, which is valid JSON up to there
+      error = handler.getError();
+      error.offset = locateValue(text, file.getSize(), error.pointer);
+    }
+    else {
+      error.offset = reader.GetErrorOffset();
+      error.expected = std::string("valid JSON - ") + rapidjson::GetParseError_En(reader.GetParseErrorCode());
+    }
+    return false;
+  }
+
+  bool SceneParser::parseStreaming(const std::string& filename, Scene& scene, SceneParseError* error) {
+    SceneParseError localError;
+    SceneParseError& parseError = error ? *error : localError;
+    parseError = SceneParseError();
+
+    //Counting pass - numbers are only counted, not converted
+    std::vector<SceneSaxHandler::MeshSize> meshSizes;
+    SceneSaxHandler counter(nullptr, meshSizes);
+    bool valid = readSceneStream<rapidjson::kParseNumbersAsStringsFlag>(filename, counter, parseError);
+
+    //Loading pass - into a scene of its own, which only replaces 'scene' once the whole file has been read
+    Scene parsed;
+    if (valid) {
+      parsed.reserveMeshes(meshSizes.size());
+      SceneSaxHandler loader(&parsed, meshSizes, bvhBuildMode);
+      valid = readSceneStream<rapidjson::kParseDefaultFlags>(filename, loader, parseError);
+      if (valid && !loader.finish()) {
+        parseError = loader.getError();
+        parseError.offset = locateValue(filename, parseError.pointer);
+        valid = false;
+      }
+    }
+
+    if (valid) {
+      parsed.buildBVH();
+      scene = std::move(parsed);
+    }
+    else if (!error) {
+      std::cout << "Could not parse " << filename << ": " << parseError.describe() << "\n";
+    }
+    return valid;
+  }
+
+  //In-situ stream over a writable buffer. Unlike rapidjson::InsituStringStream it stops at the end of the buffer
+  //instead of a terminating zero, which a mapped file does not have.
+  struct InsituMemoryStream {
+    typedef char Ch;
+
+    InsituMemoryStream(Ch* begin, size_t size) : src_(begin), dst_(nullptr), head_(begin), end_(begin + size) {}
+
+    //Read
+    Ch Peek() const { return src_ < end_ ? *src_ : '\0'; }
+    Ch Take() { return src_ < end_ ? *src_++ : '\0'; }
+    size_t Tell() const { return (size_t)(src_ - head_); }
+
+    //Write (decoded strings replace their own text)
+    void Put(Ch c) { *dst_++ = c; }
+    Ch* PutBegin() { return dst_ = src_; }
+    size_t PutEnd(Ch* begin) { return (size_t)(dst_ - begin); }
+    void Flush() {}
+    Ch* Push(size_t count) { Ch* begin = dst_; dst_ += count; return begin; }
+    void Pop(size_t count) { dst_ -= count; }
+
+    Ch* src_;
+    Ch* dst_;
+    Ch* head_;
+    Ch* end_;
+  };
+
+
+  static bool checkValue(const SceneMember& member, const rapidjson::Value& val, const std::string& pointer,
+    SceneParseError& error);
+
+  //Check the scene object of the given kind at 'pointer', with all it holds. Members are checked in the order of the
+  //file, like parseStreaming() meets them, then the missing ones.
+  static bool checkObject(SceneObjectKind object, const rapidjson::Value& val, const std::string& pointer,
+    SceneParseError& error) {
+    if (!val.IsObject()) return failSceneValue(pointer, describeValueKind(SceneValueKind::Object), error);
+    int memberCount;
+    const SceneMember* members = getSceneMembers(object, memberCount);
+    unsigned present = 0;
+    for (rapidjson::Value::ConstMemberIterator it = val.MemberBegin(); it != val.MemberEnd(); ++it) {
+      int member = findSceneMember(object, it->name.GetString());
+      if (member < 0) continue;
+      present |= 1u << member;
+      if (!checkValue(members[member], it->value, pointer + "/" + members[member].key, error)) return false;
+    }
+    return checkRequiredMembers(object, present, pointer, error);
+  }
+
+  //Check the value of a member at 'pointer'. Indices are only checked to be integers here - what they refer to is
+  //checked by the parse functions.
+  static bool checkValue(const SceneMember& member, const rapidjson::Value& val, const std::string& pointer,
+    SceneParseError& error) {
+    switch (member.kind) {
+    case SceneValueKind::Object:
+      return checkObject(member.child, val, pointer, error);
+    case SceneValueKind::Array:
+      if (!val.IsArray()) break;
+      for (rapidjson::SizeType i = 0; i < val.Size(); i++) {
+        if (!checkObject(member.child, val[i], pointer + "/" + std::to_string(i), error)) return false;
+      }
+      return true;
+    case SceneValueKind::Number:
+    case SceneValueKind::Integer:
+    case SceneValueKind::Size:
+      if (val.IsNumber() && isValidNumber(member.kind, val.GetDouble())) return true;
+      break;
+    case SceneValueKind::Bool:
+      if (val.IsBool()) return true;
+      break;
+    case SceneValueKind::String:
+      if (val.IsString()) return true;
+      break;
+    default: //Arrays of numbers - the elements come before the size, as when streaming
+      if (!val.IsArray()) break;
+      for (rapidjson::SizeType i = 0; i < val.Size(); i++) {
+        if (!val[i].IsNumber()) {
+          return failSceneValue(pointer + "/" + std::to_string(i), describeValueKind(SceneValueKind::Number), error);
+        }
+      }
+      if (isValidListSize(member.kind, val.Size())) return true;
+      break;
+    }
+    return failSceneValue(pointer, describeValueKind(member.kind), error);
+  }
+
+  //Optional section 'key' of the document - nullptr if it is absent
+  static const rapidjson::Value* findSection(const rapidjson::Document& doc, const char* key) {
+    rapidjson::Value::ConstMemberIterator it = doc.FindMember(key);
+    return it == doc.MemberEnd() ? nullptr : &it->value;
+  }
+
+  //JSON pointer of element 'index' of section 'key'
+  static std::string sectionElement(const char* key, int index) {
+    return std::string("/") + key + "/" + std::to_string(index);
+  }
+
+  bool SceneParser::getJsonDoc(MappedFile& file, rapidjson::Document& doc, SceneParseError& error) {
+    //Parse to rapidjson DOM
+    InsituMemoryStream inStream((char*)file.getWritableData(), file.getSize());
+    doc.ParseStream<rapidjson::kParseInsituFlag>(inStream);
+
+    if (doc.HasParseError()) {
+      error.offset = doc.GetErrorOffset();
+      error.expected = std::string("valid JSON - ") + rapidjson::GetParseError_En(doc.GetParseError());
+      return false;
+    }
+    return checkObject(SceneObjectKind::Root, doc, "", error);
+  }
+
+  void SceneParser::parseSettings(Scene& scene, const rapidjson::Document& doc) {
+    const rapidjson::Value* settingsVal = findSection(doc, STR_SETTINGS);
+    if (!settingsVal) return;
+    Settings settings;
+
+    //Extract Background colour
+    settings.setBgColor(loadVector((*settingsVal)[STR_BG_COLOR].GetArray()));
+
+    //Extract width and height - integral, but possibly written as doubles
+    const rapidjson::Value& imgSettingsVal = (*settingsVal)[STR_IMG_SETTINGS];
+    settings.setWidth((int)imgSettingsVal[STR_WIDTH].GetDouble());
+    settings.setHeight((int)imgSettingsVal[STR_HEIGHT].GetDouble());
+
+    scene.setSettings(settings);
+  }
+
+  void SceneParser::parseCamera(Scene& scene, const rapidjson::Document& doc) {
+    const rapidjson::Value* camVal = findSection(doc, STR_CAMERA);
+    if (!camVal) return;
+    Camera cam;
+
+    //Extract position
+    cam.setPosition(loadVector((*camVal)[STR_POS].GetArray()));
+
+    //Extract orientation
+    cam.setOrientation(loadMatrix((*camVal)[STR_MATRIX].GetArray()));
+
+    scene.setCamera(cam);
+  }
+
+  void SceneParser::parseLights(Scene& scene, const rapidjson::Document& doc) {
+    const rapidjson::Value* lightVal = findSection(doc, STR_LIGHTS);
+    if (!lightVal) return;
+    scene.reservePointLights(lightVal->Size());
+
+    for (int i = 0; i < (int)lightVal->Size(); i++) { //For each light
+      const rapidjson::Value& light = (*lightVal)[i];
+
+      //Extract intensity
+      float intensity = light[STR_LIGHT_INTENSITY].GetFloat();
+
+      //Extract position
+      Vector3 position = loadVector(light[STR_POS].GetArray());
+
+      scene.addPointLight(PointLight(position,intensity));
+    }
+  }
+
+  void SceneParser::parseMaterials(Scene& scene, const rapidjson::Document& doc) {
+    const rapidjson::Value* matVal = findSection(doc, STR_MATERIALS);
+    if (!matVal) return;
+    scene.reserveMaterials(matVal->Size());
+
+    for (int i = 0; i < (int)matVal->Size(); i++) { // For each material
+      const rapidjson::Value& mat = (*matVal)[i];
+
+      //Extract type
+      MaterialType type = MaterialType::Diffuse; //Diffuse by default
+      if (strcmp(mat[STR_MAT_TYPE].GetString(), STR_MAT_TYPE_REFLECTIVE) == 0) { //Reflective
+        type = MaterialType::Reflective;
+      }
+
+      //Extract albedo
+      Vector3 albedo = loadVector(mat[STR_MAT_ALBEDO].GetArray());
+
+      //Extract smooth_shading
+      bool smooth = mat[STR_MAT_SMOOTH].GetBool();
+        
+      scene.addMaterial(Material(type, albedo, smooth));
+    }
+  }
+
+  bool SceneParser::parseObjects(Scene& scene, const rapidjson::Document& doc, SceneParseError& error) {
+    const rapidjson::Value* objVal = findSection(doc, STR_OBJECTS);
+    if (!objVal) return true;
+    int materialCount = (int)scene.getMaterials().size();
+
+    //Objects are independent of each other, so they are converted (and get their normals and BVHs) in parallel.
+    //Every task fills the slot of its own object, then the meshes are handed to the scene in file order. The geometry
+    //is moved from the loaded lists into the meshes and on into the scene, never copied.
+    //Once an object is found invalid, the objects after it are skipped. Those before it are still checked, so the
+    //error reported is that of the first invalid object, whatever the order the tasks ran in.
+    int objectCount = objVal->Size();
+    std::vector<Mesh> meshes(objectCount, Mesh(0, 0));
+    std::vector<SceneParseError> objectErrors(objectCount);
+    std::atomic<int> firstInvalid(objectCount);
+    ThreadPool::getDefault().parallelFor(0, objectCount, 1, [&](int i) { //For each mesh
+      if (i > firstInvalid) return;
+      const rapidjson::Value& obj = (*objVal)[i];
+      const std::string pointer = sectionElement(STR_OBJECTS, i);
+
+      //Extract material index - every object needs a material, instances only override it
+      double matIndex = obj[STR_MAT_INDEX].GetDouble();
+      bool valid = checkIndex(matIndex, materialCount, "materials", pointer + "/" + STR_MAT_INDEX, objectErrors[i]);
+
+      //Extract vertices
+      std::vector<Vector3> vertices;
+      if (valid) loadVertices(obj[STR_VERTICES].GetArray(), vertices);
+
+      //Extract triangles
+      std::vector<TriProxy> triangles;
+      valid = valid && loadTriangles(obj[STR_TRIANGLES].GetArray(), (int)vertices.size(), pointer + "/" + STR_TRIANGLES,
+        triangles, objectErrors[i]);
+
+      if (!valid) {
+        int invalid = firstInvalid;
+        while (i < invalid && !firstInvalid.compare_exchange_weak(invalid, i)) {}
+        return;
+      }
+      meshes[i] = Mesh(std::move(vertices), std::move(triangles), (int)matIndex, bvhBuildMode);
+    });
+
+    if (firstInvalid < objectCount) {
+      error = objectErrors[firstInvalid];
+      return false;
+    }
+    scene.setMeshes(std::move(meshes));
+    return true;
+  }
+
+  bool SceneParser::parseInstances(Scene& scene, const rapidjson::Document& doc, SceneParseError& error) {
+    //Unlike the other sections, instances are absent from most scene files
+    const rapidjson::Value* instVal = findSection(doc, STR_INSTANCES);
+    if (!instVal) return true;
+    int meshCount = (int)scene.getMeshes().size();
+    int materialCount = (int)scene.getMaterials().size();
+    scene.reserveInstances(instVal->Size());
+
+    for (int i = 0; i < (int)instVal->Size(); i++) { //For each instance
+      const rapidjson::Value& inst = (*instVal)[i];
+      const std::string pointer = sectionElement(STR_INSTANCES, i);
+
+      //Extract index of the instanced object
+      double meshIndex = inst[STR_INSTANCE_OBJECT].GetDouble();
+      if (!checkIndex(meshIndex, meshCount, "objects", pointer + "/" + STR_INSTANCE_OBJECT, error)) return false;
+
+      //Extract transform - linear part and translation
+      Matrix3x3 transform = createIdentity();
+      rapidjson::Value::ConstMemberIterator it = inst.FindMember(STR_MATRIX);
+      if (it != inst.MemberEnd()) {
+        transform = loadMatrix(it->value.GetArray());
+        if (!checkTransform(transform, pointer + "/" + STR_MATRIX, error)) return false;
+      }
+      Vector3 translation;
+      it = inst.FindMember(STR_POS);
+      if (it != inst.MemberEnd()) translation = loadVector(it->value.GetArray());
+
+      //Extract material override
+      int matIndex = -1;
+      it = inst.FindMember(STR_MAT_INDEX);
+      if (it != inst.MemberEnd()) {
+        if (!checkIndex(it->value.GetDouble(), materialCount, "materials", pointer + "/" + STR_MAT_INDEX, error)) {
+          return false;
+        }
+        matIndex = (int)it->value.GetDouble();
+      }
+
+      scene.addInstance(MeshInstance((int)meshIndex, transform, translation, matIndex));
+    }
+    return true;
+  }
+
+  Vector3 SceneParser::loadVector(const rapidjson::Value::ConstArray& arr) {
+    return Vector3(arr[0].GetFloat(), arr[1].GetFloat(), arr[2].GetFloat());
+  }
+
+  Matrix3x3 SceneParser::loadMatrix(const rapidjson::Value::ConstArray& arr) {
+    //.crtscene stores matrices in column-major fashion!
+    return Matrix3x3(
+      arr[0].GetFloat(), arr[3].GetFloat(), arr[6].GetFloat(),//row 0
+      arr[1].GetFloat(), arr[4].GetFloat(), arr[7].GetFloat(),//row 1
+      arr[2].GetFloat(), arr[5].GetFloat(), arr[8].GetFloat() //row 2
+    );
+  }
+
+  void SceneParser::loadVertices(const rapidjson::Value::ConstArray& arr, std::vector<Vector3>& vertices) {
+    int arrSize = arr.Size();
+
+    //Empty vector and allocate required memory all at once
+    vertices.clear();
+    vertices.reserve(arrSize / 3);
+
+    //Add all vertices to the list
+    for (int i = 0; i < arrSize / 3; i++) {
+      vertices.emplace_back(
+        arr[3 * i].GetFloat(),
+        arr[3 * i + 1].GetFloat(),
+        arr[3 * i + 2].GetFloat()
+      );
+    }
+  }
+
+  bool SceneParser::loadTriangles(const rapidjson::Value::ConstArray& arr, int vertexCount, const std::string& pointer,
+    std::vector<TriProxy>& triangles, SceneParseError& error) {
+    int arrSize = arr.Size();
+
+    //Every index must refer to a vertex - meshes never check them again. The pointer is only built for a bad one.
+    for (int i = 0; i < arrSize; i++) {
+      if (!isIndex(arr[i].GetDouble(), vertexCount)) {
+        return checkIndex(arr[i].GetDouble(), vertexCount, "vertices", pointer + "/" + std::to_string(i), error);
+      }
+    }
+
+    //Empty vector and allocate required memory all at once
+    triangles.clear();
+    triangles.reserve(arrSize / 3);
+
+    //Indices may be written as doubles ("1.0")
+    for (int i = 0; i < arrSize / 3; i++) {
+      triangles.emplace_back(
+        (int)arr[3 * i].GetDouble(),
+        (int)arr[3 * i + 1].GetDouble(),
+        (int)arr[3 * i + 2].GetDouble()
+      );
+    }
+    return true;
+  }
+}
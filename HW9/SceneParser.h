@@ -1,56 +1,97 @@
-#pragma once
-#include <string>
-#include <vector>
-#include"Mesh.h"
-
-#include"rapidjson/document.h"
-
-namespace ChaosCampAM {
-  //Forward-declarations
-  class Scene;
-  class Vector3;
-  class Matrix3x3;
-  class TriProxy;
-
-  //Takes the scenefile parsing functionality away from the Scene class.
-  //Responsible for reading a .crtscene json file and 
-  //initialising a Scene object with the parsed data.
-  class SceneParser {
-  public:
-    SceneParser(){}
-
-    //Takes the filename of a .crtscene json file and attempts parsing it into a Scene class
-    void parse(const std::string& filename, Scene& scene);
-
-  private:
-    //Extract a rapidjson document from the scene file given
-    rapidjson::Document getJsonDoc(const std::string& filename);
-
-    //Extract scene settings from the rapidjson document
-    void parseSettings(Scene& scene, const rapidjson::Document& doc);
-
-    //Extract scene camera from the rapidjson document
-    void parseCamera(Scene& scene, const rapidjson::Document& doc);
-
-    //Extract scene lights from the rapidjson document
-    void parseLights(Scene& scene, const rapidjson::Document& doc);
-
-    //Extract materials from the rapidjson document
-    void parseMaterials(Scene& scene, const rapidjson::Document& doc);
-
-    //Extract object (meshes) form the rapidjson document
-    void parseObjects(Scene& scene, const rapidjson::Document& doc);
-
-    //Convert a vector object (geometric 3D vector) from rapidjson array to a local Vector3 object.
-    Vector3 loadVector(const rapidjson::Value::ConstArray& arr);
-
-    //Convert a matrix object from rapidjson array to a local Matrix3x3 object.
-    Matrix3x3 loadMatrix(const rapidjson::Value::ConstArray& arr);
-
-    //Convert a vertex list from rapidjson array to a local list of Vector3 objects.
-    void loadVertices(const rapidjson::Value::ConstArray& arr, std::vector<Vector3>& vertices);
-
-    //Convert a triangle list from rapidjson array to a local list of TriProxy objects.
-    void loadTriangles(const rapidjson::Value::ConstArray& arr, std::vector<TriProxy>& triangles);
-  };
-}
+#pragma once
+#include <string>
+#include <vector>
+#include"Mesh.h"
+#include"SceneValidation.h"
+
+#include"rapidjson/document.h"
+
+namespace ChaosCampAM {
+  //Forward-declarations
+  class Scene;
+  class Vector3;
+  class Matrix3x3;
+  class TriProxy;
+  class MappedFile;
+
+  //Takes the scenefile parsing functionality away from the Scene class.
+  //Responsible for reading a .crtscene json file and 
+  //initialising a Scene object with the parsed data.
+  class SceneParser {
+  public:
+    SceneParser(){}
+
+    //How the parsed meshes build their BVHs - SAH by default, LBVH for quick previews (see BVHBuildMode).
+    void setBVHBuildMode(BVHBuildMode mode);
+
+    //Takes the filename of a .crtscene json file and attempts parsing it into a Scene class.
+    //The file is memory-mapped and parsed in-situ into a DOM.
+    //Every section ("settings", "camera", "lights", "materials", "objects", "instances") is optional, but the ones
+    //present are checked completely (see SceneValidation.h): required members, types, sizes, and indices of vertices,
+    //materials and objects.
+    //Returns false on the first invalid value, leaving 'scene' untouched. The reason goes to 'error' if given,
+    //to stdout otherwise.
+    bool parse(const std::string& filename, Scene& scene, SceneParseError* error = nullptr);
+
+    //Same as parse(), but the file is streamed through a SAX reader instead of being loaded into a DOM.
+    //The file is read twice - first to count the vertices and triangles of every object, then to fill the meshes,
+    //whose storage is allocated once with the counted sizes. Peak memory stays close to the size of the final scene.
+    //The file is mapped into memory. Vertex and triangle lists bypass rapidjson: the counting pass only scans their
+    //delimiters, the loading pass converts them with the fast number parser of NumberParser.h.
+    //Accepts and rejects exactly the same files as parse(), with the same checks (see SceneSaxHandler). When a file
+    //holds several invalid values, the one reported may differ.
+    bool parseStreaming(const std::string& filename, Scene& scene, SceneParseError* error = nullptr);
+
+  private:
+    //Parse the scene file, mapped writable (copy-on-write), into a rapidjson document. Strings are decoded in-situ,
+    //so the document refers to the mapping and must not outlive it. Sets the byte offset of syntax errors.
+    //The whole document is then checked against SceneValidation.h, except for what refers to other parts of it
+    //(indices of vertices, materials and objects), which is left to the parse functions below.
+    bool getJsonDoc(MappedFile& file, rapidjson::Document& doc, SceneParseError& error);
+
+    //Extract scene settings from the rapidjson document
+    void parseSettings(Scene& scene, const rapidjson::Document& doc);
+
+    //Extract scene camera from the rapidjson document
+    void parseCamera(Scene& scene, const rapidjson::Document& doc);
+
+    //Extract scene lights from the rapidjson document
+    void parseLights(Scene& scene, const rapidjson::Document& doc);
+
+    //Extract materials from the rapidjson document
+    void parseMaterials(Scene& scene, const rapidjson::Document& doc);
+
+    //Extract object (meshes) form the rapidjson document. Objects are converted concurrently on ThreadPool::getDefault(),
+    //the meshes keep the order of the file. Objects after an invalid one are skipped; the error reported is always
+    //that of the first invalid object. Materials must be parsed before.
+    //Returns false (setting 'error', all but the byte offset) if an object refers to a missing vertex or material.
+    bool parseObjects(Scene& scene, const rapidjson::Document& doc, SceneParseError& error);
+
+    //Extract mesh instances from the rapidjson document. The "instances" array is optional; every entry refers to an
+    //entry of "objects" and may give a "matrix" (identity by default), a "position" (origin by default) and a
+    //"material_index" (that of the object by default). Objects and materials must be parsed before.
+    //Returns false (setting 'error', all but the byte offset) if an instance refers to a missing object or material,
+    //or its matrix cannot be inverted.
+    bool parseInstances(Scene& scene, const rapidjson::Document& doc, SceneParseError& error);
+
+    //Convert a vector object (geometric 3D vector) from rapidjson array to a local Vector3 object.
+    Vector3 loadVector(const rapidjson::Value::ConstArray& arr);
+
+    //Convert a matrix object from rapidjson array to a local Matrix3x3 object.
+    Matrix3x3 loadMatrix(const rapidjson::Value::ConstArray& arr);
+
+    //Convert a vertex list from rapidjson array to a local list of Vector3 objects.
+    void loadVertices(const rapidjson::Value::ConstArray& arr, std::vector<Vector3>& vertices);
+
+    //Convert a triangle list from rapidjson array to a local list of TriProxy objects.
+    //Every index must refer to one of the 'vertexCount' vertices - otherwise 'error' is set for the array at
+    //'pointer' and false returned.
+    bool loadTriangles(const rapidjson::Value::ConstArray& arr, int vertexCount, const std::string& pointer,
+      std::vector<TriProxy>& triangles, SceneParseError& error);
+
+    BVHBuildMode bvhBuildMode = BVHBuildMode::SAH;
+
+    //Memory the DOM pool of parse() starts in, kept for the next file (see JSON_POOL_SIZE_FACTOR)
+    std::vector<char> jsonPoolBuffer;
+  };
+}
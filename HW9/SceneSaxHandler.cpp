@@ -0,0 +1,351 @@
+#include "SceneSaxHandler.h"
+#include "Scene.h"
+#include "Constants.h"
+#include "NumberParser.h"
+#include <assert.h>
+#include <cstring>
+
+namespace ChaosCampAM {
+
+  SceneSaxHandler::SceneSaxHandler(Scene* scene, std::vector<MeshSize>& meshSizes, BVHBuildMode buildMode) :
+    scene(scene), meshSizes(meshSizes), buildMode(buildMode), arrayTarget(ArrayTarget::None), numberArrayOpened(false),
+    lightIntensity(0.0f),
+    matType(MaterialType::Diffuse), matSmooth(false), mesh(0, 0), meshIndex(-1), instanceIndex(-1), instanceObject(-1), instanceMatIndex(-1), componentCount(0) {
+    if (scene) {
+      settings = scene->getSettings();
+      camera = scene->getCamera();
+    }
+  }
+
+  bool SceneSaxHandler::number(double value) {
+    //Vertex and triangle lists make up nearly all of a scene file, so they are checked first
+    if (arrayTarget == ArrayTarget::Vertices) {
+      frames.back().elements++;
+      vertexCoords[componentCount++] = (float)value;
+      if (componentCount == 3) {
+        mesh.pushVertex(Vector3(vertexCoords[0], vertexCoords[1], vertexCoords[2]));
+        componentCount = 0;
+      }
+      return true;
+    }
+    if (arrayTarget == ArrayTarget::Triangles) {
+      //Every index must refer to one of the (counted) vertices of the mesh - meshes never check them again.
+      //The pointer is only built for a bad one.
+      int vertexCount = meshSizes[meshIndex].vertexCount;
+      if (!isIndex(value, vertexCount)) {
+        return checkIndex(value, vertexCount, "vertices", memberPointer() + "/" + std::to_string(frames.back().elements),
+          error);
+      }
+      frames.back().elements++;
+      triIndices[componentCount++] = (int)value;
+      if (componentCount == 3) {
+        mesh.pushTriangle(TriProxy(triIndices[0], triIndices[1], triIndices[2]));
+        componentCount = 0;
+      }
+      return true;
+    }
+    if (!checkValue(ValueType::Number, value)) return false;
+    if (arrayTarget == ArrayTarget::Scratch) {
+      scratch.push_back((float)value);
+      return true;
+    }
+
+    //Single numbers - integers where checked to be
+    if (atPath(STR_SETTINGS, STR_IMG_SETTINGS, STR_WIDTH)) settings.setWidth((int)value);
+    else if (atPath(STR_SETTINGS, STR_IMG_SETTINGS, STR_HEIGHT)) settings.setHeight((int)value);
+    else if (atPath(STR_LIGHTS, STR_LIGHT_INTENSITY)) lightIntensity = (float)value;
+    else if (atPath(STR_OBJECTS, STR_MAT_INDEX)) {
+      mesh.setMatIndex((int)value);
+      materialRefs.push_back(MaterialRef{ STR_OBJECTS, meshIndex, (int)value });
+    }
+    else if (atPath(STR_INSTANCES, STR_INSTANCE_OBJECT)) instanceObject = (int)value;
+    else if (atPath(STR_INSTANCES, STR_MAT_INDEX)) {
+      instanceMatIndex = (int)value;
+      materialRefs.push_back(MaterialRef{ STR_INSTANCES, instanceIndex, (int)value });
+    }
+    return true;
+  }
+
+  bool SceneSaxHandler::RawNumber(const char* /*str*/, rapidjson::SizeType /*length*/, bool /*copy*/) {
+    //Only seen in the counting pass - numbers are not converted, just counted
+    if (arrayTarget == ArrayTarget::Vertices) {
+      if (++componentCount == 3) {
+        meshSizes.back().vertexCount++;
+        componentCount = 0;
+      }
+    }
+    else if (arrayTarget == ArrayTarget::Triangles) {
+      if (++componentCount == 3) {
+        meshSizes.back().triangleCount++;
+        componentCount = 0;
+      }
+    }
+    return true;
+  }
+
+  bool SceneSaxHandler::Bool(bool b) {
+    if (!checkValue(ValueType::Bool)) return false;
+    if (scene && atPath(STR_MATERIALS, STR_MAT_SMOOTH)) matSmooth = b;
+    return true;
+  }
+
+  bool SceneSaxHandler::String(const char* str, rapidjson::SizeType /*length*/, bool /*copy*/) {
+    if (!checkValue(ValueType::String)) return false;
+    if (scene && atPath(STR_MATERIALS, STR_MAT_TYPE)) {
+      //Diffuse by default
+      matType = strcmp(str, STR_MAT_TYPE_REFLECTIVE) == 0 ? MaterialType::Reflective : MaterialType::Diffuse;
+    }
+    return true;
+  }
+
+  bool SceneSaxHandler::StartObject() {
+    if (!checkValue(ValueType::Object)) return false;
+
+    //Start of an element of one of the top-level arrays
+    if (atPath(STR_LIGHTS)) {
+      lightPos = Vector3();
+      lightIntensity = 0.0f;
+    }
+    else if (atPath(STR_MATERIALS)) {
+      matType = MaterialType::Diffuse;
+      matAlbedo = Vector3();
+      matSmooth = false;
+    }
+    else if (atPath(STR_INSTANCES)) {
+      instanceIndex++;
+      instanceObject = -1;
+      instanceMatrix = createIdentity();
+      instancePos = Vector3();
+      instanceMatIndex = -1;
+    }
+    else if (atPath(STR_OBJECTS)) {
+      meshIndex++;
+      if (scene) {
+        //Allocate the final storage of the mesh at once
+        assert(meshIndex < (int)meshSizes.size());
+        mesh = Mesh(meshSizes[meshIndex].vertexCount, meshSizes[meshIndex].triangleCount);
+      }
+      else {
+        meshSizes.push_back(MeshSize{ 0, 0 });
+      }
+    }
+
+    //Numbers inside the object are its members, not elements of the enclosing array
+    arrayTarget = ArrayTarget::None;
+    keys.emplace_back();
+
+    //Scene objects are the values of Object members and the elements of Array members
+    ObjectFrame frame{ SceneObjectKind::Root, frames.empty(), nullptr, 0, 0, 0 };
+    if (!frames.empty() && frames.back().member) {
+      const ObjectFrame& parent = frames.back();
+      SceneValueKind parentKind = parent.member->kind;
+      if ((parentKind == SceneValueKind::Object && parent.openArrays == 0) ||
+        (parentKind == SceneValueKind::Array && parent.openArrays == 1)) {
+        frame.kind = parent.member->child;
+        frame.checked = true;
+      }
+    }
+    frames.push_back(frame);
+    return true;
+  }
+
+  bool SceneSaxHandler::Key(const char* str, rapidjson::SizeType length, bool /*copy*/) {
+    keys.back().assign(str, length);
+
+    ObjectFrame& frame = frames.back();
+    frame.member = nullptr;
+    frame.openArrays = 0;
+    frame.elements = 0;
+    int member = frame.checked ? findSceneMember(frame.kind, str) : -1;
+    if (member >= 0) {
+      int memberCount;
+      frame.member = getSceneMembers(frame.kind, memberCount) + member;
+      frame.presentMembers |= 1u << member;
+    }
+    return true;
+  }
+
+  bool SceneSaxHandler::EndObject(rapidjson::SizeType /*memberCount*/) {
+    std::string pointer;
+    if (scene && frames.back().checked) {
+      pointer = objectPointer();
+      if (!checkRequiredMembers(frames.back().kind, frames.back().presentMembers, pointer, error)) return false;
+    }
+    frames.pop_back();
+    keys.pop_back();
+    if (!scene) return true;
+
+    if (atPath(STR_SETTINGS)) {
+      scene->setSettings(settings);
+    }
+    else if (atPath(STR_CAMERA)) {
+      scene->setCamera(camera);
+    }
+    else if (atPath(STR_LIGHTS)) {
+      scene->addPointLight(PointLight(lightPos, lightIntensity));
+    }
+    else if (atPath(STR_MATERIALS)) {
+      scene->addMaterial(Material(matType, matAlbedo, matSmooth));
+    }
+    else if (atPath(STR_OBJECTS)) {
+      mesh.recalculateNormals();
+      mesh.buildBVH(buildMode);
+      scene->addMesh(std::move(mesh));
+    }
+    else if (atPath(STR_INSTANCES)) {
+      //The instanced object must exist (all objects were counted by the first pass), and the transform be invertible
+      if (!checkIndex(instanceObject, (int)meshSizes.size(), "objects", pointer + "/" + STR_INSTANCE_OBJECT, error) ||
+        !checkTransform(instanceMatrix, pointer + "/" + STR_MATRIX, error)) {
+        return false;
+      }
+      scene->addInstance(MeshInstance(instanceObject, instanceMatrix, instancePos, instanceMatIndex));
+    }
+    return true;
+  }
+
+  bool SceneSaxHandler::StartArray() {
+    if (!checkValue(ValueType::Array)) return false;
+    if (!frames.empty()) frames.back().openArrays++;
+
+    componentCount = 0;
+    if (atPath(STR_OBJECTS, STR_VERTICES)) {
+      arrayTarget = ArrayTarget::Vertices;
+      numberArrayOpened = true;
+    }
+    else if (atPath(STR_OBJECTS, STR_TRIANGLES)) {
+      arrayTarget = ArrayTarget::Triangles;
+      numberArrayOpened = true;
+    }
+    else {
+      arrayTarget = ArrayTarget::Scratch;
+      scratch.clear();
+    }
+    return true;
+  }
+
+  bool SceneSaxHandler::EndArray(rapidjson::SizeType /*elementCount*/) {
+    if (frames.empty()) return true; //the whole file - only reached by the counting pass
+    ObjectFrame& frame = frames.back();
+    //Vectors and matrices must be of their size, vertex and index lists hold whole 3-tuples
+    if (scene && frame.member && frame.openArrays == 1 && isNumberListKind(frame.member->kind) &&
+      !isValidListSize(frame.member->kind, frame.elements)) {
+      return failSceneValue(memberPointer(), describeValueKind(frame.member->kind), error);
+    }
+    frame.openArrays--;
+
+    if (arrayTarget == ArrayTarget::Scratch && scene) {
+      if (atPath(STR_SETTINGS, STR_BG_COLOR)) settings.setBgColor(scratchVector());
+      else if (atPath(STR_CAMERA, STR_POS)) camera.setPosition(scratchVector());
+      else if (atPath(STR_CAMERA, STR_MATRIX)) camera.setOrientation(scratchMatrix());
+      else if (atPath(STR_LIGHTS, STR_POS)) lightPos = scratchVector();
+      else if (atPath(STR_MATERIALS, STR_MAT_ALBEDO)) matAlbedo = scratchVector();
+      else if (atPath(STR_INSTANCES, STR_MATRIX)) instanceMatrix = scratchMatrix();
+      else if (atPath(STR_INSTANCES, STR_POS)) instancePos = scratchVector();
+    }
+    arrayTarget = ArrayTarget::None;
+    return true;
+  }
+
+  const char* SceneSaxHandler::readNumberArray(const char* pos, const char* end) {
+    if (!numberArrayOpened) return pos;
+    numberArrayOpened = false;
+
+    if (!scene) {
+      //Counting pass - only the delimiters are scanned
+      int count;
+      const char* close = countArrayElements(pos, end, count);
+      MeshSize& size = meshSizes.back();
+      (arrayTarget == ArrayTarget::Vertices ? size.vertexCount : size.triangleCount) += count / 3;
+      componentCount = count % 3;
+      return close;
+    }
+    return parseNumberArray(pos, end, [this](double value) { return number(value); });
+  }
+
+  bool SceneSaxHandler::finish() {
+    int materialCount = (int)scene->getMaterials().size();
+    for (const MaterialRef& ref : materialRefs) {
+      if (!isIndex(ref.matIndex, materialCount)) {
+        return checkIndex(ref.matIndex, materialCount, "materials", std::string("/") + ref.section + "/" +
+          std::to_string(ref.element) + "/" + STR_MAT_INDEX, error);
+      }
+    }
+    return true;
+  }
+
+  const SceneParseError& SceneSaxHandler::getError() const {
+    return error;
+  }
+
+  bool SceneSaxHandler::checkValue(ValueType type, double number) {
+    if (!scene) return true;
+    //The parsers read nothing but an object from the file
+    if (frames.empty()) {
+      if (type == ValueType::Object) return true;
+      return failSceneValue("", describeValueKind(SceneValueKind::Object), error);
+    }
+    ObjectFrame& frame = frames.back();
+    if (!frame.member) return true;
+    SceneValueKind kind = frame.member->kind;
+
+    //The value of the member itself
+    if (frame.openArrays == 0) {
+      bool valid;
+      switch (kind) {
+      case SceneValueKind::Object: valid = type == ValueType::Object; break;
+      case SceneValueKind::Number:
+      case SceneValueKind::Integer:
+      case SceneValueKind::Size: valid = type == ValueType::Number && isValidNumber(kind, number); break;
+      case SceneValueKind::Bool: valid = type == ValueType::Bool; break;
+      case SceneValueKind::String: valid = type == ValueType::String; break;
+      default: valid = type == ValueType::Array; break; //Array members and lists of numbers
+      }
+      return valid || failSceneValue(memberPointer(), describeValueKind(kind), error);
+    }
+
+    //An element of its array - scene objects in Array members, numbers in the others. Values nested deeper are only
+    //met in elements already rejected.
+    if (frame.openArrays == 1) {
+      bool objects = kind == SceneValueKind::Array;
+      if (type != (objects ? ValueType::Object : ValueType::Number)) {
+        return failSceneValue(memberPointer() + "/" + std::to_string(frame.elements),
+          describeValueKind(objects ? SceneValueKind::Object : SceneValueKind::Number), error);
+      }
+      frame.elements++;
+    }
+    return true;
+  }
+
+  std::string SceneSaxHandler::objectPointer() const {
+    //Every open object is the value of a member of the one before it, or an element of that member's array
+    std::string pointer;
+    for (size_t i = 0; i + 1 < frames.size(); i++) {
+      pointer += "/" + keys[i];
+      if (frames[i].openArrays > 0) pointer += "/" + std::to_string(frames[i].elements - 1);
+    }
+    return pointer;
+  }
+
+  std::string SceneSaxHandler::memberPointer() const {
+    return objectPointer() + "/" + keys.back();
+  }
+
+  bool SceneSaxHandler::atPath(const char* key0, const char* key1, const char* key2) const {
+    size_t depth = key2 ? 3 : (key1 ? 2 : 1);
+    if (keys.size() != depth) return false;
+    return keys[0] == key0 && (!key1 || keys[1] == key1) && (!key2 || keys[2] == key2);
+  }
+
+  Vector3 SceneSaxHandler::scratchVector() const {
+    return Vector3(scratch[0], scratch[1], scratch[2]);
+  }
+
+  Matrix3x3 SceneSaxHandler::scratchMatrix() const {
+    //.crtscene stores matrices in column-major fashion!
+    return Matrix3x3(
+      scratch[0], scratch[3], scratch[6],//row 0
+      scratch[1], scratch[4], scratch[7],//row 1
+      scratch[2], scratch[5], scratch[8] //row 2
+    );
+  }
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Mesh.h"
+#include "Settings.h"
+#include "Camera.h"
+#include "Material.h"
+#include "SceneValidation.h"
+
+#include "rapidjson/reader.h"
+
+namespace ChaosCampAM {
+  //Forward-declarations
+  class Scene;
+
+  /*
+  * rapidjson SAX handler for .crtscene files - builds the scene while the file is read, without a DOM.
+  * Only the keys leading to the current value are kept. The numbers of short arrays (vectors, matrices) are gathered
+  * in a small scratch buffer, while "vertices" and "triangles" are pushed straight into the mesh being built.
+  * The text of those two lists may be handed to readNumberArray() instead, which reads it much faster than rapidjson.
+  * The handler is used in two passes over the file:
+  *  - counting pass (no scene given): records the number of vertices and triangles of every object, numbers are not
+  *    converted (parse with kParseNumbersAsStringsFlag);
+  *  - loading pass: fills the scene, allocating the storage of every mesh once with the counted sizes.
+  * The loading pass also checks every value against SceneValidation.h, like SceneParser::parse() - a rejected value
+  * stops the parse, getError() tells why. Material indices are only checked by finish(), after the pass.
+  */
+  class SceneSaxHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, SceneSaxHandler> {
+  public:
+    //Size of the vertex and triangle lists of one object
+    struct MeshSize {
+      int vertexCount;
+      int triangleCount;
+    };
+
+    //'scene' = nullptr for the counting pass, which appends to 'meshSizes'.
+    //Otherwise 'meshSizes' must hold the result of the counting pass over the same file.
+    //Mesh BVHs are built as given by 'buildMode'.
+    SceneSaxHandler(Scene* scene, std::vector<MeshSize>& meshSizes, BVHBuildMode buildMode = BVHBuildMode::SAH);
+
+    //rapidjson handler interface
+    bool Null() { return checkValue(ValueType::Null); }
+    bool Bool(bool b);
+    bool Int(int i) { return number(i); }
+    bool Uint(unsigned u) { return number(u); }
+    bool Int64(int64_t i) { return number((double)i); }
+    bool Uint64(uint64_t u) { return number((double)u); }
+    bool Double(double d) { return number(d); }
+    bool RawNumber(const char* str, rapidjson::SizeType length, bool copy);
+    bool String(const char* str, rapidjson::SizeType length, bool copy);
+    bool StartObject();
+    bool Key(const char* str, rapidjson::SizeType length, bool copy);
+    bool EndObject(rapidjson::SizeType memberCount);
+    bool StartArray();
+    bool EndArray(rapidjson::SizeType elementCount);
+
+    //Fast path for "vertices" and "triangles" - meant to be called after every event, with the rest of the file text
+    //starting at the read position of the reader. Right after such a list was opened, its elements are consumed
+    //(counted in the counting pass, parsed with parseNumber() in the loading pass) up to the closing ']', where the
+    //reader should continue. Returns 'pos' itself in any other case.
+    const char* readNumberArray(const char* pos, const char* end);
+
+    //Check the material indices of the objects and instances read by the loading pass against the materials of the
+    //scene. Returns false if one refers to a missing material.
+    bool finish();
+
+    //Why the loading pass or finish() rejected the file - all but the byte offset
+    const SceneParseError& getError() const;
+
+  private:
+    //Where the numbers of the innermost open array go
+    enum class ArrayTarget { None, Scratch, Vertices, Triangles };
+
+    //Types of JSON values, as told by the reader events
+    enum class ValueType { Null, Bool, Number, String, Object, Array };
+
+    //Validation state of an open object
+    struct ObjectFrame {
+      SceneObjectKind kind;
+      bool checked; //false inside members the parsers do not read
+      const SceneMember* member; //current member, nullptr if the parsers do not read it
+      unsigned presentMembers; //bit 'i' set if member 'i' of the kind was met
+      int openArrays; //arrays open in the value of the current member
+      int elements; //elements met so far in its outermost array
+    };
+
+    //Material index of an object or instance, checked by finish()
+    struct MaterialRef {
+      const char* section;
+      int element;
+      int matIndex;
+    };
+
+    bool number(double value);
+
+    //Check a value met in the loading pass: as the value of the current member, or as an element of its array
+    bool checkValue(ValueType type, double number = 0.0);
+
+    //JSON pointers of the innermost open object, and of its current member
+    std::string objectPointer() const;
+    std::string memberPointer() const;
+
+    //True if the keys leading to the current value are exactly the ones given.
+    bool atPath(const char* key0, const char* key1 = nullptr, const char* key2 = nullptr) const;
+
+    //Convert the scratch buffer, checked to hold 3 / 9 numbers, to a vector / column-major matrix (as stored in
+    //.crtscene).
+    Vector3 scratchVector() const;
+    Matrix3x3 scratchMatrix() const;
+
+    Scene* scene;
+    std::vector<MeshSize>& meshSizes;
+    BVHBuildMode buildMode;
+
+    //Key of the current member of every open object, outermost first
+    std::vector<std::string> keys;
+    //Validation state of every open object, outermost first
+    std::vector<ObjectFrame> frames;
+    SceneParseError error;
+    std::vector<MaterialRef> materialRefs;
+    ArrayTarget arrayTarget;
+    bool numberArrayOpened; //a vertex or triangle list was opened by the last event
+    std::vector<float> scratch;
+
+    //Objects being read
+    Settings settings;
+    Camera camera;
+    Vector3 lightPos;
+    float lightIntensity;
+    MaterialType matType;
+    Vector3 matAlbedo;
+    bool matSmooth;
+    Mesh mesh;
+    int meshIndex;
+    int instanceIndex;
+    int instanceObject;
+    Matrix3x3 instanceMatrix;
+    Vector3 instancePos;
+    int instanceMatIndex;
+    //Components of the vertex / triangle being read
+    float vertexCoords[3];
+    int triIndices[3];
+    int componentCount;
+  };
+}
@@ -0,0 +1,159 @@
+#include "SceneValidation.h"
+#include "Math/Vector3.h"
+#include "Math/Matrix3x3.h"
+#include "Constants.h"
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+namespace ChaosCampAM {
+
+  //Members of every kind of scene object - see SceneObjectKind
+  static const SceneMember ROOT_MEMBERS[] = {
+    { STR_SETTINGS, SceneValueKind::Object, false, SceneObjectKind::Settings },
+    { STR_CAMERA, SceneValueKind::Object, false, SceneObjectKind::Camera },
+    { STR_LIGHTS, SceneValueKind::Array, false, SceneObjectKind::Light },
+    { STR_MATERIALS, SceneValueKind::Array, false, SceneObjectKind::Material },
+    { STR_OBJECTS, SceneValueKind::Array, false, SceneObjectKind::Object },
+    { STR_INSTANCES, SceneValueKind::Array, false, SceneObjectKind::Instance }
+  };
+  static const SceneMember SETTINGS_MEMBERS[] = {
+    { STR_BG_COLOR, SceneValueKind::Vector, true },
+    { STR_IMG_SETTINGS, SceneValueKind::Object, true, SceneObjectKind::ImageSettings }
+  };
+  static const SceneMember IMAGE_SETTINGS_MEMBERS[] = {
+    { STR_WIDTH, SceneValueKind::Size, true },
+    { STR_HEIGHT, SceneValueKind::Size, true }
+  };
+  static const SceneMember CAMERA_MEMBERS[] = {
+    { STR_POS, SceneValueKind::Vector, true },
+    { STR_MATRIX, SceneValueKind::Matrix, true }
+  };
+  static const SceneMember LIGHT_MEMBERS[] = {
+    { STR_LIGHT_INTENSITY, SceneValueKind::Number, true },
+    { STR_POS, SceneValueKind::Vector, true }
+  };
+  static const SceneMember MATERIAL_MEMBERS[] = {
+    { STR_MAT_TYPE, SceneValueKind::String, true },
+    { STR_MAT_ALBEDO, SceneValueKind::Vector, true },
+    { STR_MAT_SMOOTH, SceneValueKind::Bool, true }
+  };
+  static const SceneMember OBJECT_MEMBERS[] = {
+    { STR_MAT_INDEX, SceneValueKind::Integer, true },
+    { STR_VERTICES, SceneValueKind::NumberList, true },
+    { STR_TRIANGLES, SceneValueKind::IndexList, true }
+  };
+  //Instances place their object at the origin, untransformed, with the object's material by default
+  static const SceneMember INSTANCE_MEMBERS[] = {
+    { STR_INSTANCE_OBJECT, SceneValueKind::Integer, true },
+    { STR_MATRIX, SceneValueKind::Matrix, false },
+    { STR_POS, SceneValueKind::Vector, false },
+    { STR_MAT_INDEX, SceneValueKind::Integer, false }
+  };
+
+  template<size_t Count>
+  static const SceneMember* memberList(const SceneMember (&members)[Count], int& count) {
+    count = (int)Count;
+    return members;
+  }
+
+  std::string SceneParseError::describe() const {
+    return (pointer.empty() ? std::string("/") : pointer) + " (byte " + std::to_string(offset) + "): expected " +
+      expected;
+  }
+
+  const SceneMember* getSceneMembers(SceneObjectKind object, int& count) {
+    switch (object) {
+    case SceneObjectKind::Root: return memberList(ROOT_MEMBERS, count);
+    case SceneObjectKind::Settings: return memberList(SETTINGS_MEMBERS, count);
+    case SceneObjectKind::ImageSettings: return memberList(IMAGE_SETTINGS_MEMBERS, count);
+    case SceneObjectKind::Camera: return memberList(CAMERA_MEMBERS, count);
+    case SceneObjectKind::Light: return memberList(LIGHT_MEMBERS, count);
+    case SceneObjectKind::Material: return memberList(MATERIAL_MEMBERS, count);
+    case SceneObjectKind::Object: return memberList(OBJECT_MEMBERS, count);
+    case SceneObjectKind::Instance: return memberList(INSTANCE_MEMBERS, count);
+    }
+    count = 0;
+    return nullptr;
+  }
+
+  int findSceneMember(SceneObjectKind object, const char* key) {
+    int count;
+    const SceneMember* members = getSceneMembers(object, count);
+    for (int i = 0; i < count; i++) {
+      if (strcmp(members[i].key, key) == 0) return i;
+    }
+    return -1;
+  }
+
+  std::string describeValueKind(SceneValueKind kind) {
+    switch (kind) {
+    case SceneValueKind::Object: return "an object";
+    case SceneValueKind::Array: return "an array";
+    case SceneValueKind::Number: return "a number";
+    case SceneValueKind::Integer: return "an integer";
+    case SceneValueKind::Size: return "an integer from 1 to " + std::to_string(MAX_IMAGE_SIZE);
+    case SceneValueKind::Bool: return "a boolean";
+    case SceneValueKind::String: return "a string";
+    case SceneValueKind::Vector: return "an array of 3 numbers";
+    case SceneValueKind::Matrix: return "an array of 9 numbers";
+    case SceneValueKind::NumberList: return "an array of numbers, a multiple of 3 long";
+    case SceneValueKind::IndexList: return "an array of vertex indices, a multiple of 3 long";
+    }
+    return "";
+  }
+
+  bool isNumberListKind(SceneValueKind kind) {
+    return kind == SceneValueKind::Vector || kind == SceneValueKind::Matrix || kind == SceneValueKind::NumberList ||
+      kind == SceneValueKind::IndexList;
+  }
+
+  bool isValidListSize(SceneValueKind kind, size_t size) {
+    switch (kind) {
+    case SceneValueKind::Vector: return size == 3;
+    case SceneValueKind::Matrix: return size == 9;
+    case SceneValueKind::NumberList:
+    case SceneValueKind::IndexList: return size % 3 == 0;
+    default: return false;
+    }
+  }
+
+  bool isValidNumber(SceneValueKind kind, double value) {
+    switch (kind) {
+    case SceneValueKind::Number: return true;
+    case SceneValueKind::Integer: return value >= INT_MIN && value <= INT_MAX && value == std::floor(value);
+    case SceneValueKind::Size: return value >= 1 && value <= MAX_IMAGE_SIZE && value == std::floor(value);
+    default: return false;
+    }
+  }
+
+  bool failSceneValue(const std::string& pointer, const std::string& expected, SceneParseError& error) {
+    error.pointer = pointer;
+    error.expected = expected;
+    return false;
+  }
+
+  bool checkRequiredMembers(SceneObjectKind object, unsigned presentMembers, const std::string& pointer,
+    SceneParseError& error) {
+    int count;
+    const SceneMember* members = getSceneMembers(object, count);
+    for (int i = 0; i < count; i++) {
+      if (members[i].required && !(presentMembers & (1u << i))) {
+        return failSceneValue(pointer + "/" + members[i].key, "a member \"" + std::string(members[i].key) + "\"",
+          error);
+      }
+    }
+    return true;
+  }
+
+  bool checkIndex(double value, int count, const char* things, const std::string& pointer, SceneParseError& error) {
+    if (isIndex(value, count)) return true;
+    return failSceneValue(pointer, "the index of one of the " + std::to_string(count) + " " + things, error);
+  }
+
+  bool checkTransform(const Matrix3x3& transform, const std::string& pointer, SceneParseError& error) {
+    //Instances keep the inverse transform
+    if (transform.getDeterminant() != 0.0f) return true;
+    return failSceneValue(pointer, "a non-singular 3x3 matrix", error);
+  }
+}
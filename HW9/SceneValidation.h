@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace ChaosCampAM {
+  //Forward-declarations
+  class Matrix3x3;
+
+  //Why a scene file was rejected (see SceneParser)
+  struct SceneParseError {
+    std::string pointer; //JSON pointer to the offending value (e.g. "/objects/2/triangles/7"), "" for the whole file
+    size_t offset = 0; //byte offset in the file - of the offending value, or of the object missing a member
+    std::string expected; //what should have been there (e.g. "an array of 3 numbers"), or what is wrong with the JSON
+
+    //One line for the log: "/objects/2/triangles/7 (byte 1234): expected ..."
+    std::string describe() const;
+  };
+
+  //Checks on the contents of .crtscene files, shared by both parsers - SceneParser::parse() (DOM) and
+  //SceneParser::parseStreaming() (SceneSaxHandler) - so that they reject exactly the same files.
+  //The checks that fail set the JSON pointer and the expectation of 'error' and return false. The byte offset is left
+  //to the parser.
+
+  //The objects of a scene file, each with its own set of members
+  enum class SceneObjectKind { Root, Settings, ImageSettings, Camera, Light, Material, Object, Instance };
+
+  //What a member of a scene object holds
+  enum class SceneValueKind {
+    Object, //a scene object of the member's 'child' kind
+    Array, //an array of scene objects of the member's 'child' kind
+    Number,
+    Integer, //an integral number within the range of int
+    Size, //an integer in [1;MAX_IMAGE_SIZE]
+    Bool,
+    String,
+    Vector, //an array of 3 numbers
+    Matrix, //an array of 9 numbers
+    NumberList, //an array of numbers, a multiple of 3 long
+    IndexList //an array of indices (see isIndex()), a multiple of 3 long
+  };
+
+  struct SceneMember {
+    const char* key;
+    SceneValueKind kind;
+    bool required;
+    SceneObjectKind child = SceneObjectKind::Root; //only for Object and Array members
+  };
+
+  //Members the parsers read from a kind of scene object, 'count' set to their number (at most 32). Any other member
+  //is ignored.
+  const SceneMember* getSceneMembers(SceneObjectKind object, int& count);
+
+  //Index of the member 'key' among getSceneMembers(object), -1 if the parsers do not read it
+  int findSceneMember(SceneObjectKind object, const char* key);
+
+  //What a value of the given kind looks like - the expectation reported when a value is of another kind
+  std::string describeValueKind(SceneValueKind kind);
+
+  //True for the kinds held in an array of numbers (Vector, Matrix, NumberList, IndexList)
+  bool isNumberListKind(SceneValueKind kind);
+
+  //Whether an array of numbers of the given kind may hold 'size' numbers
+  bool isValidListSize(SceneValueKind kind, size_t size);
+
+  //Whether a number is a valid value of a Number, Integer or Size member
+  bool isValidNumber(SceneValueKind kind, double value);
+
+  //Whether a number is an integer in [0;count) - the index of one of 'count' vertices, materials, objects...
+  inline bool isIndex(double value, int count) {
+    return value >= 0.0 && value < (double)count && value == (double)(int)value;
+  }
+
+  //Sets 'expected' as the expectation at 'pointer' and returns false
+  bool failSceneValue(const std::string& pointer, const std::string& expected, SceneParseError& error);
+
+  //Check that a scene object has all its required members. Bit 'i' of 'presentMembers' is set if member 'i' (see
+  //getSceneMembers()) is present. 'pointer' is that of the object.
+  bool checkRequiredMembers(SceneObjectKind object, unsigned presentMembers, const std::string& pointer,
+    SceneParseError& error);
+
+  //Check that the value at 'pointer' is the index of one of 'count' 'things' ("vertices", "materials", "objects")
+  bool checkIndex(double value, int count, const char* things, const std::string& pointer, SceneParseError& error);
+
+  //Check that the transform of an instance (at 'pointer') can be inverted
+  bool checkTransform(const Matrix3x3& transform, const std::string& pointer, SceneParseError& error);
+}
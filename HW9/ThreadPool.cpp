@@ -0,0 +1,128 @@
+#include "ThreadPool.h"
+
+namespace ChaosCampAM {
+
+  //Pool and queue index of the current thread, set for the worker threads only
+  static thread_local const ThreadPool* currentPool = nullptr;
+  static thread_local int currentThreadIndex = 0;
+
+  ThreadPool::ThreadPool(int threadCount) : queuedTasks(0), nextExternalQueue(0), stopping(false) {
+    if (threadCount <= 0) {
+      threadCount = (int)std::thread::hardware_concurrency();
+      if (threadCount <= 0) threadCount = 1;
+    }
+
+    for (int i = 0; i < threadCount; i++) {
+      queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    }
+
+    //Thread 0 is whoever waits on the pool, so only threadCount - 1 workers are started
+    for (int i = 1; i < threadCount; i++) {
+      workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+  }
+
+  ThreadPool::~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      stopping = true;
+    }
+    wakeUp.notify_all();
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+  }
+
+  ThreadPool& ThreadPool::getDefault() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  int ThreadPool::getThreadCount() const {
+    return (int)queues.size();
+  }
+
+  int ThreadPool::getThreadIndex() const {
+    return currentPool == this ? currentThreadIndex : 0;
+  }
+
+  void ThreadPool::submit(TaskGroup& group, std::function<void()> task) {
+    group.pending++;
+
+    //Workers keep their own tasks local, external submissions are spread over all queues so every thread starts busy
+    int queueIndex = getThreadIndex();
+    if (currentPool != this) {
+      queueIndex = nextExternalQueue++ % queues.size();
+    }
+
+    WorkQueue& queue = *queues[queueIndex];
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.tasks.push_back(Task{ std::move(task), &group });
+    }
+
+    //The increment has to be visible to a worker going to sleep, so it happens under the sleep mutex
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      queuedTasks++;
+    }
+    wakeUp.notify_one();
+  }
+
+  void ThreadPool::wait(TaskGroup& group) {
+    int threadIndex = getThreadIndex();
+    while (group.pending > 0) {
+      if (!runOneTask(threadIndex)) {
+        //Remaining tasks of the group are running on other threads
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  bool ThreadPool::runOneTask(int threadIndex) {
+    Task task;
+    bool found = false;
+
+    //Own queue first, newest task
+    {
+      WorkQueue& own = *queues[threadIndex];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tasks.empty()) {
+        task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        found = true;
+      }
+    }
+
+    //Otherwise steal the oldest task of another thread, starting with the next one to spread contention
+    for (int i = 1; i < (int)queues.size() && !found; i++) {
+      WorkQueue& victim = *queues[(threadIndex + i) % queues.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        found = true;
+      }
+    }
+
+    if (!found) return false;
+
+    queuedTasks--;
+    task.func();
+    task.group->pending--;
+    return true;
+  }
+
+  void ThreadPool::workerLoop(int threadIndex) {
+    currentPool = this;
+    currentThreadIndex = threadIndex;
+
+    while (true) {
+      if (runOneTask(threadIndex)) continue;
+
+      std::unique_lock<std::mutex> lock(sleepMutex);
+      wakeUp.wait(lock, [this]() { return stopping || queuedTasks > 0; });
+      if (stopping) return;
+    }
+  }
+}
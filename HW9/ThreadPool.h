@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ChaosCampAM {
+
+  //A set of tasks that can be waited on together. Tasks may add more tasks to their own group.
+  class TaskGroup {
+  public:
+    TaskGroup() : pending(0) {}
+
+  private:
+    friend class ThreadPool;
+    std::atomic<int> pending; //tasks submitted but not yet finished
+  };
+
+  /*
+  * Work-stealing thread pool.
+  * Every thread owns a task queue: it pushes and pops its own tasks at the back (most recent first, cache-friendly for
+  * nested work) and, when it runs dry, steals from the front of the other queues (oldest, usually biggest tasks first).
+  * The thread that waits on a task group does not idle either - it executes tasks until the group is done.
+  */
+  class ThreadPool {
+  public:
+    //'threadCount' is the total number of threads executing tasks, INCLUDING the thread that waits for them.
+    //0 picks one thread per hardware thread. A pool of 1 runs everything on the waiting thread.
+    explicit ThreadPool(int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //Process-wide pool for work outside of rendering (scene loading, acceleration structure builds).
+    //One thread per hardware thread, created on first use.
+    static ThreadPool& getDefault();
+
+    int getThreadCount() const;
+
+    //Index of the calling thread within the pool, in [0;getThreadCount()). Threads outside the pool get 0.
+    //Useful for indexing per-thread data.
+    int getThreadIndex() const;
+
+    //Queue a task as part of the given group. Safe to call from any thread, including from within a task.
+    void submit(TaskGroup& group, std::function<void()> task);
+
+    //Execute queued tasks on the calling thread until every task of the group has finished.
+    void wait(TaskGroup& group);
+
+    //Call 'func(index)' for every index in [begin;end), in chunks of 'grainSize' consecutive indices per task,
+    //and wait for all of them.
+    template<typename Func>
+    void parallelFor(int begin, int end, int grainSize, Func func);
+
+  private:
+    struct Task {
+      std::function<void()> func;
+      TaskGroup* group;
+    };
+
+    struct WorkQueue {
+      std::mutex mutex;
+      std::deque<Task> tasks;
+    };
+
+    //Take a task from the queue of thread 'threadIndex', or steal one, and run it. Returns false if there was no task.
+    bool runOneTask(int threadIndex);
+
+    void workerLoop(int threadIndex);
+
+    std::vector<std::unique_ptr<WorkQueue>> queues; //queue 0 belongs to the external (waiting) threads
+    std::vector<std::thread> workers;
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    std::atomic<int> queuedTasks; //tasks sitting in some queue, not yet taken
+    std::atomic<unsigned> nextExternalQueue; //round-robin queue for tasks submitted from outside the pool
+    bool stopping;
+  };
+
+  template<typename Func>
+  void ThreadPool::parallelFor(int begin, int end, int grainSize, Func func) {
+    TaskGroup group;
+    for (int chunkBegin = begin; chunkBegin < end; chunkBegin += grainSize) {
+      int chunkEnd = chunkBegin + grainSize < end ? chunkBegin + grainSize : end;
+      submit(group, [chunkBegin, chunkEnd, &func]() {
+        for (int i = chunkBegin; i < chunkEnd; i++) {
+          func(i);
+        }
+      });
+    }
+    wait(group);
+  }
+}
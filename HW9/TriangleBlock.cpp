@@ -0,0 +1,409 @@
+#include "TriangleBlock.h"
+#include "Math/MathUtil.h"
+#include "Math/Simd.h"
+#include <cfloat>
+
+#ifdef CHAOS_SIMD_X86
+#include <immintrin.h>
+#endif
+
+//All kernels below implement the Moller-Trumbore test of Triangle::intersect(), lane by lane:
+//  p = dir x e2, det = e1.p, t = origin - v0, u = (t.p)/det, q = t x e1, v = (dir.q)/det, dist = (e2.q)/det
+//The rejection tests are kept in exactly the same (negated) form, so NaN lanes behave the same in every kernel.
+
+namespace ChaosCampAM {
+
+  TriBlock::TriBlock() {
+    for (int lane = 0; lane < TRI_BLOCK_SIZE; lane++) {
+      setLane(lane, Vector3(), Vector3(), Vector3(), -1);
+    }
+  }
+
+  void TriBlock::setLane(int lane, const Vector3& v0, const Vector3& v1, const Vector3& v2, int index) {
+    Vector3 e1 = v1 - v0;
+    Vector3 e2 = v2 - v0;
+    v0x[lane] = v0.x; v0y[lane] = v0.y; v0z[lane] = v0.z;
+    e1x[lane] = e1.x; e1y[lane] = e1.y; e1z[lane] = e1.z;
+    e2x[lane] = e2.x; e2y[lane] = e2.y; e2z[lane] = e2.z;
+    triIndex[lane] = index;
+  }
+
+  //Results of all lanes, used to pick the closest hit
+  struct alignas(32) LaneHits {
+    float dist[TRI_BLOCK_SIZE];
+    float u[TRI_BLOCK_SIZE];
+    float v[TRI_BLOCK_SIZE];
+  };
+
+  //Pick the first lane with the smallest distance among the lanes set in 'hitMask'.
+  static int closestLane(const LaneHits& hits, int hitMask, float& dist, float& u, float& v) {
+    int best = -1;
+    for (int lane = 0; lane < TRI_BLOCK_SIZE; lane++) {
+      if ((hitMask & (1 << lane)) && (best < 0 || hits.dist[lane] < hits.dist[best])) {
+        best = lane;
+      }
+    }
+    if (best >= 0) {
+      dist = hits.dist[best];
+      u = hits.u[best];
+      v = hits.v[best];
+    }
+    return best;
+  }
+
+  /* SCALAR FALLBACK */
+
+  //Returns a bit mask of the lanes hit closer than 'tMax'
+  static int intersectLanesScalar(const TriBlock& b, const Vector3& o, const Vector3& d, float tMax, LaneHits& hits) {
+    int hitMask = 0;
+    for (int i = 0; i < TRI_BLOCK_SIZE; i++) {
+      float px = d.y * b.e2z[i] - d.z * b.e2y[i];
+      float py = d.z * b.e2x[i] - d.x * b.e2z[i];
+      float pz = d.x * b.e2y[i] - d.y * b.e2x[i];
+      float det = b.e1x[i] * px + b.e1y[i] * py + b.e1z[i] * pz;
+      if (det > -EPSILON && det < EPSILON) continue;
+      float invDet = 1.0f / det;
+
+      float tx = o.x - b.v0x[i];
+      float ty = o.y - b.v0y[i];
+      float tz = o.z - b.v0z[i];
+      float u = (tx * px + ty * py + tz * pz) * invDet;
+      if (u < 0.0f || u > 1.0f) continue;
+
+      float qx = ty * b.e1z[i] - tz * b.e1y[i];
+      float qy = tz * b.e1x[i] - tx * b.e1z[i];
+      float qz = tx * b.e1y[i] - ty * b.e1x[i];
+      float v = (d.x * qx + d.y * qy + d.z * qz) * invDet;
+      if (v < 0.0f || u + v > 1.0f) continue;
+
+      float dist = (b.e2x[i] * qx + b.e2y[i] * qy + b.e2z[i] * qz) * invDet;
+      if (dist >= -EPSILON && dist < tMax) {
+        hits.dist[i] = dist;
+        hits.u[i] = u;
+        hits.v[i] = v;
+        hitMask |= 1 << i;
+      }
+    }
+    return hitMask;
+  }
+
+#ifdef CHAOS_SIMD_X86
+
+  /* SSE - two groups of four lanes */
+
+  static int intersectLanesSSE(const TriBlock& b, const Vector3& o, const Vector3& d, float tMax, LaneHits& hits) {
+    const __m128 dx = _mm_set1_ps(d.x), dy = _mm_set1_ps(d.y), dz = _mm_set1_ps(d.z);
+    const __m128 ox = _mm_set1_ps(o.x), oy = _mm_set1_ps(o.y), oz = _mm_set1_ps(o.z);
+    const __m128 eps = _mm_set1_ps(EPSILON), negEps = _mm_set1_ps(-EPSILON);
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), maxDist = _mm_set1_ps(tMax);
+
+    int hitMask = 0;
+    for (int g = 0; g < TRI_BLOCK_SIZE; g += 4) {
+      __m128 e1x = _mm_load_ps(b.e1x + g), e1y = _mm_load_ps(b.e1y + g), e1z = _mm_load_ps(b.e1z + g);
+      __m128 e2x = _mm_load_ps(b.e2x + g), e2y = _mm_load_ps(b.e2y + g), e2z = _mm_load_ps(b.e2z + g);
+
+      __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+      __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+      __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+      __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+      __m128 reject = _mm_and_ps(_mm_cmpgt_ps(det, negEps), _mm_cmplt_ps(det, eps));
+      __m128 invDet = _mm_div_ps(one, det);
+
+      __m128 tx = _mm_sub_ps(ox, _mm_load_ps(b.v0x + g));
+      __m128 ty = _mm_sub_ps(oy, _mm_load_ps(b.v0y + g));
+      __m128 tz = _mm_sub_ps(oz, _mm_load_ps(b.v0z + g));
+      __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), invDet);
+      reject = _mm_or_ps(reject, _mm_or_ps(_mm_cmplt_ps(u, zero), _mm_cmpgt_ps(u, one)));
+
+      __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+      __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+      __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+      __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+      reject = _mm_or_ps(reject, _mm_or_ps(_mm_cmplt_ps(v, zero), _mm_cmpgt_ps(_mm_add_ps(u, v), one)));
+
+      __m128 dist = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+      __m128 accept = _mm_and_ps(_mm_cmpge_ps(dist, negEps), _mm_cmplt_ps(dist, maxDist));
+      accept = _mm_andnot_ps(reject, accept);
+
+      _mm_store_ps(hits.dist + g, dist);
+      _mm_store_ps(hits.u + g, u);
+      _mm_store_ps(hits.v + g, v);
+      hitMask |= _mm_movemask_ps(accept) << g;
+    }
+    return hitMask;
+  }
+
+  /* AVX2 - all eight lanes at once */
+
+  CHAOS_TARGET_AVX2
+  static int intersectLanesAVX2(const TriBlock& b, const Vector3& o, const Vector3& d, float tMax, LaneHits& hits) {
+    const __m256 dx = _mm256_set1_ps(d.x), dy = _mm256_set1_ps(d.y), dz = _mm256_set1_ps(d.z);
+    const __m256 ox = _mm256_set1_ps(o.x), oy = _mm256_set1_ps(o.y), oz = _mm256_set1_ps(o.z);
+    const __m256 eps = _mm256_set1_ps(EPSILON), negEps = _mm256_set1_ps(-EPSILON);
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), maxDist = _mm256_set1_ps(tMax);
+
+    __m256 e1x = _mm256_load_ps(b.e1x), e1y = _mm256_load_ps(b.e1y), e1z = _mm256_load_ps(b.e1z);
+    __m256 e2x = _mm256_load_ps(b.e2x), e2y = _mm256_load_ps(b.e2y), e2z = _mm256_load_ps(b.e2z);
+
+    __m256 px = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+    __m256 py = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+    __m256 pz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+    __m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)), _mm256_mul_ps(e1z, pz));
+    __m256 reject = _mm256_and_ps(_mm256_cmp_ps(det, negEps, _CMP_GT_OQ), _mm256_cmp_ps(det, eps, _CMP_LT_OQ));
+    __m256 invDet = _mm256_div_ps(one, det);
+
+    __m256 tx = _mm256_sub_ps(ox, _mm256_load_ps(b.v0x));
+    __m256 ty = _mm256_sub_ps(oy, _mm256_load_ps(b.v0y));
+    __m256 tz = _mm256_sub_ps(oz, _mm256_load_ps(b.v0z));
+    __m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, px), _mm256_mul_ps(ty, py)), _mm256_mul_ps(tz, pz)), invDet);
+    reject = _mm256_or_ps(reject, _mm256_or_ps(_mm256_cmp_ps(u, zero, _CMP_LT_OQ), _mm256_cmp_ps(u, one, _CMP_GT_OQ)));
+
+    __m256 qx = _mm256_sub_ps(_mm256_mul_ps(ty, e1z), _mm256_mul_ps(tz, e1y));
+    __m256 qy = _mm256_sub_ps(_mm256_mul_ps(tz, e1x), _mm256_mul_ps(tx, e1z));
+    __m256 qz = _mm256_sub_ps(_mm256_mul_ps(tx, e1y), _mm256_mul_ps(ty, e1x));
+    __m256 v = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)), invDet);
+    reject = _mm256_or_ps(reject, _mm256_or_ps(_mm256_cmp_ps(v, zero, _CMP_LT_OQ),
+      _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_GT_OQ)));
+
+    __m256 dist = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)), invDet);
+    __m256 accept = _mm256_and_ps(_mm256_cmp_ps(dist, negEps, _CMP_GE_OQ), _mm256_cmp_ps(dist, maxDist, _CMP_LT_OQ));
+    accept = _mm256_andnot_ps(reject, accept);
+
+    _mm256_store_ps(hits.dist, dist);
+    _mm256_store_ps(hits.u, u);
+    _mm256_store_ps(hits.v, v);
+    return _mm256_movemask_ps(accept);
+  }
+
+#endif
+
+  static int intersectLanes(const TriBlock& block, const Vector3& origin, const Vector3& dir, float tMax, LaneHits& hits) {
+#ifdef CHAOS_SIMD_X86
+    switch (getSimdLevel()) {
+    case SimdLevel::AVX2:
+      return intersectLanesAVX2(block, origin, dir, tMax, hits);
+    case SimdLevel::SSE:
+      return intersectLanesSSE(block, origin, dir, tMax, hits);
+    default:
+      break;
+    }
+#endif
+    return intersectLanesScalar(block, origin, dir, tMax, hits);
+  }
+
+  int intersectTriBlock(const TriBlock& block, const Vector3& origin, const Vector3& dir, float tMax,
+    float& dist, float& u, float& v) {
+    LaneHits hits;
+    int hitMask = intersectLanes(block, origin, dir, tMax, hits);
+    return hitMask ? closestLane(hits, hitMask, dist, u, v) : -1;
+  }
+
+  bool occludesTriBlock(const TriBlock& block, const Vector3& origin, const Vector3& dir, float tMax) {
+    LaneHits hits;
+    return intersectLanes(block, origin, dir, tMax, hits) != 0;
+  }
+
+  /* PACKETS - one triangle against a group of rays */
+
+  //The rays of a packet share their origin, so the parts of the test that depend only on the origin and the triangle
+  //(t = origin - v0, q = t x e1 and the numerator of the distance) are computed once per triangle.
+  //They are the same float operations as in the kernels above, so the results stay bit-identical.
+  struct TriSetup {
+    float tx, ty, tz;
+    float qx, qy, qz;
+    float distNum; //e2.q
+  };
+
+  //Set up the used lanes of the block. Returns a bit mask of them.
+  static int setupTriangles(const TriBlock& b, const Vector3& o, TriSetup* setup) {
+    int laneMask = 0;
+    for (int i = 0; i < TRI_BLOCK_SIZE; i++) {
+      if (b.triIndex[i] < 0) continue;
+      TriSetup& s = setup[i];
+      s.tx = o.x - b.v0x[i];
+      s.ty = o.y - b.v0y[i];
+      s.tz = o.z - b.v0z[i];
+      s.qx = s.ty * b.e1z[i] - s.tz * b.e1y[i];
+      s.qy = s.tz * b.e1x[i] - s.tx * b.e1z[i];
+      s.qz = s.tx * b.e1y[i] - s.ty * b.e1x[i];
+      s.distNum = b.e2x[i] * s.qx + b.e2y[i] * s.qy + b.e2z[i] * s.qz;
+      laneMask |= 1 << i;
+    }
+    return laneMask;
+  }
+
+  static uint64_t intersectPacketScalar(const TriBlock& b, const TriSetup* setup, int laneMask, const RayPacket& packet,
+    int groupMask, PacketHits& hits) {
+    uint64_t hitMask = 0;
+    for (int g = 0; g < RAY_GROUP_COUNT; g++) {
+      if (!(groupMask & (1 << g))) continue;
+      for (int r = g * RAY_GROUP_SIZE; r < (g + 1) * RAY_GROUP_SIZE; r++) {
+        float dx = packet.dirX[r], dy = packet.dirY[r], dz = packet.dirZ[r];
+        //Lanes in order with a strict comparison, so that the lowest lane wins ties as in closestLane()
+        for (int i = 0; i < TRI_BLOCK_SIZE; i++) {
+          if (!(laneMask & (1 << i))) continue;
+          const TriSetup& s = setup[i];
+          float px = dy * b.e2z[i] - dz * b.e2y[i];
+          float py = dz * b.e2x[i] - dx * b.e2z[i];
+          float pz = dx * b.e2y[i] - dy * b.e2x[i];
+          float det = b.e1x[i] * px + b.e1y[i] * py + b.e1z[i] * pz;
+          if (det > -EPSILON && det < EPSILON) continue;
+          float invDet = 1.0f / det;
+
+          float u = (s.tx * px + s.ty * py + s.tz * pz) * invDet;
+          if (u < 0.0f || u > 1.0f) continue;
+          float v = (dx * s.qx + dy * s.qy + dz * s.qz) * invDet;
+          if (v < 0.0f || u + v > 1.0f) continue;
+
+          float dist = s.distNum * invDet;
+          if (dist >= -EPSILON && dist < hits.dist[r]) {
+            hits.dist[r] = dist;
+            hits.u[r] = u;
+            hits.v[r] = v;
+            hits.triIndex[r] = b.triIndex[i];
+            hitMask |= (uint64_t)1 << r;
+          }
+        }
+      }
+    }
+    return hitMask;
+  }
+
+#ifdef CHAOS_SIMD_X86
+
+  //SSE - four rays at a time
+  static uint64_t intersectPacketSSE(const TriBlock& b, const TriSetup* setup, int laneMask, const RayPacket& packet,
+    int groupMask, PacketHits& hits) {
+    const __m128 eps = _mm_set1_ps(EPSILON), negEps = _mm_set1_ps(-EPSILON);
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+
+    uint64_t hitMask = 0;
+    for (int r = 0; r < RAY_PACKET_SIZE; r += 4) {
+      if (!(groupMask & (1 << (r / RAY_GROUP_SIZE)))) continue;
+      __m128 dx = _mm_load_ps(packet.dirX + r), dy = _mm_load_ps(packet.dirY + r), dz = _mm_load_ps(packet.dirZ + r);
+      __m128 bestDist = _mm_load_ps(hits.dist + r);
+      __m128 bestU = _mm_load_ps(hits.u + r);
+      __m128 bestV = _mm_load_ps(hits.v + r);
+      __m128 bestTri = _mm_castsi128_ps(_mm_load_si128((const __m128i*)(hits.triIndex + r)));
+      __m128 anyHit = _mm_setzero_ps();
+
+      for (int i = 0; i < TRI_BLOCK_SIZE; i++) {
+        if (!(laneMask & (1 << i))) continue;
+        const TriSetup& s = setup[i];
+        __m128 e1x = _mm_set1_ps(b.e1x[i]), e1y = _mm_set1_ps(b.e1y[i]), e1z = _mm_set1_ps(b.e1z[i]);
+        __m128 e2x = _mm_set1_ps(b.e2x[i]), e2y = _mm_set1_ps(b.e2y[i]), e2z = _mm_set1_ps(b.e2z[i]);
+
+        __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        __m128 reject = _mm_and_ps(_mm_cmpgt_ps(det, negEps), _mm_cmplt_ps(det, eps));
+        __m128 invDet = _mm_div_ps(one, det);
+
+        __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(s.tx), px), _mm_mul_ps(_mm_set1_ps(s.ty), py)),
+          _mm_mul_ps(_mm_set1_ps(s.tz), pz)), invDet);
+        reject = _mm_or_ps(reject, _mm_or_ps(_mm_cmplt_ps(u, zero), _mm_cmpgt_ps(u, one)));
+        __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_set1_ps(s.qx)), _mm_mul_ps(dy, _mm_set1_ps(s.qy))),
+          _mm_mul_ps(dz, _mm_set1_ps(s.qz))), invDet);
+        reject = _mm_or_ps(reject, _mm_or_ps(_mm_cmplt_ps(v, zero), _mm_cmpgt_ps(_mm_add_ps(u, v), one)));
+
+        __m128 dist = _mm_mul_ps(_mm_set1_ps(s.distNum), invDet);
+        __m128 accept = _mm_and_ps(_mm_cmpge_ps(dist, negEps), _mm_cmplt_ps(dist, bestDist));
+        accept = _mm_andnot_ps(reject, accept);
+
+        //Keep the closer hits (SSE2 has no blend instruction)
+        bestDist = _mm_or_ps(_mm_and_ps(accept, dist), _mm_andnot_ps(accept, bestDist));
+        bestU = _mm_or_ps(_mm_and_ps(accept, u), _mm_andnot_ps(accept, bestU));
+        bestV = _mm_or_ps(_mm_and_ps(accept, v), _mm_andnot_ps(accept, bestV));
+        __m128 tri = _mm_castsi128_ps(_mm_set1_epi32(b.triIndex[i]));
+        bestTri = _mm_or_ps(_mm_and_ps(accept, tri), _mm_andnot_ps(accept, bestTri));
+        anyHit = _mm_or_ps(anyHit, accept);
+      }
+
+      _mm_store_ps(hits.dist + r, bestDist);
+      _mm_store_ps(hits.u + r, bestU);
+      _mm_store_ps(hits.v + r, bestV);
+      _mm_store_si128((__m128i*)(hits.triIndex + r), _mm_castps_si128(bestTri));
+      hitMask |= (uint64_t)_mm_movemask_ps(anyHit) << r;
+    }
+    return hitMask;
+  }
+
+  //AVX2 - a whole group of eight rays at a time
+  CHAOS_TARGET_AVX2
+  static uint64_t intersectPacketAVX2(const TriBlock& b, const TriSetup* setup, int laneMask, const RayPacket& packet,
+    int groupMask, PacketHits& hits) {
+    const __m256 eps = _mm256_set1_ps(EPSILON), negEps = _mm256_set1_ps(-EPSILON);
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+
+    uint64_t hitMask = 0;
+    for (int g = 0; g < RAY_GROUP_COUNT; g++) {
+      if (!(groupMask & (1 << g))) continue;
+      int r = g * RAY_GROUP_SIZE;
+      __m256 dx = _mm256_load_ps(packet.dirX + r), dy = _mm256_load_ps(packet.dirY + r), dz = _mm256_load_ps(packet.dirZ + r);
+      __m256 bestDist = _mm256_load_ps(hits.dist + r);
+      __m256 bestU = _mm256_load_ps(hits.u + r);
+      __m256 bestV = _mm256_load_ps(hits.v + r);
+      __m256 bestTri = _mm256_castsi256_ps(_mm256_load_si256((const __m256i*)(hits.triIndex + r)));
+      __m256 anyHit = _mm256_setzero_ps();
+
+      for (int i = 0; i < TRI_BLOCK_SIZE; i++) {
+        if (!(laneMask & (1 << i))) continue;
+        const TriSetup& s = setup[i];
+        __m256 e1x = _mm256_set1_ps(b.e1x[i]), e1y = _mm256_set1_ps(b.e1y[i]), e1z = _mm256_set1_ps(b.e1z[i]);
+        __m256 e2x = _mm256_set1_ps(b.e2x[i]), e2y = _mm256_set1_ps(b.e2y[i]), e2z = _mm256_set1_ps(b.e2z[i]);
+
+        __m256 px = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+        __m256 py = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+        __m256 pz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+        __m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)), _mm256_mul_ps(e1z, pz));
+        __m256 reject = _mm256_and_ps(_mm256_cmp_ps(det, negEps, _CMP_GT_OQ), _mm256_cmp_ps(det, eps, _CMP_LT_OQ));
+        __m256 invDet = _mm256_div_ps(one, det);
+
+        __m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(s.tx), px),
+          _mm256_mul_ps(_mm256_set1_ps(s.ty), py)), _mm256_mul_ps(_mm256_set1_ps(s.tz), pz)), invDet);
+        reject = _mm256_or_ps(reject, _mm256_or_ps(_mm256_cmp_ps(u, zero, _CMP_LT_OQ), _mm256_cmp_ps(u, one, _CMP_GT_OQ)));
+        __m256 v = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, _mm256_set1_ps(s.qx)),
+          _mm256_mul_ps(dy, _mm256_set1_ps(s.qy))), _mm256_mul_ps(dz, _mm256_set1_ps(s.qz))), invDet);
+        reject = _mm256_or_ps(reject, _mm256_or_ps(_mm256_cmp_ps(v, zero, _CMP_LT_OQ),
+          _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_GT_OQ)));
+
+        __m256 dist = _mm256_mul_ps(_mm256_set1_ps(s.distNum), invDet);
+        __m256 accept = _mm256_and_ps(_mm256_cmp_ps(dist, negEps, _CMP_GE_OQ), _mm256_cmp_ps(dist, bestDist, _CMP_LT_OQ));
+        accept = _mm256_andnot_ps(reject, accept);
+
+        bestDist = _mm256_blendv_ps(bestDist, dist, accept);
+        bestU = _mm256_blendv_ps(bestU, u, accept);
+        bestV = _mm256_blendv_ps(bestV, v, accept);
+        bestTri = _mm256_blendv_ps(bestTri, _mm256_castsi256_ps(_mm256_set1_epi32(b.triIndex[i])), accept);
+        anyHit = _mm256_or_ps(anyHit, accept);
+      }
+
+      _mm256_store_ps(hits.dist + r, bestDist);
+      _mm256_store_ps(hits.u + r, bestU);
+      _mm256_store_ps(hits.v + r, bestV);
+      _mm256_store_si256((__m256i*)(hits.triIndex + r), _mm256_castps_si256(bestTri));
+      hitMask |= (uint64_t)_mm256_movemask_ps(anyHit) << r;
+    }
+    return hitMask;
+  }
+
+#endif
+
+  uint64_t intersectTriBlockPacket(const TriBlock& block, const RayPacket& packet, int groupMask, PacketHits& hits) {
+    TriSetup setup[TRI_BLOCK_SIZE];
+    int laneMask = setupTriangles(block, packet.origin, setup);
+    if (!laneMask || !groupMask) return 0;
+#ifdef CHAOS_SIMD_X86
+    switch (getSimdLevel()) {
+    case SimdLevel::AVX2:
+      return intersectPacketAVX2(block, setup, laneMask, packet, groupMask, hits);
+    case SimdLevel::SSE:
+      return intersectPacketSSE(block, setup, laneMask, packet, groupMask, hits);
+    default:
+      break;
+    }
+#endif
+    return intersectPacketScalar(block, setup, laneMask, packet, groupMask, hits);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+#include "Math/Vector3.h"
+#include "RayPacket.h"
+#include <cstdint>
+
+namespace ChaosCampAM {
+
+  //Number of triangles in a block (= lanes of an AVX2 register)
+  static const int TRI_BLOCK_SIZE = 8;
+
+  /*
+  * A block of triangles in structure-of-arrays layout, so one ray can be tested against all of them at once
+  * (one AVX2 or two SSE operations per step of the Moller-Trumbore test).
+  * Unused lanes hold degenerate triangles (zero edges), which the test always rejects.
+  */
+  struct alignas(64) TriBlock {
+    float v0x[TRI_BLOCK_SIZE];
+    float v0y[TRI_BLOCK_SIZE];
+    float v0z[TRI_BLOCK_SIZE];
+    float e1x[TRI_BLOCK_SIZE]; //edge1 = v1 - v0
+    float e1y[TRI_BLOCK_SIZE];
+    float e1z[TRI_BLOCK_SIZE];
+    float e2x[TRI_BLOCK_SIZE]; //edge2 = v2 - v0
+    float e2y[TRI_BLOCK_SIZE];
+    float e2z[TRI_BLOCK_SIZE];
+    int triIndex[TRI_BLOCK_SIZE]; //index of the triangle within its mesh, -1 for unused lanes
+
+    //All lanes unused
+    TriBlock();
+
+    //Store a triangle in the given lane.
+    void setLane(int lane, const Vector3& v0, const Vector3& v1, const Vector3& v2, int index);
+  };
+
+  //Closest-hit test of one ray against all triangles in the block.
+  //Returns the lane of the closest hit that is closer than 'tMax' (the lowest such lane on ties), or -1 if there is none.
+  //On a hit, 'dist' receives the distance along the ray and 'u'/'v' the barycentric coordinates associated with v1/v2.
+  //The work is dispatched to the widest kernel the CPU supports (see getSimdLevel()). All kernels perform the same
+  //floating-point operations in the same order, so the results are bit-identical to the scalar fallback.
+  int intersectTriBlock(const TriBlock& block, const Vector3& origin, const Vector3& dir, float tMax,
+    float& dist, float& u, float& v);
+
+  //Any-hit test - true if the ray hits some triangle in the block closer than 'tMax'.
+  bool occludesTriBlock(const TriBlock& block, const Vector3& origin, const Vector3& dir, float tMax);
+
+  //Closest-hit test of the rays of a packet against all triangles in the block, one triangle against a whole group of
+  //rays at a time. Only the groups set in 'groupMask' are tested.
+  //Ray 'i' accepts hits closer than hits.dist[i]; a closer hit replaces its entries in 'hits' (triIndex included).
+  //Returns a bit mask of the rays whose hit was replaced.
+  //Every ray gets exactly the result intersectTriBlock() gives for it, whichever kernel is used.
+  uint64_t intersectTriBlockPacket(const TriBlock& block, const RayPacket& packet, int groupMask, PacketHits& hits);
+}
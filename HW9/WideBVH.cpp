@@ -0,0 +1,353 @@
+#include "WideBVH.h"
+#include "BinaryIO.h"
+#include "Math/Simd.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#ifdef CHAOS_SIMD_X86
+#include <immintrin.h>
+#endif
+
+//All kernels below perform the slab test of AABB::intersect() on the decoded child boxes, lane by lane:
+//  plane = origin + q * cellSize, t = (plane - rayOrigin) * invDir
+//The near and far planes of each slab are picked by the sign of the ray direction, so no per-lane swap is needed.
+//max/min are written in the operand order of the SSE/AVX instructions, so NaN lanes behave the same in every kernel.
+
+namespace ChaosCampAM {
+
+  static_assert(sizeof(WideBVHNode) == 128, "WideBVHNode must span exactly two cache lines");
+
+  //Exit distances are widened by the same few ulps as in AABB::intersect()
+  static const float SLAB_EXIT_WIDENING = 1.00000036f;
+
+  float WideBVHNode::cellSize(int axis) const {
+    //2^exponent, built directly from the float bits
+    uint32_t bits = (uint32_t)(exponent[axis] + 127) << 23;
+    float size;
+    memcpy(&size, &bits, sizeof(float));
+    return size;
+  }
+
+  AABB WideBVHNode::childBounds(int slot) const {
+    float lowerPlanes[3], upperPlanes[3];
+    for (int axis = 0; axis < 3; axis++) {
+      float size = cellSize(axis);
+      lowerPlanes[axis] = origin[axis] + (float)lower[axis][slot] * size;
+      upperPlanes[axis] = origin[axis] + (float)upper[axis][slot] * size;
+    }
+    return AABB(Vector3(lowerPlanes[0], lowerPlanes[1], lowerPlanes[2]), Vector3(upperPlanes[0], upperPlanes[1], upperPlanes[2]));
+  }
+
+  WideBVHRay::WideBVHRay(const Vector3& rayOrigin, const Vector3& rayDir) {
+    for (int axis = 0; axis < 3; axis++) {
+      origin[axis] = rayOrigin[axis];
+      invDir[axis] = 1.0f / rayDir[axis];
+      negative[axis] = std::signbit(invDir[axis]);
+    }
+  }
+
+  /* SCALAR FALLBACK */
+
+  static int intersectChildrenScalar(const WideBVHNode& node, const WideBVHRay& ray, float tMax, float* tEntry) {
+    float tNear[WIDE_BVH_WIDTH];
+    float tFar[WIDE_BVH_WIDTH];
+    for (int i = 0; i < WIDE_BVH_WIDTH; i++) {
+      tNear[i] = 0.0f;
+      tFar[i] = tMax;
+    }
+
+    for (int axis = 0; axis < 3; axis++) {
+      const uint8_t* nearPlanes = ray.negative[axis] ? node.upper[axis] : node.lower[axis];
+      const uint8_t* farPlanes = ray.negative[axis] ? node.lower[axis] : node.upper[axis];
+      float cellSize = node.cellSize(axis);
+      for (int i = 0; i < WIDE_BVH_WIDTH; i++) {
+        float t0 = (node.origin[axis] + (float)nearPlanes[i] * cellSize - ray.origin[axis]) * ray.invDir[axis];
+        float t1 = (node.origin[axis] + (float)farPlanes[i] * cellSize - ray.origin[axis]) * ray.invDir[axis];
+        tNear[i] = t0 > tNear[i] ? t0 : tNear[i];
+        tFar[i] = t1 < tFar[i] ? t1 : tFar[i];
+      }
+    }
+
+    int hitMask = 0;
+    for (int i = 0; i < WIDE_BVH_WIDTH; i++) {
+      tEntry[i] = tNear[i];
+      if (tNear[i] <= tFar[i] * SLAB_EXIT_WIDENING) hitMask |= 1 << i;
+    }
+    return hitMask;
+  }
+
+#ifdef CHAOS_SIMD_X86
+
+  /* SSE - two groups of four children */
+
+  //Four 8-bit grid coordinates as floats
+  static __m128 loadPlanesSSE(const uint8_t* planes) {
+    int32_t packed;
+    memcpy(&packed, planes, sizeof(packed));
+    __m128i bytes = _mm_cvtsi32_si128(packed);
+    __m128i zero = _mm_setzero_si128();
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+  }
+
+  static int intersectChildrenSSE(const WideBVHNode& node, const WideBVHRay& ray, float tMax, float* tEntry) {
+    const __m128 widening = _mm_set1_ps(SLAB_EXIT_WIDENING);
+    int hitMask = 0;
+    for (int g = 0; g < WIDE_BVH_WIDTH; g += 4) {
+      __m128 tNear = _mm_setzero_ps();
+      __m128 tFar = _mm_set1_ps(tMax);
+      for (int axis = 0; axis < 3; axis++) {
+        const uint8_t* nearPlanes = ray.negative[axis] ? node.upper[axis] : node.lower[axis];
+        const uint8_t* farPlanes = ray.negative[axis] ? node.lower[axis] : node.upper[axis];
+        __m128 origin = _mm_set1_ps(node.origin[axis]);
+        __m128 cellSize = _mm_set1_ps(node.cellSize(axis));
+        __m128 rayOrigin = _mm_set1_ps(ray.origin[axis]);
+        __m128 invDir = _mm_set1_ps(ray.invDir[axis]);
+
+        __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(origin, _mm_mul_ps(loadPlanesSSE(nearPlanes + g), cellSize)),
+          rayOrigin), invDir);
+        __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(origin, _mm_mul_ps(loadPlanesSSE(farPlanes + g), cellSize)),
+          rayOrigin), invDir);
+        tNear = _mm_max_ps(t0, tNear);
+        tFar = _mm_min_ps(t1, tFar);
+      }
+      _mm_storeu_ps(tEntry + g, tNear);
+      hitMask |= _mm_movemask_ps(_mm_cmple_ps(tNear, _mm_mul_ps(tFar, widening))) << g;
+    }
+    return hitMask;
+  }
+
+  /* AVX2 - all eight children at once */
+
+  CHAOS_TARGET_AVX2
+  static int intersectChildrenAVX2(const WideBVHNode& node, const WideBVHRay& ray, float tMax, float* tEntry) {
+    __m256 tNear = _mm256_setzero_ps();
+    __m256 tFar = _mm256_set1_ps(tMax);
+    for (int axis = 0; axis < 3; axis++) {
+      const uint8_t* nearPlanes = ray.negative[axis] ? node.upper[axis] : node.lower[axis];
+      const uint8_t* farPlanes = ray.negative[axis] ? node.lower[axis] : node.upper[axis];
+      __m256 origin = _mm256_set1_ps(node.origin[axis]);
+      __m256 cellSize = _mm256_set1_ps(node.cellSize(axis));
+      __m256 rayOrigin = _mm256_set1_ps(ray.origin[axis]);
+      __m256 invDir = _mm256_set1_ps(ray.invDir[axis]);
+
+      __m256 nearQ = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)nearPlanes)));
+      __m256 farQ = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)farPlanes)));
+      __m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(origin, _mm256_mul_ps(nearQ, cellSize)), rayOrigin), invDir);
+      __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(origin, _mm256_mul_ps(farQ, cellSize)), rayOrigin), invDir);
+      tNear = _mm256_max_ps(t0, tNear);
+      tFar = _mm256_min_ps(t1, tFar);
+    }
+    _mm256_storeu_ps(tEntry, tNear);
+    return _mm256_movemask_ps(_mm256_cmp_ps(tNear, _mm256_mul_ps(tFar, _mm256_set1_ps(SLAB_EXIT_WIDENING)), _CMP_LE_OQ));
+  }
+
+#endif
+
+  int intersectWideNode(const WideBVHNode& node, const WideBVHRay& ray, float tMax, float* tEntry) {
+    int hitMask;
+#ifdef CHAOS_SIMD_X86
+    switch (getSimdLevel()) {
+    case SimdLevel::AVX2:
+      hitMask = intersectChildrenAVX2(node, ray, tMax, tEntry);
+      break;
+    case SimdLevel::SSE:
+      hitMask = intersectChildrenSSE(node, ray, tMax, tEntry);
+      break;
+    default:
+      hitMask = intersectChildrenScalar(node, ray, tMax, tEntry);
+    }
+#else
+    hitMask = intersectChildrenScalar(node, ray, tMax, tEntry);
+#endif
+    //Unused slots hold no box
+    return hitMask & ((1 << node.childCount) - 1);
+  }
+
+  /* BUILD */
+
+  //Grid of a node along one axis: the smallest power-of-two cell size for which 255 cells cover [minCoord;maxCoord]
+  //(checked with the same float operations the kernels use to decode planes).
+  static int8_t gridExponent(float minCoord, float maxCoord) {
+    float extent = maxCoord - minCoord;
+    int exponent = extent > 0.0f ? (int)std::ceil(std::log2(extent / 255.0f)) : -126;
+    exponent = std::max(-126, std::min(exponent, 127));
+    while (exponent < 127 && minCoord + 255.0f * std::ldexp(1.0f, exponent) < maxCoord) {
+      exponent++;
+    }
+    return (int8_t)exponent;
+  }
+
+  void WideBVH::build(const BVH& bvh) {
+    auto startTime = std::chrono::steady_clock::now();
+    buildStats = bvh.getBuildStats();
+    bounds = bvh.getBounds();
+    primIndices = std::vector<int>(bvh.getPrimIndices().begin(), bvh.getPrimIndices().end());
+    nodes.clear();
+    if (bvh.isEmpty()) return;
+
+    //Number of leaves below every binary node. Children are stored after their parent, so a backward sweep suffices.
+    const DataArray<BVHNode>& binaryNodes = bvh.getNodes();
+    std::vector<int> leafCounts(binaryNodes.size(), 1);
+    for (int i = (int)binaryNodes.size() - 1; i >= 0; i--) {
+      if (!binaryNodes[i].isLeaf()) leafCounts[i] = leafCounts[i + 1] + leafCounts[binaryNodes[i].offset];
+    }
+
+    std::vector<WideBVHNode> wideNodes;
+    wideNodes.reserve(binaryNodes.size() / 8 + 1);
+    collapse(binaryNodes, leafCounts, 0, wideNodes);
+    nodes = std::move(wideNodes);
+    buildStats.buildTimeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+  }
+
+  int WideBVH::collapse(const DataArray<BVHNode>& binaryNodes, const std::vector<int>& leafCounts, int binaryIndex,
+    std::vector<WideBVHNode>& wideNodes) const {
+    const BVHNode& binaryNode = binaryNodes[binaryIndex];
+    int nodeIndex = (int)wideNodes.size();
+    wideNodes.emplace_back();
+
+    //Start from the two children of the binary node (or from the node itself if the whole tree is one leaf) and keep
+    //opening interior children until the node is full:
+    // - first those whose whole subtree fits into the free slots, smallest first - this avoids wide nodes with only
+    //   a few children near the bottom of the tree, which would waste most of their slots;
+    // - then the one with the largest surface area, as it is the most likely to be entered by a ray.
+    int children[WIDE_BVH_WIDTH];
+    int childCount = 0;
+    if (binaryNode.isLeaf()) {
+      children[childCount++] = binaryIndex;
+    }
+    else {
+      children[childCount++] = binaryIndex + 1;
+      children[childCount++] = binaryNode.offset;
+    }
+    while (childCount < WIDE_BVH_WIDTH) {
+      int toOpen = -1;
+      int freeSlots = WIDE_BVH_WIDTH - childCount;
+      for (int i = 0; i < childCount; i++) {
+        int leaves = leafCounts[children[i]];
+        if (leaves > 1 && leaves <= freeSlots + 1 && (toOpen < 0 || leaves < leafCounts[children[toOpen]])) toOpen = i;
+      }
+      if (toOpen < 0) {
+        float largestArea = -1.0f;
+        for (int i = 0; i < childCount; i++) {
+          const BVHNode& child = binaryNodes[children[i]];
+          if (!child.isLeaf() && child.bounds.surfaceArea() > largestArea) {
+            toOpen = i;
+            largestArea = child.bounds.surfaceArea();
+          }
+        }
+      }
+      if (toOpen < 0) break;
+
+      int opened = children[toOpen];
+      children[toOpen] = opened + 1;
+      children[childCount++] = binaryNodes[opened].offset;
+    }
+    //Depth-first order, so that the leaves stay in primitive order
+    std::sort(children, children + childCount);
+
+    WideBVHNode& node = wideNodes[nodeIndex];
+    const AABB& box = binaryNode.bounds;
+    for (int axis = 0; axis < 3; axis++) {
+      node.origin[axis] = box.min[axis];
+      node.exponent[axis] = gridExponent(box.min[axis], box.max[axis]);
+    }
+    node.childCount = (uint8_t)childCount;
+
+    for (int i = 0; i < WIDE_BVH_WIDTH; i++) {
+      node.child[i] = -1;
+      node.primCount[i] = 0;
+    }
+    for (int i = 0; i < childCount; i++) {
+      const AABB& childBox = binaryNodes[children[i]].bounds;
+      for (int axis = 0; axis < 3; axis++) {
+        //Round outwards, then correct for the rounding of the decoding
+        float origin = node.origin[axis];
+        float cellSize = node.cellSize(axis);
+        int lower = (int)std::floor((childBox.min[axis] - origin) / cellSize);
+        int upper = (int)std::ceil((childBox.max[axis] - origin) / cellSize);
+        lower = std::max(0, std::min(lower, 255));
+        upper = std::max(0, std::min(upper, 255));
+        while (lower > 0 && origin + (float)lower * cellSize > childBox.min[axis]) lower--;
+        while (upper < 255 && origin + (float)upper * cellSize < childBox.max[axis]) upper++;
+        node.lower[axis][i] = (uint8_t)lower;
+        node.upper[axis][i] = (uint8_t)upper;
+      }
+    }
+
+    for (int i = 0; i < childCount; i++) {
+      const BVHNode& child = binaryNodes[children[i]];
+      if (child.isLeaf()) {
+        wideNodes[nodeIndex].child[i] = child.offset;
+        wideNodes[nodeIndex].primCount[i] = child.primCount;
+      }
+      else {
+        //Recursion may reallocate 'wideNodes'
+        int childIndex = collapse(binaryNodes, leafCounts, children[i], wideNodes);
+        wideNodes[nodeIndex].child[i] = childIndex;
+      }
+    }
+    return nodeIndex;
+  }
+
+  bool WideBVH::isEmpty() const {
+    return nodes.empty();
+  }
+
+  const BVHBuildStats& WideBVH::getBuildStats() const {
+    return buildStats;
+  }
+
+  const AABB& WideBVH::getBounds() const {
+    return bounds;
+  }
+
+  const DataArray<WideBVHNode>& WideBVH::getNodes() const {
+    return nodes;
+  }
+
+  const DataArray<int>& WideBVH::getPrimIndices() const {
+    return primIndices;
+  }
+
+  bool WideBVH::isValid(int primCount) const {
+    if (primIndices.size() != (size_t)primCount) return false;
+    for (int index : primIndices) {
+      if (index < 0 || index >= primCount) return false;
+    }
+    if (nodes.empty()) return primCount == 0;
+
+    //Nodes are stored depth-first, so the depth of a node is known by the time it is reached. Every level may leave
+    //WIDE_BVH_WIDTH - 1 children on the traversal stack.
+    std::vector<int> depths(nodes.size(), 0);
+    for (int i = 0; i < (int)nodes.size(); i++) {
+      const WideBVHNode& node = nodes[i];
+      if (depths[i] >= BVH_MAX_DEPTH || node.childCount < 1 || node.childCount > WIDE_BVH_WIDTH) return false;
+      for (int slot = 0; slot < node.childCount; slot++) {
+        int child = node.child[slot];
+        int childPrims = node.primCount[slot];
+        if (childPrims > 0) {
+          if (child < 0 || child > primCount - childPrims) return false;
+        }
+        else {
+          if (childPrims < 0 || child <= i || child >= (int)nodes.size()) return false;
+          depths[child] = std::max(depths[child], depths[i] + 1);
+        }
+      }
+    }
+    return true;
+  }
+
+  void WideBVH::write(BinaryWriter& writer) const {
+    writer.write(bounds);
+    writer.writeArray(nodes);
+    writer.writeArray(primIndices);
+  }
+
+  bool WideBVH::read(BinaryReader& reader) {
+    if (!reader.read(bounds) || !reader.readArray(nodes) || !reader.readArray(primIndices)) return false;
+    buildStats = BVHBuildStats();
+    return true;
+  }
+}
@@ -0,0 +1,221 @@
+#pragma once
+#include "BVH.h"
+#include "AABB.h"
+#include "Ray.h"
+#include "RayPacket.h"
+#include "Constants.h"
+#include "DataArray.h"
+#include <cstdint>
+#include <vector>
+
+namespace ChaosCampAM {
+
+  //Forward-declarations
+  class BinaryWriter;
+  class BinaryReader;
+
+  //Maximum number of children of a wide BVH node (= lanes of an AVX2 register)
+  static const int WIDE_BVH_WIDTH = 8;
+
+  //Every node visited pushes at most WIDE_BVH_WIDTH - 1 children, on at most BVH_MAX_DEPTH levels
+  static const int WIDE_BVH_STACK_SIZE = (WIDE_BVH_WIDTH - 1) * BVH_MAX_DEPTH + 1;
+
+  //A node of an 8-wide BVH. 128 bytes = two cache lines: the first holds everything the ray-vs-children test reads,
+  //the second the child references, which are only read for the children the ray enters.
+  //The bounds of the children are stored per axis (structure-of-arrays), quantized to 8 bits on a grid that starts at
+  //'origin' and has a power-of-two cell size per axis. They are rounded outwards, so they always contain the exact bounds.
+  struct alignas(64) WideBVHNode {
+    float origin[3];
+    int8_t exponent[3]; //cell size along each axis is 2^exponent
+    uint8_t childCount; //children occupy slots [0;childCount)
+    uint8_t lower[3][WIDE_BVH_WIDTH]; //quantized child bounds, per axis
+    uint8_t upper[3][WIDE_BVH_WIDTH];
+    // - Leaf child (primCount > 0): 'child' is the position of its first primitive in the primitive index list.
+    // - Interior child (primCount == 0): 'child' is the index of its node.
+    int child[WIDE_BVH_WIDTH];
+    int primCount[WIDE_BVH_WIDTH];
+
+    //Cell size along an axis
+    float cellSize(int axis) const;
+
+    //Decoded box of a child - the planes the node test uses
+    AABB childBounds(int slot) const;
+  };
+
+  //A ray prepared for the node test. The sign of the direction decides which side of each slab the ray enters first.
+  struct WideBVHRay {
+    float origin[3];
+    float invDir[3];
+    bool negative[3];
+
+    WideBVHRay(const Vector3& rayOrigin, const Vector3& rayDir);
+  };
+
+  //Test a ray against the boxes of all children of a node.
+  //Returns a bit mask of the children the ray enters within [0;tMax], with their entry distances in 'tEntry'.
+  //The work is dispatched to the widest kernel the CPU supports (see getSimdLevel()); all kernels give identical results.
+  int intersectWideNode(const WideBVHNode& node, const WideBVHRay& ray, float tMax, float* tEntry);
+
+  /*
+  * 8-wide bounding volume hierarchy, made by collapsing a binary BVH: every node adopts descendants of the binary node
+  * until it has WIDE_BVH_WIDTH children. One SIMD test covers all children of a node and the whole hierarchy takes
+  * less than half the memory of the binary one, so a ray touches far fewer cache lines on its way down.
+  * The leaves and the primitive order are those of the binary BVH.
+  */
+  class WideBVH {
+  public:
+    WideBVH() {}
+
+    //Collapse a built binary BVH. The binary BVH is not referenced afterwards.
+    void build(const BVH& bvh);
+
+    //Visit the leaves the ray enters within [0;tMax], front-to-back - same contract as BVH::traverse().
+    //The children of every node are visited in the order in which the ray enters them.
+    template<typename LeafFunc>
+    void traverse(const Ray& ray, const float& tMax, LeafFunc leafFunc) const;
+
+    //Visit the leaves that some ray of the packet may enter within [0;tMax], nearest first by the lower bound of the
+    //entry distances of the packet. Boxes are tested against the whole packet (see RayPacket::intersectBox()).
+    //'leafFunc(int first, int count, const AABB& leafBounds)' - as in traverse(), with the box of the leaf, so that
+    //the user can cull groups of rays against it.
+    template<typename LeafFunc>
+    void traversePacket(const RayPacket& packet, const float& tMax, LeafFunc leafFunc) const;
+
+    bool isEmpty() const;
+
+    //Figures of the build of the binary BVH collapsed last, the build time including the collapse (empty after read()).
+    const BVHBuildStats& getBuildStats() const;
+
+    //Bounds of the whole hierarchy (exact, not quantized)
+    const AABB& getBounds() const;
+
+    const DataArray<WideBVHNode>& getNodes() const;
+    const DataArray<int>& getPrimIndices() const;
+
+    //Same as BVH::isValid() - checked on restored hierarchies, which are not trusted.
+    bool isValid(int primCount) const;
+
+    //Store the hierarchy in a binary scene file / restore it from one (see SceneCache).
+    //Restored nodes and indices are views into the mapped file. Returns false if the data is truncated.
+    void write(BinaryWriter& writer) const;
+    bool read(BinaryReader& reader);
+
+  private:
+    //Entry of the traversal stack - a child of some node and the distance at which the ray enters it
+    struct StackEntry {
+      int child;
+      int primCount;
+      float dist;
+    };
+
+    //Entry of the packet traversal stack - child 'slot' of node 'node', or the root node itself if 'slot' is -1
+    struct PacketStackEntry {
+      int node;
+      int slot;
+      float dist;
+    };
+
+    //Make the wide node for the binary node 'binaryIndex' and, recursively, for its interior descendants.
+    //'leafCounts' holds the number of leaves below every binary node. Returns the index of the new node.
+    int collapse(const DataArray<BVHNode>& binaryNodes, const std::vector<int>& leafCounts, int binaryIndex,
+      std::vector<WideBVHNode>& wideNodes) const;
+
+    DataArray<WideBVHNode> nodes;
+    DataArray<int> primIndices;
+    AABB bounds;
+    BVHBuildStats buildStats;
+  };
+
+  template<typename LeafFunc>
+  void WideBVH::traverse(const Ray& ray, const float& tMax, LeafFunc leafFunc) const {
+    if (nodes.empty()) return;
+
+    WideBVHRay wideRay(ray.getOrigin(), ray.getDirection());
+    StackEntry stack[WIDE_BVH_STACK_SIZE];
+    int stackSize = 0;
+    StackEntry current = { 0, 0, 0.0f };
+
+    while (true) {
+      if (current.primCount > 0) {
+        if (leafFunc(current.child, current.primCount)) return;
+      }
+      else {
+        const WideBVHNode& node = nodes[current.child];
+        float tEntry[WIDE_BVH_WIDTH];
+        int hitMask = intersectWideNode(node, wideRay, tMax, tEntry);
+        if (hitMask) {
+          //Sort the children entered by distance, continue with the nearest and postpone the others, farthest first
+          StackEntry hits[WIDE_BVH_WIDTH];
+          int hitCount = 0;
+          for (int i = 0; i < node.childCount; i++) {
+            if (!(hitMask & (1 << i))) continue;
+            int pos = hitCount++;
+            while (pos > 0 && hits[pos - 1].dist > tEntry[i]) {
+              hits[pos] = hits[pos - 1];
+              pos--;
+            }
+            hits[pos] = { node.child[i], node.primCount[i], tEntry[i] };
+          }
+          for (int i = hitCount - 1; i > 0; i--) {
+            stack[stackSize++] = hits[i];
+          }
+          current = hits[0];
+          continue;
+        }
+      }
+
+      //Pop the next child, skipping those that start behind the closest hit found meanwhile
+      do {
+        if (stackSize == 0) return;
+        current = stack[--stackSize];
+      } while (current.dist > tMax);
+    }
+  }
+
+  template<typename LeafFunc>
+  void WideBVH::traversePacket(const RayPacket& packet, const float& tMax, LeafFunc leafFunc) const {
+    float rootEntry;
+    if (nodes.empty() || !packet.intersectBox(bounds, tMax, rootEntry)) return;
+
+    PacketStackEntry stack[WIDE_BVH_STACK_SIZE];
+    int stackSize = 0;
+    PacketStackEntry current = { 0, -1, rootEntry };
+
+    while (true) {
+      const WideBVHNode& parent = nodes[current.node];
+      if (current.slot >= 0 && parent.primCount[current.slot] > 0) {
+        if (leafFunc(parent.child[current.slot], parent.primCount[current.slot], parent.childBounds(current.slot))) return;
+      }
+      else {
+        //Same ordering as in traverse(), by the entry bounds of the packet
+        int nodeIndex = current.slot < 0 ? current.node : parent.child[current.slot];
+        const WideBVHNode& node = nodes[nodeIndex];
+        PacketStackEntry hits[WIDE_BVH_WIDTH];
+        int hitCount = 0;
+        for (int i = 0; i < node.childCount; i++) {
+          float tEntry;
+          if (!packet.intersectBox(node.childBounds(i), tMax, tEntry)) continue;
+          int pos = hitCount++;
+          while (pos > 0 && hits[pos - 1].dist > tEntry) {
+            hits[pos] = hits[pos - 1];
+            pos--;
+          }
+          hits[pos] = { nodeIndex, i, tEntry };
+        }
+        if (hitCount > 0) {
+          for (int i = hitCount - 1; i > 0; i--) {
+            stack[stackSize++] = hits[i];
+          }
+          current = hits[0];
+          continue;
+        }
+      }
+
+      do {
+        if (stackSize == 0) return;
+        current = stack[--stackSize];
+      } while (current.dist > tMax);
+    }
+  }
+
+}